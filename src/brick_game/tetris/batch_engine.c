@@ -0,0 +1,537 @@
+#include "batch_engine.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BATCH_X86 1
+#endif
+
+// строка поля в ядрах сдвинута на 3 бита, всё вне 3..12 - стенки. Фигура
+// может стоять с col до -2, а кандидат сдвига - на клетку дальше
+#define BATCH_SHIFT 3
+#define BATCH_WALLS 0xE007u
+#define SPAWN_COL ((FIELD_COLS - MASK_SIZE) / 2)
+
+// фигуры блока для одного вызова ядра; у лейна без фигуры все строки 0, и
+// ядра его не задевают
+typedef struct {
+  _Alignas(32) uint16_t piece[MASK_SIZE][BATCH_LANES];  // сдвинуты на col+3
+  _Alignas(32) int16_t top[BATCH_LANES];  // строка поля верха маски
+  _Alignas(32) int16_t out[BATCH_LANES];  // результат ядра по лейнам
+  uint32_t lanes;  // бит i - в лейне есть фигура
+  uint32_t oob;    // фигура уходит под пол
+  int lo, hi;      // строки поля, которые задевают фигуры
+} BatchBlock;
+
+static void block_init(BatchBlock* k) {
+  memset(k->piece, 0, sizeof(k->piece));
+  memset(k->top, 0, sizeof(k->top));
+  k->lanes = k->oob = 0;
+  k->lo = FIELD_ROWS;
+  k->hi = -1;
+}
+
+static void block_add(BatchBlock* k, int i, int id, int rotation, int row,
+                      int col) {
+  for (int d = 0; d < MASK_SIZE; ++d) {
+    unsigned bits = (unsigned)TETROMINO_ROW_BITS[id][rotation][d]
+                    << (col + BATCH_SHIFT);
+    k->piece[d][i] = (uint16_t)bits;
+    if (bits && row + d >= FIELD_ROWS) k->oob |= 1u << i;
+  }
+  k->top[i] = (int16_t)row;
+  k->lanes |= 1u << i;
+  if (row < k->lo) k->lo = row;
+  if (row + MASK_SIZE - 1 > k->hi) k->hi = row + MASK_SIZE - 1;
+  if (k->hi >= FIELD_ROWS) k->hi = FIELD_ROWS - 1;
+}
+
+static const uint16_t* block_rows(const BatchEngine* b, uint32_t base,
+                                  int r) {
+  return &b->rows[(size_t)r * b->lanes + base];
+}
+
+// collide: out[i] != 0 - фигура лейна i пересекает поле или стенки.
+// drop: out[i] - на сколько строк фигура может упасть.
+// clear: снимает полные строки в lo..hi, out[i] - сколько снято.
+// Скалярные версии считают по одной игре в лоб, как game_logic.c
+
+static void collide_scalar(const BatchEngine* b, uint32_t base,
+                           BatchBlock* k) {
+  for (int i = 0; i < BATCH_LANES; ++i) {
+    unsigned hit = 0;
+    for (int d = 0; d < MASK_SIZE; ++d) {
+      int r = k->top[i] + d;
+      if (!k->piece[d][i] || r >= FIELD_ROWS) continue;
+      unsigned row = (unsigned)block_rows(b, base, r)[i] << BATCH_SHIFT;
+      hit |= k->piece[d][i] & (row | BATCH_WALLS);
+    }
+    k->out[i] = (int16_t)hit;
+  }
+}
+
+static int fits_scalar(const BatchEngine* b, uint32_t base,
+                       const BatchBlock* k, int i, int top) {
+  for (int d = 0; d < MASK_SIZE; ++d) {
+    if (!k->piece[d][i]) continue;
+    if (top + d >= FIELD_ROWS) return 0;
+    unsigned row = (unsigned)block_rows(b, base, top + d)[i] << BATCH_SHIFT;
+    if (k->piece[d][i] & row) return 0;
+  }
+  return 1;
+}
+
+static void drop_scalar(const BatchEngine* b, uint32_t base, BatchBlock* k) {
+  for (int i = 0; i < BATCH_LANES; ++i) {
+    int dist = 0;
+    if (k->lanes & (1u << i))
+      while (fits_scalar(b, base, k, i, k->top[i] + dist + 1)) dist++;
+    k->out[i] = (int16_t)dist;
+  }
+}
+
+static void clear_scalar(BatchEngine* b, uint32_t base, BatchBlock* k) {
+  for (int i = 0; i < BATCH_LANES; ++i) {
+    int cleared = 0;
+    for (int r = k->lo; r <= k->hi; ++r) {
+      uint16_t* row = &b->rows[(size_t)r * b->lanes + base + i];
+      if (*row != FULL_ROW_BITS) continue;
+      for (int above = r; above > 0; --above)
+        b->rows[(size_t)above * b->lanes + base + i] =
+            b->rows[(size_t)(above - 1) * b->lanes + base + i];
+      b->rows[base + i] = 0;
+      cleared++;
+    }
+    k->out[i] = (int16_t)cleared;
+  }
+}
+
+#ifdef BATCH_X86
+// SIMD-версии идут по строкам lo..hi сразу для всех лейнов: строка фигуры,
+// попадающая на строку поля r, выбирается сравнением r - top с 0..3, так
+// что разные top у лейнов не требуют gather. Полная строка r снимается
+// сдвигом строк 0..r вниз с маской лейнов, где она полная; строки ниже r не
+// меняются, поэтому полнота следующих строк проверяется по текущему полю
+
+static void collide_sse2(const BatchEngine* b, uint32_t base, BatchBlock* k) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i walls = _mm_set1_epi16((short)BATCH_WALLS);
+  for (int h = 0; h < BATCH_LANES; h += 8) {
+    __m128i top = _mm_load_si128((const __m128i*)&k->top[h]);
+    __m128i p[MASK_SIZE];
+    for (int d = 0; d < MASK_SIZE; ++d)
+      p[d] = _mm_load_si128((const __m128i*)&k->piece[d][h]);
+    __m128i hit = zero;
+    for (int r = k->lo; r <= k->hi; ++r) {
+      __m128i d = _mm_sub_epi16(_mm_set1_epi16((short)r), top);
+      __m128i sel = _mm_or_si128(
+          _mm_or_si128(
+              _mm_and_si128(_mm_cmpeq_epi16(d, zero), p[0]),
+              _mm_and_si128(_mm_cmpeq_epi16(d, _mm_set1_epi16(1)), p[1])),
+          _mm_or_si128(
+              _mm_and_si128(_mm_cmpeq_epi16(d, _mm_set1_epi16(2)), p[2]),
+              _mm_and_si128(_mm_cmpeq_epi16(d, _mm_set1_epi16(3)), p[3])));
+      __m128i row =
+          _mm_loadu_si128((const __m128i*)(block_rows(b, base, r) + h));
+      row = _mm_or_si128(_mm_slli_epi16(row, BATCH_SHIFT), walls);
+      hit = _mm_or_si128(hit, _mm_and_si128(sel, row));
+    }
+    _mm_store_si128((__m128i*)&k->out[h], hit);
+  }
+}
+
+// для каждой строки маски d - первая занятая строка поля ниже неё (пол -
+// FIELD_ROWS, у пустой строки маски - заведомо дальше пола); падение -
+// минимум по d
+static void drop_sse2(const BatchEngine* b, uint32_t base, BatchBlock* k) {
+  const __m128i zero = _mm_setzero_si128();
+  for (int h = 0; h < BATCH_LANES; h += 8) {
+    __m128i top = _mm_load_si128((const __m128i*)&k->top[h]);
+    __m128i p[MASK_SIZE], first[MASK_SIZE], row_of[MASK_SIZE];
+    for (int d = 0; d < MASK_SIZE; ++d) {
+      p[d] = _mm_load_si128((const __m128i*)&k->piece[d][h]);
+      __m128i empty = _mm_cmpeq_epi16(p[d], zero);
+      first[d] = _mm_or_si128(
+          _mm_and_si128(empty, _mm_set1_epi16(FIELD_ROWS + MASK_SIZE)),
+          _mm_andnot_si128(empty, _mm_set1_epi16(FIELD_ROWS)));
+      row_of[d] = _mm_add_epi16(top, _mm_set1_epi16((short)d));
+    }
+    for (int r = FIELD_ROWS - 1; r > k->lo; --r) {
+      __m128i rv = _mm_set1_epi16((short)r);
+      __m128i row = _mm_slli_epi16(
+          _mm_loadu_si128((const __m128i*)(block_rows(b, base, r) + h)),
+          BATCH_SHIFT);
+      for (int d = 0; d < MASK_SIZE; ++d) {
+        __m128i blocked =
+            _mm_andnot_si128(_mm_cmpeq_epi16(_mm_and_si128(p[d], row), zero),
+                             _mm_cmpgt_epi16(rv, row_of[d]));
+        first[d] = _mm_or_si128(_mm_and_si128(blocked, rv),
+                                _mm_andnot_si128(blocked, first[d]));
+      }
+    }
+    __m128i dist = _mm_sub_epi16(first[0], _mm_set1_epi16(1));
+    for (int d = 1; d < MASK_SIZE; ++d)
+      dist = _mm_min_epi16(
+          dist, _mm_sub_epi16(first[d], _mm_set1_epi16((short)(d + 1))));
+    dist = _mm_sub_epi16(dist, top);
+    _mm_store_si128((__m128i*)&k->out[h], dist);
+  }
+}
+
+static void clear_sse2(BatchEngine* b, uint32_t base, BatchBlock* k) {
+  const __m128i full_row = _mm_set1_epi16(FULL_ROW_BITS);
+  for (int h = 0; h < BATCH_LANES; h += 8) {
+    __m128i cleared = _mm_setzero_si128();
+    for (int r = k->lo; r <= k->hi; ++r) {
+      __m128i* row = (__m128i*)(&b->rows[(size_t)r * b->lanes + base + h]);
+      __m128i full = _mm_cmpeq_epi16(_mm_loadu_si128(row), full_row);
+      if (!_mm_movemask_epi8(full)) continue;
+      for (int above = r; above > 0; --above) {
+        __m128i* dst =
+            (__m128i*)(&b->rows[(size_t)above * b->lanes + base + h]);
+        __m128i src = _mm_loadu_si128(dst - b->lanes / 8);
+        _mm_storeu_si128(dst, _mm_or_si128(_mm_and_si128(full, src),
+                                           _mm_andnot_si128(
+                                               full, _mm_loadu_si128(dst))));
+      }
+      __m128i* top = (__m128i*)(&b->rows[base + h]);
+      _mm_storeu_si128(top, _mm_andnot_si128(full, _mm_loadu_si128(top)));
+      cleared = _mm_sub_epi16(cleared, full);
+    }
+    _mm_store_si128((__m128i*)&k->out[h], cleared);
+  }
+}
+
+__attribute__((target("avx2"))) static void collide_avx2(
+    const BatchEngine* b, uint32_t base, BatchBlock* k) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i walls = _mm256_set1_epi16((short)BATCH_WALLS);
+  __m256i top = _mm256_load_si256((const __m256i*)k->top);
+  __m256i p[MASK_SIZE];
+  for (int d = 0; d < MASK_SIZE; ++d)
+    p[d] = _mm256_load_si256((const __m256i*)k->piece[d]);
+  __m256i hit = zero;
+  for (int r = k->lo; r <= k->hi; ++r) {
+    __m256i d = _mm256_sub_epi16(_mm256_set1_epi16((short)r), top);
+    __m256i sel = _mm256_or_si256(
+        _mm256_or_si256(
+            _mm256_and_si256(_mm256_cmpeq_epi16(d, zero), p[0]),
+            _mm256_and_si256(_mm256_cmpeq_epi16(d, _mm256_set1_epi16(1)),
+                             p[1])),
+        _mm256_or_si256(
+            _mm256_and_si256(_mm256_cmpeq_epi16(d, _mm256_set1_epi16(2)),
+                             p[2]),
+            _mm256_and_si256(_mm256_cmpeq_epi16(d, _mm256_set1_epi16(3)),
+                             p[3])));
+    __m256i row = _mm256_loadu_si256((const __m256i*)block_rows(b, base, r));
+    row = _mm256_or_si256(_mm256_slli_epi16(row, BATCH_SHIFT), walls);
+    hit = _mm256_or_si256(hit, _mm256_and_si256(sel, row));
+  }
+  _mm256_store_si256((__m256i*)k->out, hit);
+}
+
+__attribute__((target("avx2"))) static void drop_avx2(const BatchEngine* b,
+                                                      uint32_t base,
+                                                      BatchBlock* k) {
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i top = _mm256_load_si256((const __m256i*)k->top);
+  __m256i p[MASK_SIZE], first[MASK_SIZE], row_of[MASK_SIZE];
+  for (int d = 0; d < MASK_SIZE; ++d) {
+    p[d] = _mm256_load_si256((const __m256i*)k->piece[d]);
+    first[d] = _mm256_blendv_epi8(
+        _mm256_set1_epi16(FIELD_ROWS),
+        _mm256_set1_epi16(FIELD_ROWS + MASK_SIZE),
+        _mm256_cmpeq_epi16(p[d], zero));
+    row_of[d] = _mm256_add_epi16(top, _mm256_set1_epi16((short)d));
+  }
+  for (int r = FIELD_ROWS - 1; r > k->lo; --r) {
+    __m256i rv = _mm256_set1_epi16((short)r);
+    __m256i row = _mm256_slli_epi16(
+        _mm256_loadu_si256((const __m256i*)block_rows(b, base, r)),
+        BATCH_SHIFT);
+    for (int d = 0; d < MASK_SIZE; ++d) {
+      __m256i blocked = _mm256_andnot_si256(
+          _mm256_cmpeq_epi16(_mm256_and_si256(p[d], row), zero),
+          _mm256_cmpgt_epi16(rv, row_of[d]));
+      first[d] = _mm256_blendv_epi8(first[d], rv, blocked);
+    }
+  }
+  __m256i dist = _mm256_sub_epi16(first[0], _mm256_set1_epi16(1));
+  for (int d = 1; d < MASK_SIZE; ++d)
+    dist = _mm256_min_epi16(
+        dist, _mm256_sub_epi16(first[d], _mm256_set1_epi16((short)(d + 1))));
+  _mm256_store_si256((__m256i*)k->out, _mm256_sub_epi16(dist, top));
+}
+
+__attribute__((target("avx2"))) static void clear_avx2(BatchEngine* b,
+                                                       uint32_t base,
+                                                       BatchBlock* k) {
+  const __m256i full_row = _mm256_set1_epi16(FULL_ROW_BITS);
+  __m256i cleared = _mm256_setzero_si256();
+  for (int r = k->lo; r <= k->hi; ++r) {
+    __m256i* row = (__m256i*)(&b->rows[(size_t)r * b->lanes + base]);
+    __m256i full = _mm256_cmpeq_epi16(_mm256_loadu_si256(row), full_row);
+    if (!_mm256_movemask_epi8(full)) continue;
+    for (int above = r; above > 0; --above) {
+      __m256i* dst = (__m256i*)(&b->rows[(size_t)above * b->lanes + base]);
+      __m256i src = _mm256_loadu_si256(dst - b->lanes / 16);
+      _mm256_storeu_si256(
+          dst, _mm256_blendv_epi8(_mm256_loadu_si256(dst), src, full));
+    }
+    __m256i* top = (__m256i*)(&b->rows[base]);
+    _mm256_storeu_si256(top,
+                        _mm256_andnot_si256(full, _mm256_loadu_si256(top)));
+    cleared = _mm256_sub_epi16(cleared, full);
+  }
+  _mm256_store_si256((__m256i*)k->out, cleared);
+}
+#endif
+
+static void collide(const BatchEngine* b, uint32_t base, BatchBlock* k) {
+#ifdef BATCH_X86
+  if (b->path == EVAL_AVX2)
+    collide_avx2(b, base, k);
+  else if (b->path == EVAL_SSE2)
+    collide_sse2(b, base, k);
+  else
+#endif
+    collide_scalar(b, base, k);
+  for (uint32_t oob = k->oob; oob; oob &= oob - 1)
+    k->out[__builtin_ctz(oob)] = 1;
+}
+
+static void drop(const BatchEngine* b, uint32_t base, BatchBlock* k) {
+#ifdef BATCH_X86
+  if (b->path == EVAL_AVX2)
+    drop_avx2(b, base, k);
+  else if (b->path == EVAL_SSE2)
+    drop_sse2(b, base, k);
+  else
+#endif
+    drop_scalar(b, base, k);
+}
+
+static void clear(BatchEngine* b, uint32_t base, BatchBlock* k) {
+#ifdef BATCH_X86
+  if (b->path == EVAL_AVX2)
+    clear_avx2(b, base, k);
+  else if (b->path == EVAL_SSE2)
+    clear_sse2(b, base, k);
+  else
+#endif
+    clear_scalar(b, base, k);
+}
+
+static void spawn(BatchEngine* b, uint32_t g) {
+  b->pieces[g]++;
+  b->id[g] = (uint8_t)((b->pieces[g] - 1) % P_COUNT);
+  b->rotation[g] = 0;
+  b->row[g] = 0;
+  b->col[g] = SPAWN_COL;
+  b->state[g] = FALLING;
+}
+
+static void add_piece(BatchBlock* k, const BatchEngine* b, uint32_t base,
+                      int i) {
+  uint32_t g = base + (uint32_t)i;
+  block_add(k, i, b->id[g], b->rotation[g], b->row[g], b->col[g]);
+}
+
+// фиксация, снятие строк, счёт и спавн для лейнов locks, как
+// lock_active_tetromino_into_field()
+static void lock_pieces(BatchEngine* b, uint32_t base, uint32_t locks) {
+  BatchBlock k;
+  block_init(&k);
+  for (uint32_t m = locks; m; m &= m - 1) {
+    int i = __builtin_ctz(m);
+    add_piece(&k, b, base, i);
+    for (int d = 0; d < MASK_SIZE; ++d) {
+      if (!k.piece[d][i]) continue;
+      b->rows[(size_t)(k.top[i] + d) * b->lanes + base + (uint32_t)i] |=
+          (uint16_t)(k.piece[d][i] >> BATCH_SHIFT);
+    }
+  }
+  clear(b, base, &k);
+  BatchBlock spawned;
+  block_init(&spawned);
+  for (uint32_t m = locks; m; m &= m - 1) {
+    int i = __builtin_ctz(m);
+    uint32_t g = base + (uint32_t)i;
+    int cleared = k.out[i];
+    static const int32_t points[] = {0, 100, 300, 700, 1500};
+    b->lines[g] += cleared;
+    b->score[g] += points[cleared];
+    int level = b->score[g] / 600 + 1;
+    if (level > 10) level = 10;
+    if (level != b->level[g]) {
+      b->level[g] = level;
+      b->speed[g] = engine_gravity_ticks(level);
+    }
+    spawn(b, g);
+    add_piece(&spawned, b, base, i);
+  }
+  collide(b, base, &spawned);
+  for (uint32_t m = locks; m; m &= m - 1) {
+    int i = __builtin_ctz(m);
+    if (spawned.out[i]) b->state[base + (uint32_t)i] = GAME_OVER;
+  }
+}
+
+static void step_block(BatchEngine* b, uint32_t base,
+                       const uint8_t* actions) {
+  BatchBlock moves, drops;
+  block_init(&moves);
+  block_init(&drops);
+  uint32_t hard = 0;
+  for (int i = 0; i < BATCH_LANES; ++i) {
+    uint32_t g = base + (uint32_t)i;
+    if (b->state[g] != FALLING) continue;
+    int rotation = b->rotation[g], col = b->col[g];
+    switch (actions[g]) {
+      case TETRIS_VEC_LEFT:
+        col--;
+        break;
+      case TETRIS_VEC_RIGHT:
+        col++;
+        break;
+      case TETRIS_VEC_ROTATE:
+        rotation = (rotation + 1) & 3;
+        break;
+      case TETRIS_VEC_HARD_DROP:
+        hard |= 1u << i;
+        add_piece(&drops, b, base, i);
+        continue;
+      case TETRIS_VEC_SOFT_DROP:
+        add_piece(&drops, b, base, i);
+        continue;
+      default:
+        continue;
+    }
+    block_add(&moves, i, b->id[g], rotation, b->row[g], col);
+  }
+  if (moves.lanes) {
+    collide(b, base, &moves);
+    for (uint32_t m = moves.lanes; m; m &= m - 1) {
+      int i = __builtin_ctz(m);
+      if (moves.out[i]) continue;
+      uint32_t g = base + (uint32_t)i;
+      switch (actions[g]) {
+        case TETRIS_VEC_LEFT:
+          b->col[g]--;
+          break;
+        case TETRIS_VEC_RIGHT:
+          b->col[g]++;
+          break;
+        default:
+          b->rotation[g] = (b->rotation[g] + 1) & 3;
+          break;
+      }
+    }
+  }
+  uint32_t locks = 0;
+  if (drops.lanes) {
+    drop(b, base, &drops);
+    for (uint32_t m = drops.lanes; m; m &= m - 1) {
+      int i = __builtin_ctz(m);
+      uint32_t g = base + (uint32_t)i;
+      if (hard & (1u << i)) {
+        b->row[g] = (int8_t)(b->row[g] + drops.out[i]);
+        locks |= 1u << i;
+      } else if (drops.out[i]) {
+        b->row[g]++;
+      } else {
+        locks |= 1u << i;
+      }
+    }
+  }
+  if (locks) lock_pieces(b, base, locks);
+
+  // часы: как tetris_step(), в том числе сразу после спавна
+  BatchBlock falls;
+  block_init(&falls);
+  for (int i = 0; i < BATCH_LANES; ++i) {
+    uint32_t g = base + (uint32_t)i;
+    if (b->state[g] != FALLING || ++b->tick[g] < b->speed[g]) continue;
+    b->tick[g] = 0;
+    add_piece(&falls, b, base, i);
+  }
+  if (!falls.lanes) return;
+  drop(b, base, &falls);
+  locks = 0;
+  for (uint32_t m = falls.lanes; m; m &= m - 1) {
+    int i = __builtin_ctz(m);
+    if (falls.out[i])
+      b->row[base + (uint32_t)i]++;
+    else
+      locks |= 1u << i;
+  }
+  if (locks) lock_pieces(b, base, locks);
+}
+
+int batch_engine_init(BatchEngine* b, uint32_t n, EvalPath path) {
+  memset(b, 0, sizeof(*b));
+  EvalPath best = eval_best_path();
+  if (path == EVAL_AUTO || path > best) path = best;
+  b->n = n;
+  b->lanes = (n + BATCH_LANES - 1) / BATCH_LANES * BATCH_LANES;
+  b->path = path;
+  size_t lanes = b->lanes;
+  b->rows = aligned_alloc(32, lanes * FIELD_ROWS * sizeof(uint16_t));
+  b->state = calloc(lanes, 1);
+  b->id = calloc(lanes, 1);
+  b->rotation = calloc(lanes, 1);
+  b->row = calloc(lanes, 1);
+  b->col = calloc(lanes, 1);
+  b->score = calloc(lanes, sizeof(int32_t));
+  b->lines = calloc(lanes, sizeof(int32_t));
+  b->level = calloc(lanes, sizeof(int32_t));
+  b->speed = calloc(lanes, sizeof(int32_t));
+  b->tick = calloc(lanes, sizeof(int32_t));
+  b->pieces = calloc(lanes, sizeof(int32_t));
+  if (!b->rows || !b->state || !b->id || !b->rotation || !b->row ||
+      !b->col || !b->score || !b->lines || !b->level || !b->speed ||
+      !b->tick || !b->pieces) {
+    batch_engine_free(b);
+    return -1;
+  }
+  memset(b->rows, 0, lanes * FIELD_ROWS * sizeof(uint16_t));
+  for (uint32_t i = 0; i < b->lanes; ++i) {
+    batch_engine_reset(b, i);
+    if (i >= n) b->state[i] = GAME_OVER;
+  }
+  return 0;
+}
+
+void batch_engine_free(BatchEngine* b) {
+  free(b->rows);
+  free(b->state);
+  free(b->id);
+  free(b->rotation);
+  free(b->row);
+  free(b->col);
+  free(b->score);
+  free(b->lines);
+  free(b->level);
+  free(b->speed);
+  free(b->tick);
+  free(b->pieces);
+  memset(b, 0, sizeof(*b));
+}
+
+void batch_engine_reset(BatchEngine* b, uint32_t i) {
+  for (int r = 0; r < FIELD_ROWS; ++r) b->rows[(size_t)r * b->lanes + i] = 0;
+  b->score[i] = 0;
+  b->lines[i] = 0;
+  b->level[i] = 1;
+  b->speed[i] = engine_gravity_ticks(1);
+  b->tick[i] = 0;
+  b->pieces[i] = 0;
+  spawn(b, i);  // на пустом поле фигура всегда встаёт
+}
+
+void batch_engine_step(BatchEngine* b, const uint8_t* actions) {
+  for (uint32_t base = 0; base < b->lanes; base += BATCH_LANES)
+    step_block(b, base, actions);
+}
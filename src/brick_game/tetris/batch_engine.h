@@ -0,0 +1,46 @@
+#ifndef BATCH_ENGINE_H_
+#define BATCH_ENGINE_H_
+#include <stdint.h>
+
+#include "evaluate.h"
+#include "vec_env.h"
+
+// Пакетный движок: n игр с теми же правилами, что у TetrisGame, но поля
+// хранятся структурой массивов - строка r всех игр подряд. Проверка
+// коллизий, поиск полных строк и их снятие идут блоком по BATCH_LANES игр
+// в 16-битных лейнах (AVX2 - блок за одну инструкцию, SSE2 - за две),
+// остальная логика (счёт, уровень, спавн) - обычный код на каждую игру.
+// Результат побитно совпадает с движком по одной игре при тех же
+// действиях (см. тест), включая скалярный путь. Генератор фигур - только
+// цикл (RANDOMIZER_CYCLE), другие есть в TetrisVecEnv.
+
+#define BATCH_LANES 16
+
+typedef struct {
+  uint32_t n;      // игр
+  uint32_t lanes;  // n, округлённое до BATCH_LANES; лишние стоят в GAME_OVER
+  EvalPath path;
+  uint16_t* rows;  // rows[r * lanes + i], бит c - клетка (r, c) игры i
+  uint8_t* state;  // FALLING или GAME_OVER
+  uint8_t* id;     // падающая фигура, следующая - pieces % P_COUNT
+  uint8_t* rotation;
+  int8_t* row;
+  int8_t* col;
+  int32_t* score;
+  int32_t* lines;
+  int32_t* level;
+  int32_t* speed;
+  int32_t* tick;
+  int32_t* pieces;
+} BatchEngine;
+
+// 0 - готово, все игры начаты. path EVAL_AUTO - лучший доступный
+int batch_engine_init(BatchEngine* batch, uint32_t n, EvalPath path);
+void batch_engine_free(BatchEngine* batch);
+// новая партия в игре i
+void batch_engine_reset(BatchEngine* batch, uint32_t i);
+// actions[i] - TetrisVecAction для игры i, затем шаг часов, как
+// tetris_input() + tetris_step()
+void batch_engine_step(BatchEngine* batch, const uint8_t* actions);
+
+#endif
@@ -0,0 +1,106 @@
+#include "bot.h"
+
+TetrisBot* bot_create(void) {
+  TetrisBot* bot = aligned_alloc(32, (sizeof(TetrisBot) + 31) / 32 * 32);
+  if (bot) {
+    memset(bot, 0, sizeof(*bot));
+    bot->weights = EVAL_DEFAULT_WEIGHTS;
+    bot->path = EVAL_AUTO;
+  }
+  return bot;
+}
+
+void bot_destroy(TetrisBot* bot) { free(bot); }
+
+void bot_build_boards(const EngineState* e, TetrominoId id,
+                      const TetrisPlacement* moves, int count,
+                      EvalBoards* boards) {
+  uint16_t base[FIELD_ROWS];
+  for (int r = 0; r < FIELD_ROWS; ++r) base[r] = engine_row_bits(e, r);
+  for (int i = 0; i < count; ++i) {
+    uint16_t rows[FIELD_ROWS];
+    memcpy(rows, base, sizeof(rows));
+    const uint16_t* mask = TETROMINO_ROW_BITS[id][moves[i].rotation];
+    for (int r = 0; r < 4; ++r) {
+      int fr = moves[i].row + r;
+      if (mask[r] && fr >= 0 && fr < FIELD_ROWS)
+        rows[fr] |=
+            (uint16_t)(((uint32_t)mask[r] << (moves[i].col + 4)) >> 4);
+    }
+    // полные строки выкидываются, остальные оседают вниз
+    int dst = FIELD_ROWS - 1, lines = 0;
+    for (int r = FIELD_ROWS - 1; r >= 0; --r) {
+      if (rows[r] == FULL_ROW_BITS)
+        lines++;
+      else
+        boards->rows[dst--][i] = rows[r];
+    }
+    for (; dst >= 0; --dst) boards->rows[dst][i] = 0;
+    boards->lines[i] = (uint8_t)lines;
+  }
+  boards->count = count;
+}
+
+// повторяет то, что сделают Action/Left/Right/Down из спавна, и
+// проверяет, что фигура ляжет ровно в p. Только харддроп - см. bot.h
+static int reachable_by_drop(const EngineState* e, const TetrisPlacement* p) {
+  TetrominoId id = e->cur_tetromino_id;
+  int rot = e->rotation, row = e->row, col = e->col;
+  int ok = 1;
+  while (ok && rot != p->rotation) {
+    int next = (rot + 1) & 3;
+    ok = can_place_tetromino_in_field(e, id, next, row, col);
+    rot = next;
+  }
+  while (ok && col != p->col) {
+    int next = col < p->col ? col + 1 : col - 1;
+    ok = can_place_tetromino_in_field(e, id, rot, row, next);
+    col = next;
+  }
+  while (ok && can_place_tetromino_in_field(e, id, rot, row + 1, col)) row++;
+  return ok && row == p->row;
+}
+
+int bot_drop_placements(const TetrisGame* game, TetrisPlacement* out) {
+  int generated = movegen_current(game, out);
+  int count = 0;
+  for (int i = 0; i < generated; ++i)
+    if (reachable_by_drop(&game->engine, &out[i])) out[count++] = out[i];
+  return count;
+}
+
+int bot_choose(TetrisBot* bot, const TetrisGame* game, TetrisPlacement* best) {
+  if (bot->planner) {
+    long before = planner_stats(bot->planner)->children;
+    int found = planner_choose(bot->planner, game, best);
+    bot->boards_evaluated += planner_stats(bot->planner)->children - before;
+    return found;
+  }
+  const EngineState* e = &game->engine;
+  int count = bot_drop_placements(game, bot->moves);
+  if (!count) return 0;
+  bot_build_boards(e, e->cur_tetromino_id, bot->moves, count, &bot->boards);
+  eval_score_boards(&bot->boards, &bot->weights, bot->path, bot->scores);
+  bot->boards_evaluated += count;
+  int pick = 0;
+  for (int i = 1; i < count; ++i)
+    if (bot->scores[i] > bot->scores[pick]) pick = i;
+  *best = bot->moves[pick];
+  return 1;
+}
+
+int bot_play(TetrisBot* bot, TetrisGame* game) {
+  TetrisPlacement target;
+  if (!bot_choose(bot, game, &target)) return 0;
+  const EngineState* e = &game->engine;
+  for (int turns = (target.rotation - e->rotation) & 3; turns > 0; --turns)
+    tetris_input(game, Action, false);
+  while (e->col != target.col) {
+    int before = e->col;
+    tetris_input(game, e->col < target.col ? Right : Left, false);
+    if (e->col == before) break;
+  }
+  tetris_input(game, Down, false);
+  bot->moves_played++;
+  return 1;
+}
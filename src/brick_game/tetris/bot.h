@@ -0,0 +1,39 @@
+#ifndef BOT_H_
+#define BOT_H_
+#include "evaluate.h"
+#include "movegen.h"
+#include "planner.h"
+
+// автоигрок: на каждую новую фигуру перебирает размещения из movegen,
+// оценивает все получившиеся доски за один проход eval_score_boards() и
+// доводит фигуру до лучшего положения через tetris_input()
+struct TetrisBot {
+  EvalWeights weights;
+  EvalPath path;
+  long moves_played;
+  long boards_evaluated;
+  TetrisPlanner* planner;  // не NULL - ход выбирает он, бот им не владеет
+  TetrisPlacement moves[MOVEGEN_MAX_PLACEMENTS];
+  int32_t scores[EVAL_MAX_BOARDS];
+  EvalBoards boards;
+};
+
+TetrisBot* bot_create(void);
+void bot_destroy(TetrisBot* bot);
+
+// доски после фиксации фигуры id в каждом из moves (со снятыми строками),
+// moves[i] -> boards->rows[..][i]
+void bot_build_boards(const EngineState* e, TetrominoId id,
+                      const TetrisPlacement* moves, int count,
+                      EvalBoards* boards);
+// размещения текущей фигуры, до которых бот доводит поворотом, сдвигом и
+// харддропом. Подсовывания под навес через SIG_SOFT_DROP бот намеренно не
+// ищет: так ход - одна серия нажатий без ожидания тиков, а поиск и
+// планировщик перебирают меньше позиций
+int bot_drop_placements(const TetrisGame* game, TetrisPlacement* out);
+// лучшее из bot_drop_placements(); 0 если игра не в FALLING
+int bot_choose(TetrisBot* bot, const TetrisGame* game, TetrisPlacement* best);
+// ходы для одной фигуры: повороты, сдвиги, харддроп
+int bot_play(TetrisBot* bot, TetrisGame* game);
+
+#endif
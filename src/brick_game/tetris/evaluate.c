@@ -0,0 +1,273 @@
+#include "evaluate.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define EVAL_X86 1
+#endif
+
+const EvalWeights EVAL_DEFAULT_WEIGHTS = {
+    .aggregate_height = -20,
+    .holes = -300,
+    .bumpiness = -20,
+    .row_transitions = -40,
+    .col_transitions = -90,
+    .wells = -30,
+    .lines = 60,
+};
+
+EvalPath eval_best_path(void) {
+  EvalPath path = EVAL_SCALAR;
+#ifdef EVAL_X86
+  path = __builtin_cpu_supports("avx2") ? EVAL_AVX2 : EVAL_SSE2;
+#endif
+  return path;
+}
+
+const char* eval_path_name(EvalPath path) {
+  static const char* names[] = {"auto", "scalar", "sse2", "avx2"};
+  return path >= EVAL_AUTO && path <= EVAL_AVX2 ? names[path] : "?";
+}
+
+static int popcount16(unsigned x) { return __builtin_popcount(x & 0xFFFFu); }
+
+void eval_board_features(const EvalBoards* boards, int index,
+                         BoardFeatures* out) {
+  BoardFeatures f = {0};
+  unsigned cov = 0, prev = 0, w1 = 0, w2 = 0, w3 = 0;
+  for (int r = 0; r < FIELD_ROWS; ++r) {
+    unsigned row = boards->rows[r][index];
+    cov |= row;  // занятые клетки в этой строке или выше
+    f.aggregate_height += popcount16(cov);
+    f.bumpiness += popcount16((cov ^ (cov >> 1)) & 0x1FF);
+    f.holes += popcount16(cov & ~row);
+    unsigned ext = (row << 1) | 0x801;  // стенки слева и справа
+    f.row_transitions += popcount16((ext ^ (ext >> 1)) & 0x7FF);
+    if (r) f.col_transitions += popcount16(row ^ prev);
+    // открытая клетка, у которой заняты оба соседа; n_k - глубина >= k
+    unsigned w = ~cov & ((row << 1) | 1) & ((row >> 1) | 0x200) &
+                 FULL_ROW_BITS;
+    unsigned n2 = w & w1, n3 = w & w2, n4 = w & w3;
+    f.wells += popcount16(w) + popcount16(n2) + popcount16(n3) +
+               popcount16(n4);
+    w1 = w;
+    w2 = n2;
+    w3 = n3;
+    prev = row;
+  }
+  f.col_transitions += popcount16(prev ^ FULL_ROW_BITS);  // пол занят
+  f.lines = boards->lines[index];
+  *out = f;
+}
+
+static void score_scalar(const EvalBoards* boards, const EvalWeights* w,
+                         int32_t* scores) {
+  for (int i = 0; i < boards->count; ++i) {
+    BoardFeatures f;
+    eval_board_features(boards, i, &f);
+    scores[i] = w->aggregate_height * f.aggregate_height +
+                w->holes * f.holes + w->bumpiness * f.bumpiness +
+                w->row_transitions * f.row_transitions +
+                w->col_transitions * f.col_transitions + w->wells * f.wells +
+                w->lines * f.lines;
+  }
+}
+
+#ifdef EVAL_X86
+// тот же расчёт, что в eval_board_features(), по 8 доскам в 16-битных
+// лейнах; popcount - SWAR внутри лейна
+static inline __m128i popcount_sse2(__m128i x) {
+  const __m128i m55 = _mm_set1_epi16(0x5555), m33 = _mm_set1_epi16(0x3333);
+  const __m128i m0f = _mm_set1_epi16(0x0F0F), m1f = _mm_set1_epi16(0x001F);
+  x = _mm_sub_epi16(x, _mm_and_si128(_mm_srli_epi16(x, 1), m55));
+  x = _mm_add_epi16(_mm_and_si128(x, m33),
+                    _mm_and_si128(_mm_srli_epi16(x, 2), m33));
+  x = _mm_and_si128(_mm_add_epi16(x, _mm_srli_epi16(x, 4)), m0f);
+  return _mm_and_si128(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), m1f);
+}
+
+static void score_sse2(const EvalBoards* boards, const EvalWeights* w,
+                       int32_t* scores) {
+  const __m128i zero = _mm_setzero_si128(), one = _mm_set1_epi16(1);
+  const __m128i m1ff = _mm_set1_epi16(0x1FF), m200 = _mm_set1_epi16(0x200);
+  const __m128i m3ff = _mm_set1_epi16(FULL_ROW_BITS);
+  const __m128i m7ff = _mm_set1_epi16(0x7FF), m801 = _mm_set1_epi16(0x801);
+  const __m128i w01 = _mm_set_epi16(w->holes, w->aggregate_height, w->holes,
+                                    w->aggregate_height, w->holes,
+                                    w->aggregate_height, w->holes,
+                                    w->aggregate_height);
+  const __m128i w23 = _mm_set_epi16(
+      w->row_transitions, w->bumpiness, w->row_transitions, w->bumpiness,
+      w->row_transitions, w->bumpiness, w->row_transitions, w->bumpiness);
+  const __m128i w45 = _mm_set_epi16(w->wells, w->col_transitions, w->wells,
+                                    w->col_transitions, w->wells,
+                                    w->col_transitions, w->wells,
+                                    w->col_transitions);
+  const __m128i w6 = _mm_set_epi16(0, w->lines, 0, w->lines, 0, w->lines, 0,
+                                   w->lines);
+  for (int base = 0; base < boards->count; base += 8) {
+    __m128i cov = zero, prev = zero, w1 = zero, w2 = zero, w3 = zero;
+    __m128i agg = zero, holes = zero, bump = zero, rt = zero, ct = zero;
+    __m128i wells = zero;
+    for (int r = 0; r < FIELD_ROWS; ++r) {
+      __m128i row = _mm_loadu_si128((const __m128i*)&boards->rows[r][base]);
+      cov = _mm_or_si128(cov, row);
+      agg = _mm_add_epi16(agg, popcount_sse2(cov));
+      bump = _mm_add_epi16(
+          bump, popcount_sse2(_mm_and_si128(
+                    _mm_xor_si128(cov, _mm_srli_epi16(cov, 1)), m1ff)));
+      holes = _mm_add_epi16(holes, popcount_sse2(_mm_andnot_si128(row, cov)));
+      __m128i ext = _mm_or_si128(_mm_slli_epi16(row, 1), m801);
+      rt = _mm_add_epi16(rt, popcount_sse2(_mm_and_si128(
+                                 _mm_xor_si128(ext, _mm_srli_epi16(ext, 1)),
+                                 m7ff)));
+      if (r) ct = _mm_add_epi16(ct, popcount_sse2(_mm_xor_si128(row, prev)));
+      __m128i wv = _mm_and_si128(
+          _mm_and_si128(_mm_or_si128(_mm_slli_epi16(row, 1), one),
+                        _mm_or_si128(_mm_srli_epi16(row, 1), m200)),
+          m3ff);
+      wv = _mm_andnot_si128(cov, wv);
+      __m128i n2 = _mm_and_si128(wv, w1), n3 = _mm_and_si128(wv, w2);
+      __m128i n4 = _mm_and_si128(wv, w3);
+      wells = _mm_add_epi16(
+          wells, _mm_add_epi16(
+                     _mm_add_epi16(popcount_sse2(wv), popcount_sse2(n2)),
+                     _mm_add_epi16(popcount_sse2(n3), popcount_sse2(n4))));
+      w1 = wv;
+      w2 = n2;
+      w3 = n3;
+      prev = row;
+    }
+    ct = _mm_add_epi16(ct, popcount_sse2(_mm_xor_si128(prev, m3ff)));
+    __m128i lines = _mm_unpacklo_epi8(
+        _mm_loadl_epi64((const __m128i*)&boards->lines[base]), zero);
+    // пары признаков перемножаются с весами и складываются в int32
+    __m128i lo = _mm_add_epi32(
+        _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(agg, holes), w01),
+                      _mm_madd_epi16(_mm_unpacklo_epi16(bump, rt), w23)),
+        _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(ct, wells), w45),
+                      _mm_madd_epi16(_mm_unpacklo_epi16(lines, zero), w6)));
+    __m128i hi = _mm_add_epi32(
+        _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(agg, holes), w01),
+                      _mm_madd_epi16(_mm_unpackhi_epi16(bump, rt), w23)),
+        _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(ct, wells), w45),
+                      _mm_madd_epi16(_mm_unpackhi_epi16(lines, zero), w6)));
+    int32_t block[8];
+    _mm_storeu_si128((__m128i*)&block[0], lo);
+    _mm_storeu_si128((__m128i*)&block[4], hi);
+    int n = boards->count - base < 8 ? boards->count - base : 8;
+    memcpy(&scores[base], block, (size_t)n * sizeof(block[0]));
+  }
+}
+
+__attribute__((target("avx2"))) static inline __m256i popcount_avx2(
+    __m256i x) {
+  const __m256i m55 = _mm256_set1_epi16(0x5555);
+  const __m256i m33 = _mm256_set1_epi16(0x3333);
+  const __m256i m0f = _mm256_set1_epi16(0x0F0F);
+  const __m256i m1f = _mm256_set1_epi16(0x001F);
+  x = _mm256_sub_epi16(x, _mm256_and_si256(_mm256_srli_epi16(x, 1), m55));
+  x = _mm256_add_epi16(_mm256_and_si256(x, m33),
+                       _mm256_and_si256(_mm256_srli_epi16(x, 2), m33));
+  x = _mm256_and_si256(_mm256_add_epi16(x, _mm256_srli_epi16(x, 4)), m0f);
+  return _mm256_and_si256(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), m1f);
+}
+
+__attribute__((target("avx2"))) static void score_avx2(
+    const EvalBoards* boards, const EvalWeights* w, int32_t* scores) {
+  const __m256i zero = _mm256_setzero_si256(), one = _mm256_set1_epi16(1);
+  const __m256i m1ff = _mm256_set1_epi16(0x1FF);
+  const __m256i m200 = _mm256_set1_epi16(0x200);
+  const __m256i m3ff = _mm256_set1_epi16(FULL_ROW_BITS);
+  const __m256i m7ff = _mm256_set1_epi16(0x7FF);
+  const __m256i m801 = _mm256_set1_epi16(0x801);
+  const __m256i w01 = _mm256_set1_epi32(
+      (int32_t)((uint32_t)(uint16_t)w->holes << 16 |
+                (uint16_t)w->aggregate_height));
+  const __m256i w23 = _mm256_set1_epi32(
+      (int32_t)((uint32_t)(uint16_t)w->row_transitions << 16 |
+                (uint16_t)w->bumpiness));
+  const __m256i w45 = _mm256_set1_epi32((int32_t)(
+      (uint32_t)(uint16_t)w->wells << 16 | (uint16_t)w->col_transitions));
+  const __m256i w6 = _mm256_set1_epi32((int32_t)(uint16_t)w->lines);
+  for (int base = 0; base < boards->count; base += EVAL_LANES) {
+    __m256i cov = zero, prev = zero, w1 = zero, w2 = zero, w3 = zero;
+    __m256i agg = zero, holes = zero, bump = zero, rt = zero, ct = zero;
+    __m256i wells = zero;
+    for (int r = 0; r < FIELD_ROWS; ++r) {
+      __m256i row =
+          _mm256_loadu_si256((const __m256i*)&boards->rows[r][base]);
+      cov = _mm256_or_si256(cov, row);
+      agg = _mm256_add_epi16(agg, popcount_avx2(cov));
+      bump = _mm256_add_epi16(
+          bump, popcount_avx2(_mm256_and_si256(
+                    _mm256_xor_si256(cov, _mm256_srli_epi16(cov, 1)), m1ff)));
+      holes = _mm256_add_epi16(holes,
+                               popcount_avx2(_mm256_andnot_si256(row, cov)));
+      __m256i ext = _mm256_or_si256(_mm256_slli_epi16(row, 1), m801);
+      rt = _mm256_add_epi16(
+          rt, popcount_avx2(_mm256_and_si256(
+                  _mm256_xor_si256(ext, _mm256_srli_epi16(ext, 1)), m7ff)));
+      if (r)
+        ct = _mm256_add_epi16(ct,
+                              popcount_avx2(_mm256_xor_si256(row, prev)));
+      __m256i wv = _mm256_and_si256(
+          _mm256_and_si256(_mm256_or_si256(_mm256_slli_epi16(row, 1), one),
+                           _mm256_or_si256(_mm256_srli_epi16(row, 1), m200)),
+          m3ff);
+      wv = _mm256_andnot_si256(cov, wv);
+      __m256i n2 = _mm256_and_si256(wv, w1), n3 = _mm256_and_si256(wv, w2);
+      __m256i n4 = _mm256_and_si256(wv, w3);
+      wells = _mm256_add_epi16(
+          wells,
+          _mm256_add_epi16(
+              _mm256_add_epi16(popcount_avx2(wv), popcount_avx2(n2)),
+              _mm256_add_epi16(popcount_avx2(n3), popcount_avx2(n4))));
+      w1 = wv;
+      w2 = n2;
+      w3 = n3;
+      prev = row;
+    }
+    ct = _mm256_add_epi16(ct, popcount_avx2(_mm256_xor_si256(prev, m3ff)));
+    __m256i lines = _mm256_cvtepu8_epi16(
+        _mm_loadu_si128((const __m128i*)&boards->lines[base]));
+    // unpack работает внутри 128-битных половин: lo - доски 0-3 и 8-11,
+    // hi - 4-7 и 12-15
+    __m256i lo = _mm256_add_epi32(
+        _mm256_add_epi32(
+            _mm256_madd_epi16(_mm256_unpacklo_epi16(agg, holes), w01),
+            _mm256_madd_epi16(_mm256_unpacklo_epi16(bump, rt), w23)),
+        _mm256_add_epi32(
+            _mm256_madd_epi16(_mm256_unpacklo_epi16(ct, wells), w45),
+            _mm256_madd_epi16(_mm256_unpacklo_epi16(lines, zero), w6)));
+    __m256i hi = _mm256_add_epi32(
+        _mm256_add_epi32(
+            _mm256_madd_epi16(_mm256_unpackhi_epi16(agg, holes), w01),
+            _mm256_madd_epi16(_mm256_unpackhi_epi16(bump, rt), w23)),
+        _mm256_add_epi32(
+            _mm256_madd_epi16(_mm256_unpackhi_epi16(ct, wells), w45),
+            _mm256_madd_epi16(_mm256_unpackhi_epi16(lines, zero), w6)));
+    int32_t block[EVAL_LANES];
+    _mm256_storeu_si256((__m256i*)&block[0],
+                        _mm256_permute2x128_si256(lo, hi, 0x20));
+    _mm256_storeu_si256((__m256i*)&block[8],
+                        _mm256_permute2x128_si256(lo, hi, 0x31));
+    int n = boards->count - base < EVAL_LANES ? boards->count - base
+                                              : EVAL_LANES;
+    memcpy(&scores[base], block, (size_t)n * sizeof(block[0]));
+  }
+}
+#endif
+
+void eval_score_boards(const EvalBoards* boards, const EvalWeights* weights,
+                       EvalPath path, int32_t* scores) {
+  EvalPath best = eval_best_path();
+  if (path == EVAL_AUTO || path > best) path = best;
+#ifdef EVAL_X86
+  if (path == EVAL_AVX2)
+    score_avx2(boards, weights, scores);
+  else if (path == EVAL_SSE2)
+    score_sse2(boards, weights, scores);
+  else
+#endif
+    score_scalar(boards, weights, scores);
+}
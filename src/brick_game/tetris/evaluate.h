@@ -0,0 +1,50 @@
+#ifndef EVALUATE_H_
+#define EVALUATE_H_
+#include "game_logic.h"
+#include "movegen.h"
+
+#define EVAL_LANES 16  // ширина блока: 16 досок по uint16_t в регистре AVX2
+#define EVAL_MAX_BOARDS MOVEGEN_MAX_PLACEMENTS
+
+typedef enum { EVAL_AUTO = 0, EVAL_SCALAR, EVAL_SSE2, EVAL_AVX2 } EvalPath;
+
+// признаки доски в духе Dellacherie, все считаются по строкам-битмаскам
+typedef struct {
+  int aggregate_height;  // сумма высот колонок
+  int holes;             // пустые клетки под занятыми
+  int bumpiness;         // сумма |h[c] - h[c+1]|
+  int row_transitions;   // смены пусто/занято вдоль строк, стенки заняты
+  int col_transitions;   // то же вдоль колонок, пол занят
+  int wells;             // открытые колодцы: клетка на глубине d даёт min(d,4)
+  int lines;             // сколько строк сняло размещение
+} BoardFeatures;
+
+typedef struct {
+  int16_t aggregate_height;
+  int16_t holes;
+  int16_t bumpiness;
+  int16_t row_transitions;
+  int16_t col_transitions;
+  int16_t wells;
+  int16_t lines;
+} EvalWeights;
+
+// кандидаты в виде structure-of-arrays: rows[r][i] - строка r доски i,
+// так блок из EVAL_LANES досок читается одной загрузкой на строку
+typedef struct {
+  int count;
+  _Alignas(32) uint16_t rows[FIELD_ROWS][EVAL_MAX_BOARDS];
+  uint8_t lines[EVAL_MAX_BOARDS];
+} EvalBoards;
+
+extern const EvalWeights EVAL_DEFAULT_WEIGHTS;
+
+EvalPath eval_best_path(void);
+const char* eval_path_name(EvalPath path);
+void eval_board_features(const EvalBoards* boards, int index,
+                         BoardFeatures* out);
+// очки всех boards->count досок за один проход, scores[i] для доски i
+void eval_score_boards(const EvalBoards* boards, const EvalWeights* weights,
+                       EvalPath path, int32_t* scores);
+
+#endif
@@ -0,0 +1,64 @@
+#define _POSIX_C_SOURCE 200809L
+#include "game_clock.h"
+
+#include <math.h>
+#include <time.h>
+
+int64_t game_clock_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void game_clock_init(GameClock* clock, int64_t step_ns, int64_t now_ns) {
+  clock->step_ns = step_ns > 0 ? step_ns : 1;
+  clock->last_ns = now_ns;
+  clock->accumulator_ns = 0;
+  clock->stats = (GameClockStats){0};
+}
+
+static void record_lateness(GameClockStats* s, int64_t late_ns) {
+  s->steps++;
+  if (late_ns > s->late_max_ns) s->late_max_ns = late_ns;
+  double delta = (double)late_ns - s->late_mean_ns;
+  s->late_mean_ns += delta / (double)s->steps;
+  s->late_m2 += delta * ((double)late_ns - s->late_mean_ns);
+}
+
+int game_clock_advance(GameClock* clock, int64_t now_ns) {
+  if (now_ns > clock->last_ns) {
+    clock->accumulator_ns += now_ns - clock->last_ns;
+    clock->last_ns = now_ns;
+  }
+  int steps = 0;
+  while (clock->accumulator_ns >= clock->step_ns &&
+         steps < GAME_CLOCK_MAX_CATCHUP) {
+    clock->accumulator_ns -= clock->step_ns;
+    // остаток после шага = сколько времени назад он должен был случиться
+    record_lateness(&clock->stats, clock->accumulator_ns);
+    steps++;
+  }
+  if (clock->accumulator_ns >= clock->step_ns) {
+    clock->stats.dropped += clock->accumulator_ns / clock->step_ns;
+    clock->accumulator_ns %= clock->step_ns;
+  }
+  return steps;
+}
+
+int64_t game_clock_deadline_ns(const GameClock* clock) {
+  return clock->last_ns - clock->accumulator_ns + clock->step_ns;
+}
+
+int64_t game_clock_wait_ns(const GameClock* clock, int64_t now_ns) {
+  int64_t due = game_clock_deadline_ns(clock);
+  return due > now_ns ? due - now_ns : 0;
+}
+
+void game_clock_rebase(GameClock* clock, int64_t now_ns) {
+  if (now_ns > clock->last_ns) clock->last_ns = now_ns;
+}
+
+double game_clock_jitter_ns(const GameClockStats* stats) {
+  return stats->steps > 1 ? sqrt(stats->late_m2 / (double)(stats->steps - 1))
+                          : 0.0;
+}
@@ -0,0 +1,42 @@
+#ifndef GAME_CLOCK_H_
+#define GAME_CLOCK_H_
+#include <stdint.h>
+
+// Часы симуляции с фиксированным шагом на CLOCK_MONOTONIC. Прошедшее
+// реальное время копится в accumulator, game_clock_advance() отдаёт,
+// сколько целых шагов пора выполнить, остаток переходит дальше. Так
+// скорость игры не зависит ни от ввода, ни от частоты отрисовки.
+// Отставание больше GAME_CLOCK_MAX_CATCHUP шагов (терминал завис,
+// процесс был остановлен) выбрасывается, а не догоняется рывком.
+
+#define GAME_CLOCK_MAX_CATCHUP 8
+
+typedef struct {
+  long steps;           // выполнено шагов
+  long dropped;         // выброшено при отставании
+  int64_t late_max_ns;  // максимальное опоздание шага
+  double late_mean_ns;  // среднее опоздание
+  double late_m2;       // сумма квадратов отклонений (Welford)
+} GameClockStats;
+
+typedef struct {
+  int64_t step_ns;
+  int64_t last_ns;         // момент прошлого game_clock_advance()
+  int64_t accumulator_ns;  // накопленное и ещё не отданное шагами время
+  GameClockStats stats;
+} GameClock;
+
+int64_t game_clock_now_ns(void);
+void game_clock_init(GameClock* clock, int64_t step_ns, int64_t now_ns);
+// число шагов, которые пора выполнить к моменту now_ns
+int game_clock_advance(GameClock* clock, int64_t now_ns);
+// сколько ждать до следующего шага, для таймаута ожидания ввода
+int64_t game_clock_wait_ns(const GameClock* clock, int64_t now_ns);
+// момент следующего шага по CLOCK_MONOTONIC
+int64_t game_clock_deadline_ns(const GameClock* clock);
+// время с прошлого advance не идёт в зачёт (игра стояла на паузе)
+void game_clock_rebase(GameClock* clock, int64_t now_ns);
+// стандартное отклонение опоздания шага (джиттер)
+double game_clock_jitter_ns(const GameClockStats* stats);
+
+#endif
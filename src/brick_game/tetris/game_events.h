@@ -0,0 +1,65 @@
+#ifndef GAME_EVENTS_H_
+#define GAME_EVENTS_H_
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "game_interface.h"
+
+// Поток событий движка: вместо того чтобы сравнивать поле из tetris_query()
+// целиком, потребитель (отрисовка, запись партии, сеть) получает короткие
+// типизированные события прямо из действий FSM. События пишутся в кольцо,
+// которое выделяет вызывающий; без кольца движок не делает ничего лишнего.
+// Кольцо читается в том же потоке, что двигает игру.
+
+typedef enum {
+  TETRIS_EVENT_RESET = 0,     // новая партия или tetris_restore(): всё заново
+  TETRIS_EVENT_SPAWN,         // piece: новая фигура, next - следующая
+  TETRIS_EVENT_MOVE,          // piece: позиция после сдвига или падения
+  TETRIS_EVENT_ROTATE,        // piece
+  TETRIS_EVENT_LOCK,          // piece: где фигура вписана в поле
+  TETRIS_EVENT_ROWS_CLEARED,  // rows
+  TETRIS_EVENT_SCORE,         // value: новый счёт
+  TETRIS_EVENT_LEVEL,         // value: новый уровень
+  TETRIS_EVENT_STATE,         // state: смена состояния FSM за вызов API
+} TetrisEventType;
+
+typedef struct {
+  uint8_t type;  // TetrisEventType
+  union {
+    struct {
+      uint8_t id;  // TetrominoId
+      uint8_t rotation;
+      int8_t row;  // верхний левый угол маски 4на4
+      int8_t col;
+      uint8_t next;  // только SPAWN
+    } piece;
+    struct {
+      uint8_t count;
+      uint32_t mask;  // бит r - снята строка r (номера до сдвига)
+    } rows;
+    int32_t value;
+    struct {
+      uint8_t from;  // tetrisState_t
+      uint8_t to;
+    } state;
+  };
+} TetrisEvent;
+
+typedef struct {
+  TetrisEvent* events;
+  uint32_t mask;  // ёмкость - 1
+  uint32_t head;  // пишет движок
+  uint32_t tail;  // читает потребитель
+  // не влезло в кольцо; потребитель сбрасывает счётчик и берёт картину
+  // из tetris_query() целиком
+  uint32_t dropped;
+} TetrisEventRing;
+
+// capacity - степень двойки; -1 - нет
+int tetris_event_ring_init(TetrisEventRing* ring, TetrisEvent* storage,
+                           uint32_t capacity);
+// NULL отключает события
+void tetris_set_event_ring(TetrisGame* game, TetrisEventRing* ring);
+bool tetris_event_pop(TetrisEventRing* ring, TetrisEvent* event);
+
+#endif
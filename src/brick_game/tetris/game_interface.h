@@ -16,6 +16,10 @@ typedef enum {
   Action
 } UserAction_t;
 
+// один tetris_step()/updateCurrentState() - столько реального времени;
+// GameInfo_t.speed - задержка гравитации в таких шагах
+#define TETRIS_TICK_MS 50
+
 typedef struct {
   int** field;
   int** next;
@@ -30,4 +34,30 @@ void userInput(UserAction_t action, bool hold);
 
 GameInfo_t updateCurrentState();
 
+// Реентерабельный API: каждый вызов работает со своим экземпляром игры,
+// разные экземпляры можно вести из разных потоков одновременно.
+// userInput()/updateCurrentState() работают со встроенным экземпляром.
+typedef struct TetrisGame TetrisGame;
+
+TetrisGame* tetris_create(void);
+void tetris_destroy(TetrisGame* game);
+// рекорд в SCORE_FILE_PATH читает и пишет только встроенный экземпляр,
+// созданным это включается здесь
+void tetris_set_persistent(TetrisGame* game, bool persistent);
+void tetris_input(TetrisGame* game, UserAction_t action, bool hold);
+void tetris_step(TetrisGame* game);
+GameInfo_t tetris_query(TetrisGame* game);
+// tetris_query() плюс что изменилось с прошлого запроса того же
+// экземпляра: пересобираются только грязные строки, неизменный кадр
+// ничего не копирует
+typedef struct {
+  GameInfo_t info;
+  unsigned dirty_rows;  // бит r: info.field[r] мог измениться
+  bool next_changed;    // info.next перерисован
+} TetrisFrameInfo;
+TetrisFrameInfo tetris_query_frame(TetrisGame* game);
+// экземпляр за userInput()/updateCurrentState(): фронтенд может
+// перерисовать его через tetris_query(), не двигая игру
+TetrisGame* tetris_default_game(void);
+
 #endif
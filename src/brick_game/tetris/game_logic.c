@@ -1,30 +1,82 @@
 #include "game_logic.h"
 
-static EngineState engine;
-static tetrisState_t state = START;
-static bool high_score_loaded = false;
-
-static void load_high_score(void);
-static void store_high_score(void);
-static action fsm_table[NUM_STATES][NUM_SIGNALS];
-static void dispatch(signals sig) {
-  action a = fsm_table[state][sig];
-  if (a) a();
-}
-
-static void spawn_next_tetromino(void);
-static void move_left(void);
-static void move_right(void);
-static void move_down(void);
-static void rotate(void);
-static void exit_game(void);
-static void fall(void);
-static void start_game(void);
-static void toggle_pause(void);
-static void drop_figure(void);
-static void clear_full_rows_and_count_score(void);
-
-static action fsm_table[NUM_STATES][NUM_SIGNALS] = {
+#include "bot.h"
+#include "replay.h"
+#include "score_writer.h"
+
+// инстанс для userInput()/updateCurrentState()
+static TetrisGame default_game = {.state = START, .persistent = true};
+
+// задержка падения на уровнях 1..10 в реальном времени, в шаги
+// TETRIS_TICK_MS переводится через engine_gravity_ticks()
+static const int GRAVITY_MS[] = {600, 550, 500, 450, 400,
+                                 350, 300, 250, 200, 150};
+
+int engine_gravity_ticks(int level) {
+  int ticks = GRAVITY_MS[level - 1] / TETRIS_TICK_MS;
+  return ticks > 0 ? ticks : 1;
+}
+
+static void load_high_score(TetrisGame* g);
+static void store_high_score(TetrisGame* g);
+
+static void emit(TetrisGame* g, TetrisEvent event) {
+  TetrisEventRing* ring = g->events;
+  if (ring->head - ring->tail > ring->mask) {
+    ring->dropped++;
+    return;
+  }
+  ring->events[ring->head++ & ring->mask] = event;
+}
+static void emit_piece(TetrisGame* g, TetrisEventType type) {
+  if (!g->events) return;
+  const EngineState* e = &g->engine;
+  TetrisEvent event = {.type = (uint8_t)type};
+  event.piece.id = (uint8_t)e->cur_tetromino_id;
+  event.piece.rotation = (uint8_t)e->rotation;
+  event.piece.row = (int8_t)e->row;
+  event.piece.col = (int8_t)e->col;
+  event.piece.next = (uint8_t)e->next_tetromino_id;
+  emit(g, event);
+}
+static void emit_value(TetrisGame* g, TetrisEventType type, int value) {
+  if (!g->events) return;
+  TetrisEvent event = {.type = (uint8_t)type};
+  event.value = value;
+  emit(g, event);
+}
+// внутренние LOCK и SPAWN проходят за один вызов, наружу видна только
+// итоговая смена состояния
+static void emit_transition(TetrisGame* g, tetrisState_t from) {
+  if (!g->events || g->state == from) return;
+  TetrisEvent event = {.type = TETRIS_EVENT_STATE};
+  event.state.from = (uint8_t)from;
+  event.state.to = (uint8_t)g->state;
+  emit(g, event);
+}
+
+static const action fsm_table[NUM_STATES][NUM_SIGNALS];
+static void dispatch(TetrisGame* g, signals sig) {
+  action a = fsm_table[g->state][sig];
+  if (!a) return;
+  tetrisState_t from = g->state;
+  a(g);
+  emit_transition(g, from);
+}
+
+static void spawn_next_tetromino(TetrisGame* g);
+static void move_left(TetrisGame* g);
+static void move_right(TetrisGame* g);
+static void move_down(TetrisGame* g);
+static void rotate(TetrisGame* g);
+static void exit_game(TetrisGame* g);
+static void fall(TetrisGame* g);
+static void start_game(TetrisGame* g);
+static void toggle_pause(TetrisGame* g);
+static void drop_figure(TetrisGame* g);
+static void clear_full_rows_and_count_score(TetrisGame* g);
+
+static const action fsm_table[NUM_STATES][NUM_SIGNALS] = {
     {start_game, NULL, NULL, NULL, NULL, NULL, toggle_pause, exit_game, NULL,
      NULL},  // START
     {start_game, NULL, NULL, NULL, NULL, NULL, toggle_pause, exit_game, NULL,
@@ -39,58 +91,96 @@ static action fsm_table[NUM_STATES][NUM_SIGNALS] = {
      NULL}  // PAUSE
 };
 
-static void load_high_score(void) {
+static void load_high_score(TetrisGame* g) {
+  score_writer_flush();  // другая игра процесса могла ещё не дописать
   FILE* file = fopen(SCORE_FILE_PATH, "r");
   int stored = 0;
   if (!file) {
-    engine.high_score = 0;
-    store_high_score();
+    g->engine.high_score = 0;
+    store_high_score(g);
   } else {
     if (fscanf(file, "%d", &stored) != 1 || stored < 0) stored = 0;
     fclose(file);
-    engine.high_score = stored;
+    g->engine.high_score = stored;
   }
 }
 
-static void store_high_score(void) {
-  FILE* file = fopen(SCORE_FILE_PATH, "w");
-  if (file) {
-    fprintf(file, "%d\n", engine.high_score);
-    fclose(file);
-  }
+// вызывается при каждом новом рекорде, в том числе из фиксации фигуры,
+// поэтому сам файл пишет фоновый поток
+static void store_high_score(TetrisGame* g) {
+  if (!g->persistent) return;
+  score_writer_submit(SCORE_FILE_PATH, g->engine.high_score);
 }
 
-static void init_rows() {
-  for (int r = 0; r < FIELD_ROWS; ++r) {
-    engine.field_rows[r] = engine.field[r];
-    engine.frame_rows[r] = engine.frame[r];
-  }
+static void init_rows(TetrisGame* g) {
+  for (int r = 0; r < FIELD_ROWS; ++r) g->frame_rows[r] = g->frame[r];
+  for (int r = 0; r < 4; ++r) g->next_rows[r] = g->next_tetromino_preview[r];
+}
+static void clear_next(TetrisGame* g) {
   for (int r = 0; r < 4; ++r)
-    engine.next_rows[r] = engine.next_tetromino_preview[r];
+    memset(g->next_tetromino_preview[r], 0,
+           sizeof(g->next_tetromino_preview[r]));
+  g->preview_id = -1;
+}
+
+_Static_assert(RANDOMIZER_PIECES == P_COUNT, "randomizer piece count");
+
+// доливает очередь до полной одной пачкой, кольцо режется максимум на два
+// куска
+static void refill_queue(EngineState* e) {
+  int tail = (e->queue_head + e->queue_len) & (TETRIS_QUEUE_SIZE - 1);
+  int n = TETRIS_QUEUE_SIZE - e->queue_len;
+  int first = TETRIS_QUEUE_SIZE - tail < n ? TETRIS_QUEUE_SIZE - tail : n;
+  randomizer_fill(&e->randomizer, e->queue + tail, first);
+  randomizer_fill(&e->randomizer, e->queue, n - first);
+  e->queue_len = TETRIS_QUEUE_SIZE;
+  e->next_tetromino_id = (TetrominoId)e->queue[e->queue_head];
 }
-static void clear_field(int a[FIELD_ROWS][FIELD_COLS]) {
-  for (int r = 0; r < FIELD_ROWS; ++r) memset(a[r], 0, sizeof(a[r]));
+
+static void reset_state(TetrisGame* g) {
+  EngineState* e = &g->engine;
+  int saved_high = e->high_score;
+  Randomizer randomizer = e->randomizer;
+  memset(e, 0, sizeof(*e));
+  init_rows(g);
+  g->overlay_valid = false;
+  clear_next(g);
+  e->level = 1;
+  e->speed = engine_gravity_ticks(1);
+  e->tick = 0;
+  e->high_score = saved_high;
+  // генератор начинает партию заново с того же seed
+  randomizer_seed(&e->randomizer, (RandomizerKind)randomizer.kind,
+                  randomizer.seed);
+  refill_queue(e);
 }
-static void clear_next() {
-  for (int r = 0; r < 4; ++r)
-    memset(engine.next_tetromino_preview[r], 0,
-           sizeof(engine.next_tetromino_preview[r]));
-}
-
-static void reset_state() {
-  int saved_high = engine.high_score;
-  memset(&engine, 0, sizeof(engine));
-  init_rows();
-  clear_field(engine.field);
-  clear_field(engine.frame);
-  clear_next();
-  engine.level = 1;
-  engine.speed = 12;
-  engine.tick = 0;
-  engine.next_gen_counter = 0;
-  engine.next_tetromino_id = (TetrominoId)0;
-  engine.high_score = saved_high;
+#ifdef TETRIS_BITBOARD
+static int is_cell_filled_in_rotated_mask(TetrominoId id, int rotation, int row,
+                                          int col) {
+  return (TETROMINO_ROW_BITS[id][rotation][row] >> col) & 1;
 }
+int can_place_tetromino_in_field(
+    const EngineState* e, TetrominoId id, int rot, int row,
+    int col) {  // та же проверка, но строка маски сдвигается на col и
+                // накладывается на строку поля со стенками одним AND
+  // фигура целиком за стенкой; заодно сдвиг ниже не уходит за 0..31
+  if (col < -MASK_SIZE || col > FIELD_COLS) return 0;
+  const uint16_t* mask = TETROMINO_ROW_BITS[id][rot];
+  int can_place = 1;
+  for (int r = 0; r < 4 && can_place; ++r) {
+    if (!mask[r]) continue;
+    int field_row = row + r;
+    if (field_row < 0 || field_row >= FIELD_ROWS) {
+      can_place = 0;
+    } else {
+      uint32_t piece = (uint32_t)mask[r] << (col + 4);
+      uint32_t walls = ((uint32_t)e->field_bits[field_row] << 4) | WALL_BITS;
+      if (piece & walls) can_place = 0;
+    }
+  }
+  return can_place;
+}
+#else
 static int is_cell_filled_in_rotated_mask(
     TetrominoId id, int rotation, int row,
     int col) {  // функция проверяет будет ли занята клетка [r, c] в массиве
@@ -110,8 +200,8 @@ static int is_cell_filled_in_rotated_mask(
   return TETROMINO_MASKS[id][src_row]
                         [src_col];  // вернет 1 если клетка занята, 0 если нет
 }
-static int can_place_tetromino_in_field(
-    TetrominoId id, int rot, int row,
+int can_place_tetromino_in_field(
+    const EngineState* e, TetrominoId id, int rot, int row,
     int col) {  // проверяет можно ли поставить фигуру на главном поле, row, col
                 // - позиция на поле, координаты верхнего левого угла 4на4 маски
                 // фигуры
@@ -127,7 +217,7 @@ static int can_place_tetromino_in_field(
           field_col >= FIELD_COLS) {
         can_place =
             0;  // если фигура выходит за границы то сразу 0 - нельзя поставить
-      } else if (engine.field[field_row][field_col]) {
+      } else if (e->field[field_row][field_col]) {
         can_place = 0;  // если в этой точке на поле что-то есть то тоже сразу 0
                         // - нельзя поставить
       }
@@ -135,207 +225,496 @@ static int can_place_tetromino_in_field(
   }
   return can_place;
 }
+#endif
 
-static void update_frame_overlay() {
-  for (int r = 0; r < FIELD_ROWS; ++r)
-    memcpy(engine.frame[r], engine.field[r],
-           sizeof(engine.frame[r]));  // копирует поле в фрейм
+#define ALL_ROWS ((1u << FIELD_ROWS) - 1)
+
+// строки поля, которые задевает фигура
+static uint32_t piece_rows(TetrominoId id, int rotation, int row) {
+  uint32_t rows = 0;
+  for (int r = 0; r < 4; ++r)
+    if (TETROMINO_ROW_BITS[id][rotation][r] && row + r >= 0 &&
+        row + r < FIELD_ROWS)
+      rows |= 1u << (row + r);
+  return rows;
+}
+
+// возвращает строки frame, которые могли измениться; 0 - кадр прежний и
+// ничего не копировалось
+static uint32_t update_frame_overlay(TetrisGame* g) {
+  const EngineState* e = &g->engine;
+  uint32_t dirty = ALL_ROWS;
+  if (g->overlay_valid) {
+    dirty = g->field_dirty;
+    if (g->overlay_id != e->cur_tetromino_id ||
+        g->overlay_rotation != e->rotation || g->overlay_row != e->row ||
+        g->overlay_col != e->col)
+      dirty |= piece_rows(g->overlay_id, g->overlay_rotation,
+                          g->overlay_row) |
+               piece_rows(e->cur_tetromino_id, e->rotation, e->row);
+    if (!dirty) return 0;
+  }
+  for (uint32_t rows = dirty; rows; rows &= rows - 1) {
+    int r = __builtin_ctz(rows);
+    for (int c = 0; c < FIELD_COLS; ++c)
+      g->frame[r][c] = e->field[r][c];  // копирует строку поля в фрейм
+  }
   for (int r = 0; r < 4; ++r) {
+    int field_row = e->row + r;
+    if (field_row < 0 || field_row >= FIELD_ROWS ||
+        !(dirty & (1u << field_row)))
+      continue;
     for (int c = 0; c < 4; ++c) {
-      if (!is_cell_filled_in_rotated_mask(engine.cur_tetromino_id,
-                                          engine.rotation, r, c))
+      if (!is_cell_filled_in_rotated_mask(e->cur_tetromino_id, e->rotation, r,
+                                          c))
         continue;  // скип если фигура в точку не попадает
-      int field_row = engine.row + r;
-      int field_col = engine.col + c;
-      if (field_row >= 0 && field_row < FIELD_ROWS && field_col >= 0 &&
-          field_col < FIELD_COLS)
-        engine.frame[field_row][field_col] =
-            (int)engine.cur_tetromino_id +
+      int field_col = e->col + c;
+      if (field_col >= 0 && field_col < FIELD_COLS)
+        g->frame[field_row][field_col] =
+            (int)e->cur_tetromino_id +
             1;  // нет проверки на коллизии тк вызывается только при условии
                 // can_place_tetromино_in_field()
     }
   }
+  g->overlay_valid = true;
+  g->field_dirty = 0;
+  g->overlay_id = (uint8_t)e->cur_tetromino_id;
+  g->overlay_rotation = (uint8_t)e->rotation;
+  g->overlay_row = e->row;
+  g->overlay_col = e->col;
+  return dirty;
+}
+// ключ клетки зависит от колонки и цвета, номер строки подмешивается
+// поворотом. Так при сдвиге строк вниз хватает пересобрать свёртку из
+// row_hash, не перебирая клетки
+static uint64_t zobrist_key(uint64_t index) {  // splitmix64
+  uint64_t z = (index + 1) * 0x9E3779B97F4A7C15ull;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+static uint64_t cell_key(int col, int color) {
+  return zobrist_key((uint64_t)(col * 8 + color));
+}
+static uint64_t row_position(uint64_t row_hash, int row) {
+  int shift = row * 3;
+  return shift ? (row_hash << shift) | (row_hash >> (64 - shift)) : row_hash;
+}
+static uint64_t fold_row_hashes(const uint64_t* row_hash) {
+  uint64_t h = 0;
+  for (int r = 0; r < FIELD_ROWS; ++r) h ^= row_position(row_hash[r], r);
+  return h;
+}
+// текущая фигура и видимая очередь одним ключом по 3 бита на фигуру, 0 -
+// пустое место; индексы выше всех ключей клеток
+static uint64_t queue_hash(const EngineState* e) {
+  uint64_t packed = (uint64_t)e->cur_tetromino_id;
+  for (int i = 0; i < TETRIS_QUEUE_PREVIEW; ++i) {
+    int id = i < e->queue_len
+                 ? e->queue[(e->queue_head + i) & (TETRIS_QUEUE_SIZE - 1)] + 1
+                 : 0;
+    packed = packed << 3 | (uint64_t)id;
+  }
+  return zobrist_key(1ull << 40 | packed);
+}
+uint64_t engine_hash(const EngineState* e) {
+  return e->field_hash ^ queue_hash(e);
+}
+uint64_t engine_hash_recompute(const EngineState* e) {
+  uint64_t row_hash[FIELD_ROWS] = {0};
+  for (int r = 0; r < FIELD_ROWS; ++r)
+    for (int c = 0; c < FIELD_COLS; ++c)
+      if (e->field[r][c]) row_hash[r] ^= cell_key(c, e->field[r][c]);
+  return fold_row_hashes(row_hash) ^ queue_hash(e);
+}
+static int column_well(const FieldFeatures* f, int c) {
+  int left = c > 0 ? f->height[c - 1] : FIELD_ROWS;
+  int right = c < FIELD_COLS - 1 ? f->height[c + 1] : FIELD_ROWS;
+  int depth = (left < right ? left : right) - f->height[c];
+  return depth > 0 ? depth : 0;
+}
+// колодцы колонок lo..hi и неровность пар внутри отрезка: sign -1 убирает
+// их вклад до смены высот, +1 пересчитывает и добавляет после
+static void features_span(FieldFeatures* f, int lo, int hi, int sign) {
+  if (lo < 0) lo = 0;
+  if (hi > FIELD_COLS - 1) hi = FIELD_COLS - 1;
+  for (int c = lo; c <= hi; ++c) {
+    if (sign > 0) f->well[c] = (uint8_t)column_well(f, c);
+    f->wells += (int16_t)(sign * f->well[c]);
+    if (c < hi)
+      f->bumpiness += (int16_t)(sign * abs(f->height[c] - f->height[c + 1]));
+  }
+}
+static void features_totals(FieldFeatures* f) {
+  f->aggregate_height = f->max_height = f->holes = 0;
+  f->bumpiness = f->wells = 0;
+  for (int c = 0; c < FIELD_COLS; ++c) {
+    f->aggregate_height += f->height[c];
+    if (f->height[c] > f->max_height) f->max_height = f->height[c];
+    f->holes += (int16_t)(f->height[c] - f->cells[c]);
+  }
+  features_span(f, 0, FIELD_COLS - 1, 1);
+}
+void engine_features_recompute(const EngineState* e, FieldFeatures* out) {
+  memset(out, 0, sizeof(*out));
+  for (int c = 0; c < FIELD_COLS; ++c)
+    for (int r = FIELD_ROWS - 1; r >= 0; --r)
+      if (e->field[r][c]) {
+        out->cells[c]++;
+        out->height[c] = (uint8_t)(FIELD_ROWS - r);
+      }
+  features_totals(out);
+}
+const FieldFeatures* tetris_features(const TetrisGame* g) {
+  return &g->engine.features;
+}
+// фигура уже вписана в field
+static void features_lock(EngineState* e) {
+  FieldFeatures* f = &e->features;
+  const uint16_t* mask = TETROMINO_ROW_BITS[e->cur_tetromino_id][e->rotation];
+  unsigned cols = 0;
+  for (int r = 0; r < MASK_SIZE; ++r) cols |= mask[r];
+  int lo = e->col + __builtin_ctz(cols);
+  int hi = e->col + 31 - __builtin_clz(cols);
+  features_span(f, lo - 1, hi + 1, -1);
+  for (int r = 0; r < MASK_SIZE; ++r) {
+    for (unsigned bits = mask[r]; bits; bits &= bits - 1) {
+      int c = e->col + __builtin_ctz(bits);
+      int height = FIELD_ROWS - (e->row + r);
+      f->cells[c]++;
+      f->holes--;  // клетка либо закрыла дыру, либо поднимет верх ниже
+      if (height > f->height[c]) {
+        f->aggregate_height += (int16_t)(height - f->height[c]);
+        f->holes += (int16_t)(height - f->height[c]);
+        f->height[c] = (uint8_t)height;
+        if (height > f->max_height) f->max_height = (int16_t)height;
+      }
+    }
+  }
+  features_span(f, lo - 1, hi + 1, 1);
+}
+// после сдвига строк: в каждой колонке ушло cleared клеток, и верх опустился
+// на cleared, если он был выше верхней снятой строки top_cleared. Иначе
+// колонка держалась только на снятых строках, и новый верх ищется заново
+static void features_clear(EngineState* e, int cleared, int top_cleared) {
+  FieldFeatures* f = &e->features;
+  for (int c = 0; c < FIELD_COLS; ++c) {
+    f->cells[c] = (uint8_t)(f->cells[c] - cleared);
+    if (f->height[c] > FIELD_ROWS - top_cleared) {
+      f->height[c] = (uint8_t)(f->height[c] - cleared);
+      continue;
+    }
+    int r = FIELD_ROWS - f->height[c] + cleared;
+    while (r < FIELD_ROWS && !e->field[r][c]) ++r;
+    f->height[c] = (uint8_t)(FIELD_ROWS - r);
+  }
+  features_totals(f);
+}
+#ifdef TETRIS_DEBUG_FEATURES
+static void features_check(const EngineState* e) {
+  FieldFeatures expected;
+  engine_features_recompute(e, &expected);
+  if (memcmp(&expected, &e->features, sizeof(expected)) == 0) return;
+  fprintf(stderr, "features diverged from field after piece %d\n",
+          e->pieces);
+  abort();
+}
+#endif
+void engine_rebuild_derived(EngineState* e) {
+  for (int r = 0; r < FIELD_ROWS; ++r) {
+    e->row_hash[r] = 0;
+#ifdef TETRIS_BITBOARD
+    e->field_bits[r] = 0;
+#endif
+    for (int c = 0; c < FIELD_COLS; ++c) {
+      if (!e->field[r][c]) continue;
+      e->row_hash[r] ^= cell_key(c, e->field[r][c]);
+#ifdef TETRIS_BITBOARD
+      e->field_bits[r] |= (uint16_t)(1u << c);
+#endif
+    }
+  }
+  e->field_hash = fold_row_hashes(e->row_hash);
+  engine_features_recompute(e, &e->features);
 }
 // LOCK
-static void
-lock_active_tetromino_into_field() {  // выполняется после неудачной попытки
-                                      // опустить фигуру вниз, останавливает
-                                      // фигуру и вписывает ее в engine.field
+static void lock_active_tetromino_into_field(
+    TetrisGame* g) {  // выполняется после неудачной попытки
+                      // опустить фигуру вниз, останавливает
+                      // фигуру и вписывает ее в engine.field
+  EngineState* e = &g->engine;
   for (int r = 0; r < 4; ++r) {
     for (int c = 0; c < 4; ++c) {
-      if (!is_cell_filled_in_rotated_mask(engine.cur_tetromino_id,
-                                          engine.rotation, r, c))
+      if (!is_cell_filled_in_rotated_mask(e->cur_tetromino_id, e->rotation, r,
+                                          c))
         continue;
-      int fr = engine.row + r;
-      int fc = engine.col + c;
-      if (fr >= 0 && fr < FIELD_ROWS && fc >= 0 && fc < FIELD_COLS)
-        engine.field[fr][fc] =
-            (int)engine.cur_tetromino_id + 1;  // по сути излишне но пох
+      int fr = e->row + r;
+      int fc = e->col + c;
+      if (fr >= 0 && fr < FIELD_ROWS && fc >= 0 && fc < FIELD_COLS) {
+        e->field[fr][fc] =
+            (uint8_t)(e->cur_tetromino_id + 1);  // по сути излишне но пох
+        uint64_t key = cell_key(fc, e->field[fr][fc]);
+        e->row_hash[fr] ^= key;
+        e->field_hash ^= row_position(key, fr);
+#ifdef TETRIS_BITBOARD
+        e->field_bits[fr] |= (uint16_t)(1u << fc);
+#endif
+      }
     }
   }
-  state = SPAWN;
-  clear_full_rows_and_count_score();
-  spawn_next_tetromino();
+  features_lock(e);
+  g->field_dirty |= piece_rows(e->cur_tetromino_id, e->rotation, e->row);
+  emit_piece(g, TETRIS_EVENT_LOCK);
+  g->state = SPAWN;
+  clear_full_rows_and_count_score(g);
+#ifdef TETRIS_DEBUG_FEATURES
+  features_check(e);
+#endif
+  spawn_next_tetromino(g);
+}
+static int is_row_full(const EngineState* e, int r) {
+#ifdef TETRIS_BITBOARD
+  return e->field_bits[r] == FULL_ROW_BITS;
+#else
+  for (int c = 0; c < FIELD_COLS; ++c)
+    if (e->field[r][c] == 0) return 0;
+  return 1;
+#endif
 }
-static void clear_full_rows_and_count_score() {
+static void clear_full_rows_and_count_score(TetrisGame* g) {
+  EngineState* e = &g->engine;
+  // заполниться могли только строки только что упавшей фигуры, остальные
+  // были неполными и до неё
+  uint32_t full_mask = 0;  // бит r - строка r полная
+  int lowest = -1;
   int cleared = 0;  // сколько строк заполнены
-  for (int r = 0; r < FIELD_ROWS; ++r) {
-    int full = 1;
-    for (int c = 0; c < FIELD_COLS; ++c)
-      if (engine.field[r][c] == 0) {
-        full = 0;
-        break;
-      }
-    if (full) {  // если да то свдигает все вышестоящие строки на 1 вниз
+  for (int r = e->row; r < e->row + MASK_SIZE; ++r)
+    if (r >= 0 && r < FIELD_ROWS && is_row_full(e, r)) {
+      full_mask |= 1u << r;
+      lowest = r;
       cleared++;
-      for (int rr = r; rr > 0; --rr)
-        memcpy(engine.field[rr], engine.field[rr - 1],
-               sizeof(engine.field[rr]));
-      // memset(engine.field[0], 0, sizeof(engine.field[0])); // самую верхнюю
-      // строку зануляет
-      for (int c = 0; c < FIELD_COLS; ++c) engine.field[0][c] = 0;
+    }
+  if (cleared) {
+    // один проход снизу вверх: строки между полными идут одним memmove
+    // на массив сразу на итоговое место, ниже самой нижней полной ничего не
+    // двигается. Кусков не больше четырёх, верхний - всё выше фигуры
+    int dst = lowest + 1;  // первая уже занятая итоговая строка
+    for (int r = lowest - 1; r >= 0;) {
+      if (full_mask & (1u << r)) {
+        --r;
+        continue;
+      }
+      int top = r;
+      while (top > 0 && !(full_mask & (1u << (top - 1)))) --top;
+      size_t n = (size_t)(r - top + 1);
+      dst -= (int)n;
+      memmove(e->field[dst], e->field[top], n * sizeof(e->field[0]));
+#ifdef TETRIS_BITBOARD
+      memmove(&e->field_bits[dst], &e->field_bits[top],
+              n * sizeof(e->field_bits[0]));
+#endif
+      memmove(&e->row_hash[dst], &e->row_hash[top],
+              n * sizeof(e->row_hash[0]));
+      r = top - 1;
+    }
+    // сверху освободилось cleared строк
+    for (int r = 0; r < cleared; ++r) {
+      memset(e->field[r], 0, sizeof(e->field[r]));
+#ifdef TETRIS_BITBOARD
+      e->field_bits[r] = 0;
+#endif
+      e->row_hash[r] = 0;
+    }
+    e->field_hash = fold_row_hashes(e->row_hash);
+    features_clear(e, cleared, __builtin_ctz(full_mask));
+    g->field_dirty |= (2u << lowest) - 1;  // всё от верха до нижней снятой
+    if (g->events) {
+      TetrisEvent event = {.type = TETRIS_EVENT_ROWS_CLEARED};
+      event.rows.count = (uint8_t)cleared;
+      event.rows.mask = full_mask;
+      emit(g, event);
     }
   }
+  e->lines += cleared;
   if (cleared == 1)
-    engine.score += 100;
+    e->score += 100;
   else if (cleared == 2)
-    engine.score += 300;
+    e->score += 300;
   else if (cleared == 3)
-    engine.score += 700;
+    e->score += 700;
   else if (cleared >= 4)
-    engine.score += 1500;
+    e->score += 1500;
+  if (cleared) emit_value(g, TETRIS_EVENT_SCORE, e->score);
 
-  int new_level = engine.score / 600 + 1;
+  int new_level = e->score / 600 + 1;
   if (new_level > 10) new_level = 10;
-  if (new_level != engine.level) {
-    engine.level = new_level;
-    int new_speed = 12 - (engine.level - 1);
-    if (new_speed < 2) new_speed = 2;
-    engine.speed = new_speed;
+  if (new_level != e->level) {
+    e->level = new_level;
+    e->speed = engine_gravity_ticks(e->level);
+    emit_value(g, TETRIS_EVENT_LEVEL, e->level);
   }
-  if (engine.score > engine.high_score) {
-    engine.high_score = engine.score;
-    store_high_score();
+  if (e->score > e->high_score) {
+    e->high_score = e->score;
+    store_high_score(g);
   }
 }
-static void generate_next_preview(TetrominoId pid) {
-  clear_next();  // очистка старого превью
-  for (int r = 0; r < 4; ++r)
-    for (int c = 0; c < 4; ++c)
-      engine.next_tetromino_preview[r][c] =
-          TETROMINO_MASKS[pid][r][c] ? (int)pid + 1 : 0;  // заполнение нового
-}
-static TetrominoId next_tetromino_id() {  // смотрит текущую фигуру и возвращает
-                                          // айди следущей (цикл)
-  TetrominoId id = (TetrominoId)(engine.next_gen_counter % P_COUNT);
-  engine.next_gen_counter++;
+// превью уже развёрнутое в цвета, копируется целиком
+static const int TETROMINO_PREVIEW[P_COUNT][4][4] = {
+    {{0, 0, 0, 0}, {0, 0, 0, 0}, {1, 1, 1, 1}, {0, 0, 0, 0}},
+    {{0, 0, 0, 0}, {0, 2, 2, 0}, {0, 2, 2, 0}, {0, 0, 0, 0}},
+    {{0, 0, 0, 0}, {0, 0, 3, 3}, {0, 3, 3, 0}, {0, 0, 0, 0}},
+    {{0, 0, 0, 0}, {4, 4, 0, 0}, {0, 4, 4, 0}, {0, 0, 0, 0}},
+    {{0, 0, 0, 0}, {0, 0, 5, 0}, {5, 5, 5, 0}, {0, 0, 0, 0}},
+    {{0, 0, 0, 0}, {6, 0, 0, 0}, {6, 6, 6, 0}, {0, 0, 0, 0}},
+    {{0, 0, 0, 0}, {0, 7, 0, 0}, {7, 7, 7, 0}, {0, 0, 0, 0}}};
+static void generate_next_preview(TetrisGame* g, TetrominoId pid) {
+  memcpy(g->next_tetromino_preview, TETROMINO_PREVIEW[pid],
+         sizeof(g->next_tetromino_preview));
+  g->preview_id = (int)pid;
+}
+static TetrominoId next_tetromino_id(EngineState* e) {  // снимает с очереди
+  TetrominoId id = (TetrominoId)e->queue[e->queue_head];
+  e->queue_head = (uint8_t)((e->queue_head + 1) & (TETRIS_QUEUE_SIZE - 1));
+  e->queue_len--;
   return id;
 }
 static void place_current_tetromino(
+    EngineState* e,
     TetrominoId pid) {  // выставляет текущую фигуру id в стартовой позиции
-  engine.cur_tetromino_id = pid;
-  engine.rotation = 0;
-  engine.row = 0;
-  engine.col = (FIELD_COLS - MASK_SIZE) / 2;
+  e->cur_tetromino_id = pid;
+  e->rotation = 0;
+  e->row = 0;
+  e->col = (FIELD_COLS - MASK_SIZE) / 2;
 }
-static int can_fall() {
-  return can_place_tetromino_in_field(engine.cur_tetromino_id, engine.rotation,
-                                      engine.row + 1, engine.col);
+static int can_fall(const EngineState* e) {
+  return can_place_tetromino_in_field(e, e->cur_tetromino_id, e->rotation,
+                                      e->row + 1, e->col);
 }
 // SPAWN
-static void
-spawn_next_tetromino() {  // если нужно — бутстрапит превью; делает текущей
-                          // фигуру из превью; генерирует новую “следующую” и
-                          // перерисовывает превью; проверяет can_place — при
-                          // неудаче ставит game_over.
-  if (engine.next_gen_counter == 0 &&
-      engine.next_tetromino_id == 0) {  // бутстрапим если нихера нет
-    engine.next_tetromino_id = next_tetromino_id();
-    generate_next_preview(engine.next_tetromino_id);
-  }
-  place_current_tetromino(engine.next_tetromino_id);
-  state = FALLING;
+static void spawn_next_tetromino(
+    TetrisGame* g) {  // если нужно — бутстрапит превью; делает текущей
+                      // фигуру из превью; генерирует новую “следующую” и
+                      // перерисовывает превью; проверяет can_place — при
+                      // неудаче ставит game_over.
+  EngineState* e = &g->engine;
+  // после снятия в очереди должно остаться превью целиком
+  if (e->queue_len <= TETRIS_QUEUE_PREVIEW) refill_queue(e);
+  place_current_tetromino(e, next_tetromino_id(e));
+  e->pieces++;
+  g->state = FALLING;
   // заготовка под некст
-  engine.next_tetromino_id = next_tetromino_id();
-  generate_next_preview(engine.next_tetromino_id);
+  e->next_tetromino_id = (TetrominoId)e->queue[e->queue_head];
+  emit_piece(g, TETRIS_EVENT_SPAWN);
   if (!can_place_tetromino_in_field(
-          engine.cur_tetromino_id, engine.rotation, engine.row,
-          engine.col)) {  // если фиугра не влезла при спавне значит геймовер
-    state = GAME_OVER;    // лучше чекать в начале
+          e, e->cur_tetromino_id, e->rotation, e->row,
+          e->col)) {       // если фиугра не влезла при спавне значит геймовер
+    g->state = GAME_OVER;  // лучше чекать в начале
   }
 }
 // MOVE
-static void move_left() {
-  if (can_place_tetromino_in_field(engine.cur_tetromino_id, engine.rotation,
-                                   engine.row, engine.col - 1))
-    engine.col--;
-}
-static void move_right() {
-  if (can_place_tetromino_in_field(engine.cur_tetromino_id, engine.rotation,
-                                   engine.row, engine.col + 1))
-    engine.col++;
-}
-static void move_down() {
-  if (can_place_tetromino_in_field(engine.cur_tetromino_id, engine.rotation,
-                                   engine.row + 1, engine.col)) {
-    engine.row++;
+static void move_left(TetrisGame* g) {
+  EngineState* e = &g->engine;
+  if (can_place_tetromino_in_field(e, e->cur_tetromino_id, e->rotation, e->row,
+                                   e->col - 1)) {
+    e->col--;
+    emit_piece(g, TETRIS_EVENT_MOVE);
+  }
+}
+static void move_right(TetrisGame* g) {
+  EngineState* e = &g->engine;
+  if (can_place_tetromino_in_field(e, e->cur_tetromino_id, e->rotation, e->row,
+                                   e->col + 1)) {
+    e->col++;
+    emit_piece(g, TETRIS_EVENT_MOVE);
+  }
+}
+static void move_down(TetrisGame* g) {
+  EngineState* e = &g->engine;
+  if (can_fall(e)) {
+    e->row++;
+    emit_piece(g, TETRIS_EVENT_MOVE);
   } else {
-    state = LOCK;
-    lock_active_tetromino_into_field();
+    g->state = LOCK;
+    lock_active_tetromino_into_field(g);
   }
 }
-static void drop_figure() {
-  while (can_place_tetromino_in_field(engine.cur_tetromino_id, engine.rotation,
-                                      engine.row + 1, engine.col)) {
-    engine.row++;
+static void drop_figure(TetrisGame* g) {
+  EngineState* e = &g->engine;
+  int start_row = e->row;
+  while (can_fall(e)) {
+    e->row++;
   }
-  state = LOCK;
-  lock_active_tetromino_into_field();
-}
-static void rotate() {
-  int new_rot = (engine.rotation + 1) & 3;  // mod 4
-  if (can_place_tetromino_in_field(engine.cur_tetromino_id, new_rot, engine.row,
-                                   engine.col)) {
-    engine.rotation = new_rot;
+  if (e->row != start_row) emit_piece(g, TETRIS_EVENT_MOVE);
+  g->state = LOCK;
+  lock_active_tetromino_into_field(g);
+}
+static void rotate(TetrisGame* g) {
+  EngineState* e = &g->engine;
+  int new_rot = (e->rotation + 1) & 3;  // mod 4
+  if (can_place_tetromino_in_field(e, e->cur_tetromino_id, new_rot, e->row,
+                                   e->col)) {
+    e->rotation = new_rot;
+    emit_piece(g, TETRIS_EVENT_ROTATE);
   }
 }
 // PAUSE
-static void toggle_pause() {
-  if (state == PAUSE)
-    state = FALLING;
+static void toggle_pause(TetrisGame* g) {
+  if (g->state == PAUSE)
+    g->state = FALLING;
   else
-    state = PAUSE;
+    g->state = PAUSE;
 }
 // GAME_OVER
-static void exit_game() {
-  store_high_score();
-  state = GAME_OVER;
+static void exit_game(TetrisGame* g) {
+  store_high_score(g);
+  if (g->persistent) score_writer_flush();
+  g->state = GAME_OVER;
 }
 // FALL
-static void fall() {
-  state = FALLING;
-  if (can_fall())
-    engine.row++;
-  else {
-    state = LOCK;
-    lock_active_tetromino_into_field();
+static void fall(TetrisGame* g) {
+  g->state = FALLING;
+  if (can_fall(&g->engine)) {
+    g->engine.row++;
+    emit_piece(g, TETRIS_EVENT_MOVE);
+  } else {
+    g->state = LOCK;
+    lock_active_tetromino_into_field(g);
   }
 }
 
 //  START
-static void start_game() {
-  if (!high_score_loaded) {
-    load_high_score();
-    high_score_loaded = true;
+static void start_game(TetrisGame* g) {
+  if (!g->high_score_loaded) {
+    if (g->persistent) load_high_score(g);
+    g->high_score_loaded = true;
   }
-  state = START;
-  reset_state();
-  state = SPAWN;  // SPAWN
-  spawn_next_tetromino();
+  g->state = START;
+  reset_state(g);
+  emit_value(g, TETRIS_EVENT_RESET, 0);
+  g->state = SPAWN;  // SPAWN
+  spawn_next_tetromino(g);
 }
 
-void userInput(UserAction_t action, bool hold) {
-  (void)hold;
+void tetris_init(TetrisGame* g) {
+  memset(g, 0, sizeof(*g));
+  g->state = START;
+  init_rows(g);
+  clear_next(g);
+}
+
+TetrisGame* tetris_create(void) {
+  TetrisGame* g = malloc(sizeof(*g));
+  if (g) tetris_init(g);
+  return g;
+}
+
+void tetris_destroy(TetrisGame* g) { free(g); }
+
+void tetris_set_persistent(TetrisGame* g, bool persistent) {
+  g->persistent = persistent;
+}
+
+void tetris_input(TetrisGame* g, UserAction_t action, bool hold) {
   signals sig = SIG_NONE;
   switch (action) {
     case Start:
@@ -353,8 +732,8 @@ void userInput(UserAction_t action, bool hold) {
     case Right:
       sig = SIG_RIGHT;
       break;
-    case Down:
-      sig = SIG_HARD_DROP;
+    case Down:  // удержание - мягкое падение на строку, нажатие - до дна
+      sig = hold ? SIG_SOFT_DROP : SIG_HARD_DROP;
       break;
     case Action:
       sig = SIG_ROTATE;
@@ -365,31 +744,139 @@ void userInput(UserAction_t action, bool hold) {
     default:
       break;
   }
-  if (sig != SIG_NONE) dispatch(sig);
+  if (sig == SIG_NONE) return;
+  if (g->recorder) replay_record_input(g->recorder, action, hold);
+  dispatch(g, sig);
 }
 
-GameInfo_t updateCurrentState() {
-  if (state == FALLING) {
-    engine.tick++;
-    if (engine.tick >= engine.speed) {
-      engine.tick = 0;
-      dispatch(SIG_TICK);
+void tetris_set_bot(TetrisGame* g, TetrisBot* bot) {
+  g->bot = bot;
+  g->bot_piece = bot ? g->engine.pieces - 1 : 0;
+}
+
+void tetris_set_randomizer(TetrisGame* g, RandomizerKind kind,
+                           uint64_t seed) {
+  EngineState* e = &g->engine;
+  randomizer_seed(&e->randomizer, kind, seed);
+  e->queue_head = 0;
+  e->queue_len = 0;
+  refill_queue(e);
+  if (g->recorder)
+    replay_record_randomizer(g->recorder, e->randomizer.kind, seed);
+}
+
+int tetris_peek_queue(const TetrisGame* g, TetrominoId* out, int n) {
+  const EngineState* e = &g->engine;
+  if (n > e->queue_len) n = e->queue_len;
+  if (n > TETRIS_QUEUE_PREVIEW) n = TETRIS_QUEUE_PREVIEW;
+  for (int i = 0; i < n; ++i) {
+    int slot = (e->queue_head + i) & (TETRIS_QUEUE_SIZE - 1);
+    out[i] = (TetrominoId)e->queue[slot];
+  }
+  return n < 0 ? 0 : n;
+}
+
+void tetris_step(TetrisGame* g) {
+  if (g->bot && g->state == FALLING && g->bot_piece != g->engine.pieces) {
+    g->bot_piece = g->engine.pieces;  // по одной фигуре за шаг
+    bot_play(g->bot, g);
+  }
+  // после хода бота: в записи его фиксация идёт до этого шага
+  if (g->recorder) replay_record_step(g->recorder, g);
+  if (g->state == FALLING) {
+    g->engine.tick++;
+    if (g->engine.tick >= g->engine.speed) {
+      g->engine.tick = 0;
+      dispatch(g, SIG_TICK);
     }
   }
-  update_frame_overlay();
+}
+
+void tetris_lock_at(TetrisGame* g, int rotation, int row, int col) {
+  if (g->state != FALLING) return;
+  if (g->recorder) replay_record_place(g->recorder, rotation, row, col);
+  g->engine.rotation = rotation & 3;
+  g->engine.row = row;
+  g->engine.col = col;
+  g->state = LOCK;
+  lock_active_tetromino_into_field(g);
+  emit_transition(g, FALLING);
+}
+
+void tetris_save(const TetrisGame* g, TetrisSnapshot* snapshot) {
+  snapshot->engine = g->engine;
+  snapshot->state = g->state;
+}
+
+void tetris_restore(TetrisGame* g, const TetrisSnapshot* snapshot) {
+  g->engine = snapshot->engine;
+  g->state = snapshot->state;
+  g->overlay_valid = false;
+  emit_value(g, TETRIS_EVENT_RESET, 0);
+}
+
+int tetris_event_ring_init(TetrisEventRing* ring, TetrisEvent* storage,
+                           uint32_t capacity) {
+  if (capacity == 0 || (capacity & (capacity - 1))) return -1;
+  ring->events = storage;
+  ring->mask = capacity - 1;
+  ring->head = ring->tail = ring->dropped = 0;
+  return 0;
+}
+
+void tetris_set_recorder(TetrisGame* g, ReplayRecorder* rec) {
+  g->recorder = rec;
+  // генератор игры - первая запись, дальше его ведёт tetris_set_randomizer
+  if (rec)
+    replay_record_randomizer(rec, g->engine.randomizer.kind,
+                             g->engine.randomizer.seed);
+}
+
+void tetris_set_event_ring(TetrisGame* g, TetrisEventRing* ring) {
+  g->events = ring;
+}
+
+bool tetris_event_pop(TetrisEventRing* ring, TetrisEvent* event) {
+  if (ring->head == ring->tail) return false;
+  *event = ring->events[ring->tail++ & ring->mask];
+  return true;
+}
+
+TetrisFrameInfo tetris_query_frame(TetrisGame* g) {
+  const EngineState* e = &g->engine;
+  TetrisFrameInfo frame;
+  frame.dirty_rows = update_frame_overlay(g);
+  // превью разворачивается только когда сменилась следующая фигура
+  frame.next_changed =
+      g->state != START && g->preview_id != (int)e->next_tetromino_id;
+  if (frame.next_changed) generate_next_preview(g, e->next_tetromino_id);
   GameInfo_t info;
-  info.field = engine.frame_rows;
-  info.next = engine.next_rows;
-  info.score = engine.score;
-  info.high_score = engine.high_score;
-  info.level = engine.level;
-  info.speed = engine.speed;
+  info.field = g->frame_rows;
+  info.next = g->next_rows;
+  info.score = e->score;
+  info.high_score = e->high_score;
+  info.level = e->level;
+  info.speed = e->speed;
   int ui_state = 0;
-  if (state == PAUSE) {
+  if (g->state == PAUSE) {
     ui_state = 1;
-  } else if (state == GAME_OVER) {
+  } else if (g->state == GAME_OVER) {
     ui_state = 2;
   }
   info.pause = ui_state;
-  return info;
+  frame.info = info;
+  return frame;
+}
+
+GameInfo_t tetris_query(TetrisGame* g) { return tetris_query_frame(g).info; }
+
+void userInput(UserAction_t action, bool hold) {
+  tetris_input(&default_game, action, hold);
+}
+
+TetrisGame* tetris_default_game(void) { return &default_game; }
+
+GameInfo_t updateCurrentState() {
+  tetris_step(&default_game);
+  return tetris_query(&default_game);
 }
@@ -6,9 +6,17 @@
 #define NUM_STATES 6
 #define NUM_SIGNALS 10
 #define SCORE_FILE_PATH "high_score.dat"
+// очередь следующих фигур: размер - степень двойки, видно всегда не меньше
+// TETRIS_QUEUE_PREVIEW, остальное доливается пачкой
+#define TETRIS_QUEUE_SIZE 16
+#define TETRIS_QUEUE_PREVIEW 8
+#include <stdint.h>
+
+#include "game_events.h"
 #include "game_interface.h"
+#include "randomizer.h"
 
-typedef void (*action)(void);
+typedef void (*action)(TetrisGame*);
 typedef enum {
   SIG_START = 0,
   SIG_ROTATE,
@@ -40,18 +48,79 @@ static const int TETROMINO_MASKS[P_COUNT][4][4] = {
     // T
     {{0, 0, 0, 0}, {0, 1, 0, 0}, {1, 1, 1, 0}, {0, 0, 0, 0}}};
 
+#define FULL_ROW_BITS 0x3FF
+// маска поля сдвинута на 4 бита влево, всё вне 4..13 - стенки
+#define WALL_BITS 0xFFFFC00Fu
+
+// TETROMINO_MASKS заранее повернутые: [фигура][поворот][строка маски],
+// бит c = колонка c маски 4на4
+static const uint16_t TETROMINO_ROW_BITS[P_COUNT][4][4] = {
+    // I
+    {{0x0, 0x0, 0xF, 0x0},
+     {0x2, 0x2, 0x2, 0x2},
+     {0x0, 0xF, 0x0, 0x0},
+     {0x4, 0x4, 0x4, 0x4}},
+    // O
+    {{0x0, 0x6, 0x6, 0x0},
+     {0x0, 0x6, 0x6, 0x0},
+     {0x0, 0x6, 0x6, 0x0},
+     {0x0, 0x6, 0x6, 0x0}},
+    // S
+    {{0x0, 0xC, 0x6, 0x0},
+     {0x0, 0x2, 0x6, 0x4},
+     {0x0, 0x6, 0x3, 0x0},
+     {0x2, 0x6, 0x4, 0x0}},
+    // Z
+    {{0x0, 0x3, 0x6, 0x0},
+     {0x4, 0x6, 0x2, 0x0},
+     {0x0, 0x6, 0xC, 0x0},
+     {0x0, 0x4, 0x6, 0x2}},
+    // L
+    {{0x0, 0x4, 0x7, 0x0},
+     {0x2, 0x2, 0x6, 0x0},
+     {0x0, 0xE, 0x2, 0x0},
+     {0x0, 0x6, 0x4, 0x4}},
+    // J
+    {{0x0, 0x1, 0x7, 0x0},
+     {0x6, 0x2, 0x2, 0x0},
+     {0x0, 0xE, 0x8, 0x0},
+     {0x0, 0x4, 0x4, 0x6}},
+    // T
+    {{0x0, 0x2, 0x7, 0x0},
+     {0x2, 0x6, 0x2, 0x0},
+     {0x0, 0xE, 0x4, 0x0},
+     {0x0, 0x4, 0x6, 0x4}}};
+
+// признаки зафиксированного поля для бота и аналитики. Движок ведёт их сам:
+// фиксация фигуры трогает только её колонки и соседей, снятие строк - по
+// колонке без обхода поля (кроме колонок, чей верх снят целиком)
 typedef struct {
-  int field[FIELD_ROWS][FIELD_COLS];
-  int frame[FIELD_ROWS][FIELD_COLS];  // overlay of active piece
-  int* field_rows[FIELD_ROWS];
-  int* frame_rows[FIELD_ROWS];
+  uint8_t height[FIELD_COLS];  // FIELD_ROWS - верхняя занятая строка, 0 пусто
+  uint8_t cells[FIELD_COLS];   // занятых клеток; дыр в колонке height - cells
+  uint8_t well[FIELD_COLS];    // на сколько ниже обоих соседей, стенки - верх
+  int16_t aggregate_height;
+  int16_t max_height;
+  int16_t holes;      // пустые клетки под верхом своей колонки
+  int16_t bumpiness;  // сумма |height[c] - height[c + 1]|
+  int16_t wells;      // сумма well
+} FieldFeatures;
 
-  int next_tetromino_preview[4][4];  // next_tetromino_preview
-  int* next_rows[4];
+// только значения, без указателей: копия структуры - полноценная копия
+// игры (см. TetrisSnapshot)
+typedef struct {
+  uint8_t field[FIELD_ROWS][FIELD_COLS];  // 0 - пусто, иначе id фигуры + 1
+#ifdef TETRIS_BITBOARD
+  uint16_t field_bits[FIELD_ROWS];  // бит c = engine.field[r][c] != 0
+#endif
+  // zobrist поля: row_hash - клетки строки без учёта её номера, field_hash -
+  // их свёртка, обновляются при фиксации фигуры и снятии строк
+  uint64_t row_hash[FIELD_ROWS];
+  uint64_t field_hash;
+  FieldFeatures features;
 
   // тетромино которое падает рн
   TetrominoId cur_tetromino_id;
-  TetrominoId next_tetromino_id;  // некст фигурка
+  TetrominoId next_tetromino_id;  // некст фигурка, первая в очереди
   int rotation;                   // 0..3
   int row;                        // верх-лев клетка маски 4на4 на поле
   int col;                        // аналогично
@@ -62,8 +131,14 @@ typedef struct {
   int level;
   int speed;
   int tick;
+  int lines;   // всего очищено строк
+  int pieces;  // всего заспавнено фигур
 
-  int next_gen_counter;  // счетчик фигур цикл
+  // кольцо следующих фигур с queue_head, queue_len штук
+  uint8_t queue[TETRIS_QUEUE_SIZE];
+  uint8_t queue_head;
+  uint8_t queue_len;
+  Randomizer randomizer;
 } EngineState;
 
 typedef enum {
@@ -75,4 +150,94 @@ typedef enum {
   PAUSE
 } tetrisState_t;
 
+typedef struct TetrisBot TetrisBot;
+typedef struct ReplayRecorder ReplayRecorder;
+
+// всё состояние одной игры, инстансы друг от друга не зависят
+struct TetrisGame {
+  EngineState engine;
+  tetrisState_t state;
+  bool high_score_loaded;
+  bool persistent;  // читать/писать SCORE_FILE_PATH
+
+  // то, что отдаётся в GameInfo_t, пересобирается из engine в tetris_query()
+  int frame[FIELD_ROWS][FIELD_COLS];  // overlay of active piece
+  int* frame_rows[FIELD_ROWS];
+  int next_tetromino_preview[4][4];
+  int* next_rows[4];
+  int preview_id;  // чья маска сейчас в превью, -1 - пусто
+  // frame пересобирается только в строках, где что-то поменялось: в
+  // field_dirty (фиксация фигуры, снятие строк) и там, где фигура была и
+  // стала. overlay_valid = false - пересобрать всё (старт, tetris_restore)
+  bool overlay_valid;
+  uint32_t field_dirty;  // бит r - строка field менялась после overlay
+  uint8_t overlay_id, overlay_rotation;  // фигура, нарисованная в frame
+  int overlay_row, overlay_col;
+
+  TetrisBot* bot;  // не NULL - фигуры ведёт автоигрок (bot.h)
+  int bot_piece;   // engine.pieces, для которой бот уже сходил
+
+  TetrisEventRing* events;  // не NULL - куда писать события (game_events.h)
+  ReplayRecorder* recorder;  // не NULL - ввод пишется в запись (replay.h)
+};
+
+// снимок игры для поиска и отката: field, фигура, поворот, позиция, превью,
+// счётчики, генератор с очередью фигур и состояние FSM. Указателей нет,
+// save/restore - копия ~530 байт
+typedef struct {
+  EngineState engine;
+  tetrisState_t state;
+} TetrisSnapshot;
+
+// то же, что tetris_create(), но в памяти вызывающего (массивы игр)
+void tetris_init(TetrisGame* game);
+
+void tetris_save(const TetrisGame* game, TetrisSnapshot* snapshot);
+void tetris_restore(TetrisGame* game, const TetrisSnapshot* snapshot);
+
+int can_place_tetromino_in_field(const EngineState* e, TetrominoId id, int rot,
+                                 int row, int col);
+// фиксирует текущую фигуру в (rotation, row, col) как после падения:
+// очистка строк, очки, спавн следующей. Только в состоянии FALLING
+void tetris_lock_at(TetrisGame* game, int rotation, int row, int col);
+// включает режим автоигрока, NULL - выключает. Бот не принадлежит игре
+void tetris_set_bot(TetrisGame* game, TetrisBot* bot);
+// генератор фигур: очередь переливается сразу, каждая новая партия
+// начинается с того же seed. По умолчанию цикл. Попадает в запись партии
+void tetris_set_randomizer(TetrisGame* game, RandomizerKind kind,
+                           uint64_t seed);
+// первые n (не больше TETRIS_QUEUE_PREVIEW) следующих фигур, out[0] -
+// превью; игру не трогает. Возвращает, сколько записано
+int tetris_peek_queue(const TetrisGame* game, TetrominoId* out, int n);
+
+// задержка гравитации на уровне 1..10 в шагах tetris_step()
+int engine_gravity_ticks(int level);
+
+// 64-битный ключ позиции: поле, текущая фигура и видимая часть очереди
+// (TETRIS_QUEUE_PREVIEW фигур). Положение падающей фигуры не входит - для
+// поиска по размещениям позиции сравниваются в момент спавна
+uint64_t engine_hash(const EngineState* e);
+// то же, но поле хешируется заново по всем клеткам; для проверок
+uint64_t engine_hash_recompute(const EngineState* e);
+// признаки поля, которые ведёт движок; O(1), без обхода клеток
+const FieldFeatures* tetris_features(const TetrisGame* game);
+// те же признаки обходом всех клеток, для проверок. С make DEBUG_FEATURES=1
+// движок сам сверяется с ним после каждой фиксации и падает при расхождении
+void engine_features_recompute(const EngineState* e, FieldFeatures* out);
+// пересчитывает по field всё производное от него: row_hash, field_hash,
+// признаки и битовые строки. Для состояний, собранных не движком (replay.c)
+void engine_rebuild_derived(EngineState* e);
+
+// строка поля битмаской, бит c = клетка занята
+static inline uint16_t engine_row_bits(const EngineState* e, int row) {
+#ifdef TETRIS_BITBOARD
+  return e->field_bits[row];
+#else
+  uint16_t bits = 0;
+  for (int c = 0; c < FIELD_COLS; ++c)
+    if (e->field[row][c]) bits |= (uint16_t)(1u << c);
+  return bits;
+#endif
+}
+
 #endif
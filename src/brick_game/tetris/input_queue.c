@@ -0,0 +1,73 @@
+#include "input_queue.h"
+
+#define MS 1000000LL
+
+void input_queue_init(InputQueue* queue) {
+  atomic_init(&queue->head, 0);
+  atomic_init(&queue->tail, 0);
+}
+
+bool input_queue_push(InputQueue* queue, const InputEvent* event) {
+  unsigned head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+  unsigned tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+  if (head - tail == INPUT_QUEUE_SIZE) return false;
+  queue->events[head & (INPUT_QUEUE_SIZE - 1)] = *event;
+  atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+  return true;
+}
+
+bool input_queue_pop(InputQueue* queue, InputEvent* event) {
+  unsigned tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+  unsigned head = atomic_load_explicit(&queue->head, memory_order_acquire);
+  if (head == tail) return false;
+  *event = queue->events[tail & (INPUT_QUEUE_SIZE - 1)];
+  atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+  return true;
+}
+
+void auto_repeat_init(AutoRepeat* repeat) { *repeat = (AutoRepeat){0}; }
+
+bool auto_repeat_event(AutoRepeat* repeat, const InputEvent* event,
+                       bool repeatable) {
+  // другая клавиша прерывает удержание, как автоповтор терминала
+  if (!repeatable || !repeat->held || event->key != repeat->key ||
+      event->t_ns - repeat->last_ns > AUTO_REPEAT_GAP_MS * MS) {
+    // задержка автоповтора терминала обычно 250-600 мс
+    bool chained = repeat->held && event->key == repeat->key &&
+                   event->t_ns - repeat->last_ns <= 1000 * MS;
+    repeat->key = event->key;
+    repeat->held = repeatable;
+    repeat->repeating = false;
+    // первый автоповтор терминала приходит не сразу, DAS считается от
+    // исходного нажатия
+    if (!chained) repeat->pressed_ns = event->t_ns;
+    repeat->last_ns = event->t_ns;
+    return true;
+  }
+  if (!repeat->repeating) {
+    repeat->repeating = true;
+    int64_t das = repeat->pressed_ns + AUTO_REPEAT_DAS_MS * MS;
+    repeat->next_ns = das > event->t_ns ? das : event->t_ns;
+  }
+  repeat->last_ns = event->t_ns;
+  return false;
+}
+
+int auto_repeat_due(AutoRepeat* repeat, int64_t now_ns) {
+  if (!repeat->repeating) return 0;
+  int64_t release_ns = repeat->last_ns + AUTO_REPEAT_RELEASE_MS * MS;
+  int64_t until = now_ns < release_ns ? now_ns : release_ns;
+  int due = 0;
+  while (repeat->next_ns <= until) {
+    repeat->next_ns += AUTO_REPEAT_ARR_MS * MS;
+    due++;
+  }
+  if (now_ns >= release_ns) repeat->held = repeat->repeating = false;
+  return due;
+}
+
+int64_t auto_repeat_deadline(const AutoRepeat* repeat) {
+  if (!repeat->repeating) return -1;
+  int64_t release_ns = repeat->last_ns + AUTO_REPEAT_RELEASE_MS * MS;
+  return repeat->next_ns < release_ns ? repeat->next_ns : release_ns;
+}
@@ -0,0 +1,60 @@
+#ifndef INPUT_QUEUE_H_
+#define INPUT_QUEUE_H_
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Очередь нажатий от потока ввода к игровому циклу: один писатель,
+// один читатель, без блокировок. head двигает только писатель, tail -
+// только читатель, каждый на своей кэш-линии; release на своём индексе и
+// acquire на чужом упорядочивают запись события и его чтение.
+
+#define INPUT_QUEUE_SIZE 256  // степень двойки
+
+typedef struct {
+  int64_t t_ns;  // CLOCK_MONOTONIC момента чтения клавиши
+  int key;       // код клавиши фронтенда
+} InputEvent;
+
+typedef struct {
+  _Alignas(64) atomic_uint head;
+  _Alignas(64) atomic_uint tail;
+  _Alignas(64) InputEvent events[INPUT_QUEUE_SIZE];
+} InputQueue;
+
+void input_queue_init(InputQueue* queue);
+// false - очередь полна, событие отброшено
+bool input_queue_push(InputQueue* queue, const InputEvent* event);
+bool input_queue_pop(InputQueue* queue, InputEvent* event);
+
+// Автоповтор клавиш движения по схеме DAS/ARR. Терминал не сообщает об
+// отпускании клавиши, только повторяет нажатие, пока она зажата. Поэтому
+// событие той же клавиши через AUTO_REPEAT_GAP_MS и меньше считается
+// удержанием, а тишина дольше AUTO_REPEAT_RELEASE_MS - отпусканием. Пока
+// клавиша удерживается, повторы идут с шагом ARR, но не раньше DAS от
+// нажатия, и не зависят от частоты автоповтора терминала.
+#define AUTO_REPEAT_DAS_MS 170
+#define AUTO_REPEAT_ARR_MS 30
+#define AUTO_REPEAT_GAP_MS 60
+#define AUTO_REPEAT_RELEASE_MS 100
+
+typedef struct {
+  int key;
+  bool held;       // key сейчас нажата
+  bool repeating;  // и удерживается: идут повторы
+  int64_t pressed_ns;
+  int64_t last_ns;  // последнее событие этой клавиши
+  int64_t next_ns;  // следующий повтор
+} AutoRepeat;
+
+void auto_repeat_init(AutoRepeat* repeat);
+// true - это нажатие и его нужно применить сразу, false - событие
+// поглощено удержанием. repeatable - клавиша с автоповтором
+bool auto_repeat_event(AutoRepeat* repeat, const InputEvent* event,
+                       bool repeatable);
+// сколько повторов key пора выполнить к now_ns
+int auto_repeat_due(AutoRepeat* repeat, int64_t now_ns);
+// ближайший момент, когда auto_repeat_due() что-то даст; -1 - не ждём
+int64_t auto_repeat_deadline(const AutoRepeat* repeat);
+
+#endif
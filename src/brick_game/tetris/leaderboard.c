@@ -0,0 +1,242 @@
+#define _POSIX_C_SOURCE 200809L
+#include "leaderboard.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct Leaderboard {
+  int fd;
+  void* map;
+  size_t size;
+  const LeaderboardHeader* header;
+  LeaderboardRecord* records;
+  // fcntl-блокировки действуют на процесс целиком, потоки одного
+  // процесса сериализуются этим мьютексом
+  pthread_mutex_t lock;
+};
+
+static uint32_t entry_checksum(const LeaderboardEntry* e) {
+  const unsigned char* bytes = (const unsigned char*)e;
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < offsetof(LeaderboardEntry, checksum); ++i)
+    h = (h ^ bytes[i]) * 16777619u;
+  return h;
+}
+
+static off_t record_offset(uint32_t player) {
+  return (off_t)sizeof(LeaderboardHeader) +
+         (off_t)player * (off_t)sizeof(LeaderboardRecord);
+}
+
+static int lock_range(int fd, short type, off_t start, off_t len) {
+  struct flock fl;
+  memset(&fl, 0, sizeof(fl));
+  fl.l_type = type;
+  fl.l_whence = SEEK_SET;
+  fl.l_start = start;
+  fl.l_len = len;
+  int rc;
+  do {
+    rc = fcntl(fd, F_SETLKW, &fl);
+  } while (rc == -1 && errno == EINTR);
+  return rc;
+}
+
+// согласованная копия записи без блокировок: active не менялся, пока
+// копировали, и сумма сошлась. Если текущая копия испорчена (падение
+// системы посреди записи), берётся вторая
+static int read_entry(const LeaderboardRecord* r, LeaderboardEntry* out) {
+  for (int attempt = 0; attempt < 64; ++attempt) {
+    unsigned active = atomic_load_explicit(&r->active, memory_order_acquire);
+    memcpy(out, &r->copy[active & 1], sizeof(*out));
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&r->active, memory_order_relaxed) != active)
+      continue;
+    if (out->checksum == entry_checksum(out)) return 0;
+    memcpy(out, &r->copy[(active & 1) ^ 1], sizeof(*out));
+    if (out->checksum == entry_checksum(out)) return 0;
+  }
+  return -1;
+}
+
+static void sift_up(int32_t* heap, uint32_t i) {
+  while (i > 0) {
+    uint32_t parent = (i - 1) / 2;
+    if (heap[parent] <= heap[i]) break;
+    int32_t t = heap[parent];
+    heap[parent] = heap[i];
+    heap[i] = t;
+    i = parent;
+  }
+}
+
+static void sift_down(int32_t* heap, uint32_t count) {
+  uint32_t i = 0;
+  for (;;) {
+    uint32_t smallest = i, l = 2 * i + 1, r = l + 1;
+    if (l < count && heap[l] < heap[smallest]) smallest = l;
+    if (r < count && heap[r] < heap[smallest]) smallest = r;
+    if (smallest == i) break;
+    int32_t t = heap[smallest];
+    heap[smallest] = heap[i];
+    heap[i] = t;
+    i = smallest;
+  }
+}
+
+// 1 - результат изменил запись
+static int entry_insert(LeaderboardEntry* e, int32_t score) {
+  e->games++;
+  if (e->count < LEADERBOARD_TOP_N) {
+    e->heap[e->count] = score;
+    sift_up(e->heap, e->count++);
+  } else if (score > e->heap[0]) {
+    e->heap[0] = score;
+    sift_down(e->heap, e->count);
+  } else {
+    return 0;
+  }
+  if (e->count == 1 || score > e->best) e->best = score;
+  return 1;
+}
+
+static int init_file(int fd, uint32_t players) {
+  LeaderboardHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic = LEADERBOARD_MAGIC;
+  header.version = LEADERBOARD_VERSION;
+  header.top_n = LEADERBOARD_TOP_N;
+  header.players = players;
+  header.record_size = sizeof(LeaderboardRecord);
+  if (ftruncate(fd, record_offset(players)) != 0) return -1;
+  // пустые записи: обе копии с верной суммой нулевого содержимого
+  LeaderboardRecord empty;
+  memset(&empty, 0, sizeof(empty));
+  empty.copy[0].checksum = entry_checksum(&empty.copy[0]);
+  empty.copy[1].checksum = empty.copy[0].checksum;
+  for (uint32_t p = 0; p < players; ++p)
+    if (pwrite(fd, &empty, sizeof(empty), record_offset(p)) !=
+        (ssize_t)sizeof(empty))
+      return -1;
+  // заголовок последним: файл без него не считается готовым
+  if (pwrite(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header))
+    return -1;
+  return fsync(fd);
+}
+
+static int header_valid(const LeaderboardHeader* h, off_t size) {
+  return h->magic == LEADERBOARD_MAGIC && h->version == LEADERBOARD_VERSION &&
+         h->top_n == LEADERBOARD_TOP_N &&
+         h->record_size == sizeof(LeaderboardRecord) &&
+         size >= record_offset(h->players);
+}
+
+Leaderboard* leaderboard_open(const char* path, uint32_t players) {
+  int fd = open(path, O_RDWR | O_CREAT, 0644);
+  if (fd < 0) return NULL;
+  // создание и проверка заголовка под блокировкой всего файла
+  Leaderboard* board = NULL;
+  LeaderboardHeader header;
+  memset(&header, 0, sizeof(header));
+  struct stat st;
+  if (lock_range(fd, F_WRLCK, 0, 0) == 0 && fstat(fd, &st) == 0) {
+    int ok = 1;
+    if (pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+        header.magic != LEADERBOARD_MAGIC) {
+      // пустой или недописанный файл создаём заново, чужой не трогаем
+      ok = (st.st_size == 0 || header.magic == 0) && players > 0 &&
+           init_file(fd, players) == 0 && fstat(fd, &st) == 0 &&
+           pread(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header);
+    }
+    ok = ok && header_valid(&header, st.st_size);
+    size_t size = ok ? (size_t)record_offset(header.players) : 0;
+    void* map = ok ? mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                   : MAP_FAILED;
+    if (map != MAP_FAILED) {
+      board = calloc(1, sizeof(*board));
+      if (board) {
+        board->fd = fd;
+        board->map = map;
+        board->size = size;
+        board->header = map;
+        board->records =
+            (LeaderboardRecord*)((char*)map + sizeof(LeaderboardHeader));
+        pthread_mutex_init(&board->lock, NULL);
+      } else {
+        munmap(map, size);
+      }
+    }
+    lock_range(fd, F_UNLCK, 0, 0);
+  }
+  if (!board) close(fd);
+  return board;
+}
+
+void leaderboard_close(Leaderboard* board) {
+  if (!board) return;
+  munmap(board->map, board->size);
+  close(board->fd);
+  pthread_mutex_destroy(&board->lock);
+  free(board);
+}
+
+uint32_t leaderboard_players(const Leaderboard* board) {
+  return board->header->players;
+}
+
+int leaderboard_submit(Leaderboard* board, uint32_t player, int32_t score) {
+  if (player >= board->header->players) return -1;
+  LeaderboardRecord* r = &board->records[player];
+  pthread_mutex_lock(&board->lock);
+  int result = -1;
+  off_t offset = record_offset(player);
+  if (lock_range(board->fd, F_WRLCK, offset, sizeof(*r)) == 0) {
+    LeaderboardEntry next;
+    if (read_entry(r, &next) == 0) {
+      result = entry_insert(&next, score);
+      // счётчик игр меняется всегда, так что запись обновляется всегда
+      next.checksum = entry_checksum(&next);
+      unsigned active = atomic_load_explicit(&r->active, memory_order_relaxed);
+      memcpy(&r->copy[(active & 1) ^ 1], &next, sizeof(next));
+      atomic_store_explicit(&r->active, (active & 1) ^ 1,
+                            memory_order_release);
+    }
+    lock_range(board->fd, F_UNLCK, offset, sizeof(*r));
+  }
+  pthread_mutex_unlock(&board->lock);
+  return result;
+}
+
+int32_t leaderboard_best(const Leaderboard* board, uint32_t player) {
+  LeaderboardEntry e;
+  if (player >= board->header->players ||
+      read_entry(&board->records[player], &e) != 0 || e.count == 0)
+    return -1;
+  return e.best;
+}
+
+static int desc(const void* a, const void* b) {
+  int32_t x = *(const int32_t*)a, y = *(const int32_t*)b;
+  return (x < y) - (x > y);
+}
+
+int leaderboard_top(const Leaderboard* board, uint32_t player, int32_t* out) {
+  LeaderboardEntry e;
+  if (player >= board->header->players ||
+      read_entry(&board->records[player], &e) != 0)
+    return 0;
+  memcpy(out, e.heap, sizeof(int32_t) * e.count);
+  qsort(out, e.count, sizeof(int32_t), desc);
+  return (int)e.count;
+}
+
+int leaderboard_sync(Leaderboard* board) {
+  return msync(board->map, board->size, MS_SYNC);
+}
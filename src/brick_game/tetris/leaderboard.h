@@ -0,0 +1,63 @@
+#ifndef LEADERBOARD_H_
+#define LEADERBOARD_H_
+#include <stdatomic.h>
+#include <stdint.h>
+
+// Бинарная таблица рекордов в файле, отображённом через mmap:
+// заголовок, затем записи игроков фиксированного размера, так что запись
+// игрока находится по номеру слота за O(1). У каждого игрока лучшие
+// LEADERBOARD_TOP_N результатов в min-куче: новый результат либо
+// отбрасывается сравнением с корнем, либо встаёт в кучу за O(log N).
+//
+// Запись игрока хранится в двух копиях с контрольной суммой, active
+// указывает на текущую. Обновление пишет неактивную копию и одним
+// атомарным присваиванием переключает active, поэтому падение процесса в
+// любой момент оставляет целую копию. Писатели разных процессов
+// сериализуются блокировкой fcntl на байты своей записи, читатели не
+// блокируются: копия с неверной суммой перечитывается.
+
+#define LEADERBOARD_MAGIC 0x42524C54u  // "TLRB"
+#define LEADERBOARD_VERSION 1
+#define LEADERBOARD_TOP_N 16
+
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t top_n;
+  uint32_t players;
+  uint32_t record_size;
+  uint8_t reserved[48];
+} LeaderboardHeader;
+
+typedef struct {
+  uint32_t count;                      // результатов в куче
+  int32_t best;                        // максимум кучи, для O(1) чтения
+  int32_t heap[LEADERBOARD_TOP_N];     // min-куча, heap[0] - худший из топа
+  uint32_t games;                      // всего присланных результатов
+  uint32_t checksum;
+} LeaderboardEntry;
+
+typedef struct {
+  _Alignas(64) atomic_uint active;  // 0 или 1
+  uint32_t reserved;
+  LeaderboardEntry copy[2];
+} LeaderboardRecord;
+
+typedef struct Leaderboard Leaderboard;
+
+// открывает или создаёт файл на players слотов; у существующего файла
+// число слотов берётся из заголовка. NULL - ошибка или чужой формат
+Leaderboard* leaderboard_open(const char* path, uint32_t players);
+void leaderboard_close(Leaderboard* board);
+uint32_t leaderboard_players(const Leaderboard* board);
+
+// 1 - результат вошёл в топ игрока, 0 - нет, -1 - ошибка
+int leaderboard_submit(Leaderboard* board, uint32_t player, int32_t score);
+// лучший результат игрока, -1 если их нет
+int32_t leaderboard_best(const Leaderboard* board, uint32_t player);
+// топ игрока по убыванию в out[LEADERBOARD_TOP_N], возвращает количество
+int leaderboard_top(const Leaderboard* board, uint32_t player, int32_t* out);
+// msync: для сохранности при падении системы, а не только процесса
+int leaderboard_sync(Leaderboard* board);
+
+#endif
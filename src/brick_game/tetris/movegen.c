@@ -0,0 +1,109 @@
+#include "movegen.h"
+
+#define COL_OFFSET 4  // col >= -4, в битовых масках позиция col + 4
+#define QUEUE_SIZE (4 * FIELD_ROWS * (FIELD_COLS + COL_OFFSET + 3))
+#define ROW_OFFSET 4  // канонический row может уйти до -3
+
+typedef struct {
+  int8_t rotation, row, col;
+} Node;
+
+typedef struct {
+  int8_t rotation, drow, dcol;
+} Canonical;
+
+// маска поворота, прижатая к верхнему левому углу, и её сдвиг в 4на4
+static void normalize(TetrominoId id, int rotation, int* top, int* left,
+                      uint16_t bits[4]) {
+  const uint16_t* mask = TETROMINO_ROW_BITS[id][rotation];
+  uint16_t any = mask[0] | mask[1] | mask[2] | mask[3];
+  *top = 0;
+  while (!mask[*top]) (*top)++;
+  *left = 0;
+  while (!(any >> *left & 1)) (*left)++;
+  for (int r = 0; r < 4; ++r)
+    bits[r] = *top + r < 4 ? (uint16_t)(mask[*top + r] >> *left) : 0;
+}
+
+// для симметричных фигур поворот с тем же набором клеток сводится к
+// меньшему: (rotation, row, col) == (c.rotation, row + c.drow, col + c.dcol)
+static void canonical_rotations(TetrominoId id, Canonical canon[4]) {
+  int top[4], left[4];
+  uint16_t bits[4][4];
+  for (int rot = 0; rot < 4; ++rot) {
+    normalize(id, rot, &top[rot], &left[rot], bits[rot]);
+    canon[rot] = (Canonical){(int8_t)rot, 0, 0};
+    for (int k = 0; k < rot; ++k) {
+      if (memcmp(bits[k], bits[rot], sizeof(bits[k])) == 0) {
+        canon[rot] = (Canonical){(int8_t)k, (int8_t)(top[rot] - top[k]),
+                                 (int8_t)(left[rot] - left[k])};
+        break;
+      }
+    }
+  }
+}
+
+int movegen_placements(const EngineState* e, TetrominoId id, int rotation,
+                       int row, int col, TetrisPlacement* out) {
+  if (row < 0 || row >= FIELD_ROWS ||
+      !can_place_tetromino_in_field(e, id, rotation, row, col))
+    return 0;
+  uint32_t visited[4][FIELD_ROWS] = {{0}};
+  uint32_t landed[4][FIELD_ROWS + ROW_OFFSET] = {{0}};
+  Canonical canon[4];
+  canonical_rotations(id, canon);
+  Node queue[QUEUE_SIZE];
+  int head = 0, tail = 0, count = 0;
+  queue[tail++] = (Node){(int8_t)rotation, (int8_t)row, (int8_t)col};
+  visited[rotation][row] |= 1u << (col + COL_OFFSET);
+  while (head < tail) {
+    Node n = queue[head++];
+    Node next[4] = {{n.rotation, n.row, (int8_t)(n.col - 1)},
+                    {n.rotation, n.row, (int8_t)(n.col + 1)},
+                    {(int8_t)((n.rotation + 1) & 3), n.row, n.col},
+                    {n.rotation, (int8_t)(n.row + 1), n.col}};
+    int can_fall = 0;
+    for (int i = 0; i < 4; ++i) {
+      Node m = next[i];
+      if (!can_place_tetromino_in_field(e, id, m.rotation, m.row, m.col))
+        continue;
+      if (i == 3) can_fall = 1;
+      uint32_t bit = 1u << (m.col + COL_OFFSET);
+      if (visited[m.rotation][m.row] & bit) continue;
+      visited[m.rotation][m.row] |= bit;
+      queue[tail++] = m;
+    }
+    if (can_fall || count >= MOVEGEN_MAX_PLACEMENTS) continue;
+    Canonical c = canon[n.rotation];
+    uint32_t* landed_row = &landed[c.rotation][n.row + c.drow + ROW_OFFSET];
+    uint32_t bit = 1u << (n.col + c.dcol + COL_OFFSET);
+    if (*landed_row & bit) continue;
+    *landed_row |= bit;
+    out[count++] = (TetrisPlacement){n.rotation, n.row, n.col};
+  }
+  return count;
+}
+
+int movegen_current(const TetrisGame* g, TetrisPlacement* out) {
+  if (g->state != FALLING) return 0;
+  const EngineState* e = &g->engine;
+  return movegen_placements(e, e->cur_tetromino_id, e->rotation, e->row,
+                            e->col, out);
+}
+
+uint64_t movegen_perft(TetrisGame* g, int depth) {
+  if (g->state != FALLING) return 0;
+  if (depth <= 0) return 1;
+  TetrisPlacement moves[MOVEGEN_MAX_PLACEMENTS];
+  int count = movegen_current(g, moves);
+  if (depth == 1) return (uint64_t)count;
+  uint64_t leaves = 0;
+  TetrisSnapshot snap;
+  tetris_save(g, &snap);
+  for (int i = 0; i < count; ++i) {
+    tetris_lock_at(g, moves[i].rotation, moves[i].row, moves[i].col);
+    leaves += movegen_perft(g, depth - 1);
+    tetris_restore(g, &snap);
+  }
+  return leaves;
+}
@@ -0,0 +1,27 @@
+#ifndef MOVEGEN_H_
+#define MOVEGEN_H_
+#include "game_logic.h"
+
+// с запасом: даже на изрезанном поле различных остановок меньше
+#define MOVEGEN_MAX_PLACEMENTS 512
+
+typedef struct {
+  int8_t rotation;
+  int8_t row;  // верх-лев клетка маски 4на4, как engine.row/col
+  int8_t col;
+} TetrisPlacement;
+
+// все конечные положения фигуры id, достижимые из (rotation, row, col)
+// ходами move_left/move_right/rotate и падением на одну строку. Положения с
+// одинаковым набором клеток (O, S, Z, I после поворота на 180) считаются
+// одним. Возвращает количество записанных в out
+int movegen_placements(const EngineState* e, TetrominoId id, int rotation,
+                       int row, int col, TetrisPlacement* out);
+// то же для текущей фигуры игры, 0 если игра не в FALLING
+int movegen_current(const TetrisGame* game, TetrisPlacement* out);
+
+// число листьев дерева размещений глубины depth: текущая фигура, затем
+// фигура из превью и дальше по очереди генератора
+uint64_t movegen_perft(TetrisGame* game, int depth);
+
+#endif
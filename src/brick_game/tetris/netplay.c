@@ -0,0 +1,307 @@
+#define _POSIX_C_SOURCE 200809L
+#include "netplay.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "game_clock.h"
+
+#define RING_MASK (NETPLAY_RING - 1)
+#define HEADER_SIZE 9
+
+static void put_u32(uint8_t* out, uint32_t v) {
+  for (int i = 0; i < 4; ++i) out[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint32_t get_u32(const uint8_t* in) {
+  return (uint32_t)in[0] | (uint32_t)in[1] << 8 | (uint32_t)in[2] << 16 |
+         (uint32_t)in[3] << 24;
+}
+
+static int remote(const NetplaySession* s) { return 1 - s->config.player; }
+
+static void apply_buttons(TetrisGame* g, uint8_t buttons) {
+  if (buttons & NET_LEFT) tetris_input(g, Left, false);
+  if (buttons & NET_RIGHT) tetris_input(g, Right, false);
+  if (buttons & NET_ROTATE) tetris_input(g, Action, false);
+  if (buttons & NET_SOFT_DROP) tetris_input(g, Down, true);
+  if (buttons & NET_HARD_DROP) tetris_input(g, Down, false);
+  if ((buttons & NET_START) && g->state == GAME_OVER)
+    tetris_input(g, Start, false);
+}
+
+// кадр f: снимок обеих игр до ввода, ввод, шаг. Ввод соперника, который
+// ещё не пришёл, предсказывается пустым и запоминается для сверки
+static void simulate(NetplaySession* s, uint32_t f) {
+  int slot = (int)(f & RING_MASK);
+  if (f >= s->confirmed) s->input[remote(s)][slot] = 0;
+  for (int p = 0; p < 2; ++p) {
+    tetris_save(&s->games[p], &s->snapshots[slot][p]);
+    apply_buttons(&s->games[p], s->input[p][slot]);
+    tetris_step(&s->games[p]);
+  }
+}
+
+static void rollback(NetplaySession* s) {
+  int64_t started = game_clock_now_ns();
+  uint32_t from = s->wrong;
+  for (int p = 0; p < 2; ++p)
+    tetris_restore(&s->games[p], &s->snapshots[from & RING_MASK][p]);
+  for (uint32_t f = from; f < s->frame; ++f) simulate(s, f);
+  int64_t elapsed = game_clock_now_ns() - started;
+  int depth = (int)(s->frame - from);
+  NetplayStats* st = &s->stats;
+  st->rollbacks++;
+  st->resim_frames += (uint64_t)depth;
+  if (depth > st->max_depth) st->max_depth = depth;
+  st->resim_ns += elapsed;
+  if (elapsed > st->worst_catchup_ns) st->worst_catchup_ns = elapsed;
+}
+
+// ввод соперника берётся только подряд с confirmed: пакеты с дырой перед
+// собой ждут повтора. Кадры дальше, чем помещается в кольцо за окном
+// отката, тоже ждут
+static void take_packet(NetplaySession* s, const uint8_t* data, int len) {
+  if (len < HEADER_SIZE || len != HEADER_SIZE + data[8]) return;
+  s->stats.packets_received++;
+  uint32_t first = get_u32(data);
+  uint32_t ack = get_u32(data + 4);
+  if (ack > s->peer_has && ack <= s->frame + (uint32_t)s->config.delay)
+    s->peer_has = ack;
+  uint32_t limit = s->frame + NETPLAY_RING - NETPLAY_MAX_ROLLBACK;
+  for (int i = 0; i < data[8]; ++i) {
+    uint32_t f = first + (uint32_t)i;
+    if (f < s->confirmed) continue;
+    if (f > s->confirmed || f >= limit) break;
+    uint8_t* cell = &s->input[remote(s)][f & RING_MASK];
+    uint8_t buttons = data[HEADER_SIZE + i];
+    if (f < s->frame && *cell != buttons && f < s->wrong) s->wrong = f;
+    *cell = buttons;
+    s->confirmed++;
+  }
+}
+
+// весь свой ввод, который пир ещё не подтвердил
+static int send_inputs(NetplaySession* s) {
+  uint8_t packet[NETPLAY_PACKET_MAX];
+  uint32_t end = s->frame + (uint32_t)s->config.delay;
+  uint32_t first = s->peer_has;
+  int count = (int)(end - first);
+  put_u32(packet, first);
+  put_u32(packet + 4, s->confirmed);
+  packet[8] = (uint8_t)count;
+  for (int i = 0; i < count; ++i)
+    packet[HEADER_SIZE + i] =
+        s->input[s->config.player][(first + (uint32_t)i) & RING_MASK];
+  s->stats.packets_sent++;
+  return s->transport.send(s->transport.ctx, packet,
+                           (size_t)(HEADER_SIZE + count));
+}
+
+int netplay_init(NetplaySession* s, const NetplayConfig* config,
+                 NetTransport transport) {
+  memset(s, 0, sizeof(*s));
+  if (config->player < 0 || config->player > 1 || config->delay < 0 ||
+      config->delay > NETPLAY_MAX_DELAY || config->max_rollback < 0 ||
+      config->max_rollback > NETPLAY_MAX_ROLLBACK)
+    return -1;
+  s->config = *config;
+  if (!s->config.max_rollback) s->config.max_rollback = NETPLAY_MAX_ROLLBACK;
+  s->transport = transport;
+  s->snapshots = malloc(NETPLAY_RING * sizeof(*s->snapshots));
+  if (!s->snapshots) return -1;
+  s->wrong = UINT32_MAX;
+  for (int p = 0; p < 2; ++p) {
+    TetrisGame* g = &s->games[p];
+    tetris_init(g);
+    tetris_set_randomizer(g, config->randomizer, config->seed);
+    tetris_input(g, Start, false);
+  }
+  return 0;
+}
+
+void netplay_free(NetplaySession* s) {
+  free(s->snapshots);
+  s->snapshots = NULL;
+}
+
+int netplay_advance(NetplaySession* s, uint8_t buttons) {
+  uint8_t packet[NETPLAY_PACKET_MAX];
+  int len;
+  while ((len = s->transport.recv(s->transport.ctx, packet, sizeof(packet))) >
+         0)
+    take_packet(s, packet, len);
+  if (len < 0) return -1;
+  if (s->wrong < s->frame) rollback(s);
+  s->wrong = UINT32_MAX;
+  uint32_t ahead = s->frame + (uint32_t)s->config.delay;
+  // дальше окна отката не предсказываем; неподтверждённый свой ввод
+  // должен помещаться в кольцо и в пакет
+  int stalled =
+      s->frame >= s->confirmed + (uint32_t)s->config.max_rollback ||
+      ahead + 1 > s->peer_has + NETPLAY_RING;
+  if (stalled) {
+    s->stats.stalls++;
+  } else {
+    s->input[s->config.player][ahead & RING_MASK] = buttons;
+    simulate(s, s->frame);
+    s->frame++;
+    s->stats.frames++;
+  }
+  if (send_inputs(s) != 0) return -1;
+  return stalled;
+}
+
+const TetrisGame* netplay_game(const NetplaySession* s, int player) {
+  return &s->games[player];
+}
+
+static uint32_t lag_random(NetLagLink* link) {
+  link->rng = link->rng * 6364136223846793005ull + 1442695040888963407ull;
+  return (uint32_t)(link->rng >> 33);
+}
+
+static int lag_send(void* ctx, const uint8_t* data, size_t len) {
+  NetLagEnd* end = ctx;
+  NetLagLink* link = end->link;
+  int to = 1 - end->side;
+  if (len > NETPLAY_PACKET_MAX) return -1;
+  if ((int)(lag_random(link) % 1000) < link->loss_permille ||
+      link->count[to] == NET_LAG_PACKETS) {
+    link->dropped++;
+    return 0;
+  }
+  NetLagPacket* packet = &link->queue[to][link->count[to]++];
+  int jitter = link->jitter_ms > 0
+                   ? (int)(lag_random(link) % (uint32_t)(link->jitter_ms + 1))
+                   : 0;
+  packet->deliver_ms = link->now_ms + link->latency_ms + jitter;
+  packet->len = (uint32_t)len;
+  memcpy(packet->data, data, len);
+  return 0;
+}
+
+// самый ранний из пришедших к now_ms; из одновременных - отправленный раньше
+static int lag_recv(void* ctx, uint8_t* buffer, size_t cap) {
+  NetLagEnd* end = ctx;
+  NetLagLink* link = end->link;
+  NetLagPacket* queue = link->queue[end->side];
+  int count = link->count[end->side];
+  int best = -1;
+  for (int i = 0; i < count; ++i)
+    if (queue[i].deliver_ms <= link->now_ms &&
+        (best < 0 || queue[i].deliver_ms < queue[best].deliver_ms))
+      best = i;
+  if (best < 0) return 0;
+  int len = (int)queue[best].len;
+  if ((size_t)len > cap) return -1;
+  memcpy(buffer, queue[best].data, (size_t)len);
+  memmove(&queue[best], &queue[best + 1],
+          (size_t)(count - best - 1) * sizeof(*queue));
+  link->count[end->side]--;
+  return len;
+}
+
+int net_lag_link_init(NetLagLink* link, int latency_ms, int jitter_ms,
+                      int loss_permille, uint64_t seed) {
+  memset(link, 0, sizeof(*link));
+  link->latency_ms = latency_ms;
+  link->jitter_ms = jitter_ms;
+  link->loss_permille = loss_permille;
+  link->rng = seed;
+  for (int i = 0; i < 2; ++i) {
+    link->ends[i].link = link;
+    link->ends[i].side = i;
+    link->queue[i] = malloc(NET_LAG_PACKETS * sizeof(NetLagPacket));
+    if (!link->queue[i]) {
+      net_lag_link_free(link);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+void net_lag_link_free(NetLagLink* link) {
+  for (int i = 0; i < 2; ++i) {
+    free(link->queue[i]);
+    link->queue[i] = NULL;
+  }
+}
+
+NetTransport net_lag_link_end(NetLagLink* link, int side) {
+  NetTransport t = {lag_send, lag_recv, &link->ends[side]};
+  return t;
+}
+
+int net_udp_open(NetUdp* udp, uint16_t port) {
+  udp->fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (udp->fd < 0) return -1;
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(port);
+  int flags = fcntl(udp->fd, F_GETFL, 0);
+  if (flags < 0 || fcntl(udp->fd, F_SETFL, flags | O_NONBLOCK) < 0 ||
+      bind(udp->fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+    net_udp_close(udp);
+    return -1;
+  }
+  return 0;
+}
+
+int net_udp_port(const NetUdp* udp) {
+  struct sockaddr_in addr;
+  socklen_t len = sizeof(addr);
+  if (udp->fd < 0 || getsockname(udp->fd, (struct sockaddr*)&addr, &len) < 0)
+    return -1;
+  return ntohs(addr.sin_port);
+}
+
+int net_udp_connect(NetUdp* udp, const char* host, uint16_t port) {
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  if (inet_pton(AF_INET, host, &addr.sin_addr) != 1) return -1;
+  return connect(udp->fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 ? -1 : 0;
+}
+
+void net_udp_close(NetUdp* udp) {
+  if (udp->fd >= 0) close(udp->fd);
+  udp->fd = -1;
+}
+
+// ECONNREFUSED - ICMP от прошлой отправки, пир ещё не открыл порт
+static bool transient(int err) {
+  return err == EAGAIN || err == EWOULDBLOCK || err == ECONNREFUSED ||
+         err == EINTR;
+}
+
+static int udp_send(void* ctx, const uint8_t* data, size_t len) {
+  NetUdp* udp = ctx;
+  if (send(udp->fd, data, len, 0) >= 0) return 0;
+  return transient(errno) ? 0 : -1;
+}
+
+static int udp_recv(void* ctx, uint8_t* buffer, size_t cap) {
+  NetUdp* udp = ctx;
+  for (;;) {
+    ssize_t len = recv(udp->fd, buffer, cap, 0);
+    if (len > 0) return (int)len;
+    if (len == 0) continue;  // пустой пакет - не наш
+    if (errno == ECONNREFUSED || errno == EINTR) continue;
+    return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+  }
+}
+
+NetTransport net_udp_transport(NetUdp* udp) {
+  NetTransport t = {udp_send, udp_recv, udp};
+  return t;
+}
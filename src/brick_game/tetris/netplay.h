@@ -0,0 +1,141 @@
+#ifndef NETPLAY_H_
+#define NETPLAY_H_
+#include <stddef.h>
+#include <stdint.h>
+
+#include "game_logic.h"
+
+// Игра вдвоём по сети с откатом. Каждая сторона ведёт обе игры (свою и
+// соперника) шагами tetris_step(), один кадр - один шаг. Свой ввод кадра
+// сразу уходит пиру и применяется через delay кадров, ввод соперника, пока
+// не пришёл, предсказывается пустым. Когда настоящий ввод приходит и
+// расходится с предсказанием, обе игры откатываются к снимку того кадра и
+// перепрогоняются до текущего. Снимок обеих игр пишется каждый кадр.
+// Дальше max_rollback кадров от последнего подтверждённого ввода соперника
+// сторона не убегает - ждёт его.
+//
+// Пакет: u32 первый кадр, u32 подтверждено (до какого кадра пришёл ввод
+// соперника), u8 число кадров, по байту кнопок на кадр. В каждом пакете
+// весь ввод, который пир ещё не подтвердил, так что потерянный пакет
+// покрывается следующим.
+
+#define NETPLAY_RING 64          // кадров истории, степень двойки
+#define NETPLAY_MAX_ROLLBACK 32  // откат не глубже
+#define NETPLAY_MAX_DELAY 8
+#define NETPLAY_PACKET_MAX (9 + NETPLAY_RING)
+
+// кнопки кадра, применяются в этом порядке
+enum {
+  NET_LEFT = 1 << 0,
+  NET_RIGHT = 1 << 1,
+  NET_ROTATE = 1 << 2,
+  NET_SOFT_DROP = 1 << 3,
+  NET_HARD_DROP = 1 << 4,
+  NET_START = 1 << 5,  // новая партия после Game Over
+};
+
+// пакеты как есть, без порядка и гарантии доставки (UDP)
+typedef struct {
+  // 0 - отправлено, -1 - ошибка
+  int (*send)(void* ctx, const uint8_t* data, size_t len);
+  // длина принятого пакета, 0 - пакетов нет, -1 - ошибка
+  int (*recv)(void* ctx, uint8_t* buffer, size_t cap);
+  void* ctx;
+} NetTransport;
+
+typedef struct {
+  int player;        // 0 или 1 - чей ввод локальный
+  int delay;         // задержка своего ввода, 0..NETPLAY_MAX_DELAY
+  int max_rollback;  // 1..NETPLAY_MAX_ROLLBACK, 0 - максимум
+  RandomizerKind randomizer;  // у обеих игр один генератор и seed
+  uint64_t seed;
+} NetplayConfig;
+
+typedef struct {
+  uint64_t frames;        // сделано кадров
+  uint64_t stalls;        // вызовов, когда ждали соперника
+  uint64_t rollbacks;     // откатов
+  uint64_t resim_frames;  // перепрогнано кадров
+  int max_depth;          // самый глубокий откат, кадров
+  int64_t resim_ns;       // время откатов с перепрогоном
+  int64_t worst_catchup_ns;  // самый долгий откат с перепрогоном
+  uint64_t packets_sent;
+  uint64_t packets_received;
+} NetplayStats;
+
+typedef struct {
+  NetplayConfig config;
+  NetTransport transport;
+  TetrisGame games[2];
+  TetrisSnapshot (*snapshots)[2];  // [кадр % NETPLAY_RING], до его ввода
+  uint8_t input[2][NETPLAY_RING];  // у соперника - предсказание до прихода
+  uint32_t frame;      // сделано кадров, следующий - frame
+  uint32_t confirmed;  // ввод соперника известен для кадров < confirmed
+  uint32_t peer_has;   // пир подтвердил наш ввод для кадров < peer_has
+  uint32_t wrong;      // первый кадр с неверным предсказанием, UINT32_MAX нет
+  NetplayStats stats;
+} NetplaySession;
+
+// 0 - готово, обе игры начаты
+int netplay_init(NetplaySession* session, const NetplayConfig* config,
+                 NetTransport transport);
+void netplay_free(NetplaySession* session);
+// кнопки этого кадра (попадут в кадр frame + delay): приём пакетов, откат,
+// если предсказание не сбылось, шаг обеих игр, отправка. 0 - кадр сделан,
+// 1 - ждём соперника, кнопки не приняты, -1 - ошибка транспорта
+int netplay_advance(NetplaySession* session, uint8_t buttons);
+// игра игрока player (0 или 1) на текущем кадре
+const TetrisGame* netplay_game(const NetplaySession* session, int player);
+
+// Заместитель сети в памяти: пакеты между двумя концами приходят через
+// latency + случайные 0..jitter мс (могут обгонять друг друга) и теряются
+// с вероятностью loss_permille / 1000. Время ведёт вызывающий (now_ms),
+// так что прогон с тем же seed повторяется.
+#define NET_LAG_PACKETS 256  // в пути в одну сторону, лишние теряются
+
+typedef struct {
+  int64_t deliver_ms;
+  uint32_t len;
+  uint8_t data[NETPLAY_PACKET_MAX];
+} NetLagPacket;
+
+typedef struct NetLagLink NetLagLink;
+
+typedef struct {
+  NetLagLink* link;
+  int side;  // 0 или 1
+} NetLagEnd;
+
+struct NetLagLink {
+  int64_t now_ms;
+  int latency_ms;
+  int jitter_ms;
+  int loss_permille;
+  uint64_t rng;
+  NetLagEnd ends[2];
+  NetLagPacket* queue[2];  // queue[i] - в пути к концу i
+  int count[2];
+  uint64_t dropped;
+};
+
+// концы ссылаются на link, так что он не должен переезжать после init
+int net_lag_link_init(NetLagLink* link, int latency_ms, int jitter_ms,
+                      int loss_permille, uint64_t seed);
+void net_lag_link_free(NetLagLink* link);
+NetTransport net_lag_link_end(NetLagLink* link, int side);
+
+// неблокирующий UDP-сокет. Потеря пакета и отказ пира (ещё не открыл
+// порт) для NetTransport - не ошибка
+typedef struct {
+  int fd;
+} NetUdp;
+
+// port 0 - любой свободный, см. net_udp_port()
+int net_udp_open(NetUdp* udp, uint16_t port);
+int net_udp_port(const NetUdp* udp);  // -1 - не открыт
+// куда слать, принимаются пакеты только оттуда. host - IPv4 строкой
+int net_udp_connect(NetUdp* udp, const char* host, uint16_t port);
+void net_udp_close(NetUdp* udp);
+NetTransport net_udp_transport(NetUdp* udp);
+
+#endif
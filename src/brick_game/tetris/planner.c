@@ -0,0 +1,453 @@
+#define _POSIX_C_SOURCE 200809L
+#include "planner.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#include "bot.h"
+
+const PlannerConfig PLANNER_DEFAULT_CONFIG = {
+    .beam_width = 32,
+    .max_depth = 2,
+    .threads = 1,
+    .budget_ms = 50.0,  // один кадр cli-фронтенда
+    .weights =
+        {
+            .aggregate_height = -20,
+            .holes = -300,
+            .bumpiness = -20,
+            .row_transitions = -40,
+            .col_transitions = -90,
+            .wells = -30,
+            .lines = 60,
+        },
+};
+
+typedef struct {
+  TetrisSnapshot snap;
+  int32_t bonus;         // очки за строки, снятые по пути к позиции
+  TetrisPlacement root;  // ход текущей фигуры; у корня rotation = -1
+} PlanNode;
+
+typedef struct {
+  int32_t score;
+  int32_t bonus;
+  int32_t parent;
+  TetrisPlacement move;
+  TetrisPlacement root;
+} PlanChild;
+
+// у каждого потока своя игра-черновик и свои буферы, общие только узлы слоя
+typedef struct {
+  EvalBoards boards;
+  int32_t scores[EVAL_MAX_BOARDS];
+  TetrisPlacement moves[MOVEGEN_MAX_PLACEMENTS];
+  TetrisGame* game;
+  PlanChild* children;
+  int child_count;
+  int child_capacity;
+  long nodes;
+  long evaluated;  // оценённых досок, в том числе в оборванном слое
+  TetrisPlanner* owner;
+} PlanWorker;
+
+struct TetrisPlanner {
+  PlannerConfig config;
+  EvalPath path;
+  PlannerStats stats;
+  uint64_t config_key;  // ходы из таблицы годятся только при тех же весах
+  PlanWorker* workers;
+  int worker_count;
+
+  PlanNode* layer;  // раскрываемый слой
+  PlanNode* next;   // собирается из лучших детей
+  int layer_count;
+  PlanChild* merged;
+  int merged_capacity;
+  // позиции, уже взятые в следующий слой, по engine_hash: в таблице
+  // транспозиций, если она есть, иначе в seen (открытая адресация, 0 - пусто)
+  uint64_t* seen;
+  int seen_capacity;
+  int seen_mask;
+  uint64_t search_key;  // свой у каждого поиска, подмешивается в ключи слоя
+  long searches;
+
+  atomic_int cursor;     // следующий узел слоя
+  atomic_bool expired;   // бюджет кончился посреди слоя
+  double deadline;       // 0 - без ограничения
+  bool must_finish;      // первый слой не обрывается, иначе хода не будет
+
+  pthread_mutex_t lock;
+  pthread_cond_t start;
+  pthread_cond_t done;
+  long generation;  // номер слоя для помощников
+  int busy;         // помощников, ещё не закончивших слой
+  bool quit;
+  pthread_t threads[PLANNER_MAX_THREADS];
+  int thread_count;
+};
+
+static double planner_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static int placement_cmp(TetrisPlacement a, TetrisPlacement b) {
+  if (a.rotation != b.rotation) return a.rotation - b.rotation;
+  if (a.row != b.row) return a.row - b.row;
+  return a.col - b.col;
+}
+
+// строгий порядок, чтобы выбор не зависел от числа потоков
+static int child_better(const PlanChild* a, const PlanChild* b) {
+  if (a->score != b->score) return a->score > b->score;
+  int c = placement_cmp(a->root, b->root);
+  if (c) return c < 0;
+  if (a->parent != b->parent) return a->parent < b->parent;
+  return placement_cmp(a->move, b->move) < 0;
+}
+
+static int child_order(const void* a, const void* b) {
+  const PlanChild* x = a;
+  const PlanChild* y = b;
+  return child_better(x, y) ? -1 : child_better(y, x);
+}
+
+static int push_child(PlanWorker* w, const PlanChild* child) {
+  if (w->child_count == w->child_capacity) {
+    int capacity = w->child_capacity ? w->child_capacity * 2 : 1024;
+    PlanChild* grown = realloc(w->children, sizeof(PlanChild) * capacity);
+    if (!grown) return 0;
+    w->children = grown;
+    w->child_capacity = capacity;
+  }
+  w->children[w->child_count++] = *child;
+  return 1;
+}
+
+// проверяется между узлами и внутри раскрытия узла, так что бюджет
+// превышается не больше чем на одну стадию одного узла
+static bool out_of_time(TetrisPlanner* p) {
+  if (atomic_load_explicit(&p->expired, memory_order_relaxed)) return true;
+  if (p->must_finish || p->deadline <= 0 || planner_now() <= p->deadline)
+    return false;
+  atomic_store(&p->expired, true);
+  return true;
+}
+
+static void expand_node(TetrisPlanner* p, PlanWorker* w, int index) {
+  const PlanNode* node = &p->layer[index];
+  tetris_restore(w->game, &node->snap);
+  int count = bot_drop_placements(w->game, w->moves);
+  if (!count || out_of_time(p)) return;
+  const EngineState* e = &w->game->engine;
+  bot_build_boards(e, e->cur_tetromino_id, w->moves, count, &w->boards);
+  eval_score_boards(&w->boards, &p->config.weights, p->path, w->scores);
+  w->nodes++;
+  w->evaluated += count;
+  if (out_of_time(p)) return;  // слой всё равно не пойдёт в дело
+  for (int i = 0; i < count; ++i) {
+    PlanChild child = {
+        .score = node->bonus + w->scores[i],
+        .bonus = node->bonus + w->boards.lines[i] * p->config.weights.lines,
+        .parent = index,
+        .move = w->moves[i],
+        .root = node->root.rotation < 0 ? w->moves[i] : node->root,
+    };
+    if (!push_child(w, &child)) return;
+  }
+}
+
+static void run_layer(TetrisPlanner* p, PlanWorker* w) {
+  w->child_count = 0;
+  int index;
+  while ((index = atomic_fetch_add(&p->cursor, 1)) < p->layer_count) {
+    if (out_of_time(p)) break;
+    expand_node(p, w, index);
+  }
+}
+
+static void* helper_main(void* arg) {
+  PlanWorker* w = arg;
+  TetrisPlanner* p = w->owner;
+  long seen_generation = 0;
+  pthread_mutex_lock(&p->lock);
+  for (;;) {
+    while (!p->quit && p->generation == seen_generation)
+      pthread_cond_wait(&p->start, &p->lock);
+    if (p->quit) break;
+    seen_generation = p->generation;
+    pthread_mutex_unlock(&p->lock);
+    run_layer(p, w);
+    pthread_mutex_lock(&p->lock);
+    if (--p->busy == 0) pthread_cond_signal(&p->done);
+  }
+  pthread_mutex_unlock(&p->lock);
+  return NULL;
+}
+
+// раскрывает p->layer всеми потоками, 0 если бюджет оборвал слой
+static int expand_layer(TetrisPlanner* p) {
+  atomic_store(&p->cursor, 0);
+  atomic_store(&p->expired, false);
+  if (p->thread_count) {
+    pthread_mutex_lock(&p->lock);
+    p->busy = p->thread_count;
+    p->generation++;
+    pthread_cond_broadcast(&p->start);
+    pthread_mutex_unlock(&p->lock);
+  }
+  run_layer(p, &p->workers[0]);
+  if (p->thread_count) {
+    pthread_mutex_lock(&p->lock);
+    while (p->busy) pthread_cond_wait(&p->done, &p->lock);
+    pthread_mutex_unlock(&p->lock);
+  }
+  return !atomic_load(&p->expired);
+}
+
+static int reserve(void** buffer, int* capacity, int need, size_t size) {
+  if (need <= *capacity) return 1;
+  int grown_capacity = *capacity ? *capacity : 1024;
+  while (grown_capacity < need) grown_capacity *= 2;
+  void* grown = realloc(*buffer, size * grown_capacity);
+  if (!grown) return 0;
+  *buffer = grown;
+  *capacity = grown_capacity;
+  return 1;
+}
+
+// дети всех потоков -> p->merged от лучшего к худшему, число детей
+static int merge_children(TetrisPlanner* p) {
+  int total = 0;
+  for (int i = 0; i < p->worker_count; ++i)
+    total += p->workers[i].child_count;
+  if (!total) return 0;
+  if (!reserve((void**)&p->merged, &p->merged_capacity, total,
+               sizeof(PlanChild)))
+    return -1;
+  int count = 0;
+  for (int i = 0; i < p->worker_count; ++i) {
+    const PlanWorker* w = &p->workers[i];
+    if (!w->child_count) continue;  // children может быть ещё NULL
+    memcpy(p->merged + count, w->children, sizeof(PlanChild) * w->child_count);
+    count += w->child_count;
+  }
+  qsort(p->merged, count, sizeof(PlanChild), child_order);
+  return count;
+}
+
+static uint64_t mix64(uint64_t z) {  // splitmix64
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+// таблица для seen_position() на слой из candidates детей
+static int begin_layer_dedupe(TetrisPlanner* p, int candidates) {
+  if (p->config.tt) return 1;
+  int table = 1;
+  while (table < candidates * 2) table <<= 1;
+  if (!reserve((void**)&p->seen, &p->seen_capacity, table, sizeof(uint64_t)))
+    return 0;
+  memset(p->seen, 0, sizeof(uint64_t) * table);
+  p->seen_mask = table - 1;
+  return 1;
+}
+
+// позиция уже есть в собираемом слое. Все позиции слоя - после одного
+// числа фигур, так что одинаковый engine_hash - настоящая транспозиция:
+// та же доска, набранная другим порядком или другими ходами
+static bool seen_position(TetrisPlanner* p, uint64_t hash) {
+  uint64_t key = (hash ^ p->search_key) | 1;
+  if (p->config.tt) {
+    TTData data;
+    if (tt_probe(p->config.tt, key, &data)) return true;
+    data = (TTData){.depth = 0};  // метка слоя, не результат поиска
+    tt_store(p->config.tt, key, &data);
+    return false;
+  }
+  uint32_t slot = (uint32_t)key & (uint32_t)p->seen_mask;
+  while (p->seen[slot] && p->seen[slot] != key)
+    slot = (slot + 1) & (uint32_t)p->seen_mask;
+  if (p->seen[slot]) return true;
+  p->seen[slot] = key;
+  return false;
+}
+
+int planner_choose(TetrisPlanner* p, const TetrisGame* game,
+                   TetrisPlacement* best) {
+  if (game->state != FALLING) return 0;
+  double started = planner_now();
+  // ключи слоёв этого поиска не совпадут с прошлыми, а сами записи после
+  // tt_new_search() вытесняются первыми
+  p->search_key = mix64(++p->searches ^ (uint64_t)(uintptr_t)p);
+  if (p->config.tt) tt_new_search(p->config.tt);
+  // готовый ход для позиции на старте хода - из прошлых ходов и партий
+  uint64_t key = engine_hash(&game->engine) ^ p->config_key;
+  TTData cached;
+  if (p->config.tt && tt_probe(p->config.tt, key, &cached) &&
+      cached.depth >= p->config.max_depth) {
+    *best = cached.move;
+    p->stats.tt_hits++;
+    p->stats.moves++;
+    p->stats.last_depth = cached.depth;
+    p->stats.last_nodes = 0;
+    p->stats.last_seconds = planner_now() - started;
+    p->stats.depth_hist[cached.depth]++;
+    return 1;
+  }
+  p->deadline =
+      p->config.budget_ms > 0 ? started + p->config.budget_ms * 1e-3 : 0;
+  p->must_finish = true;
+  p->layer_count = 1;
+  tetris_save(game, &p->layer[0].snap);
+  p->layer[0].bonus = 0;
+  p->layer[0].root = (TetrisPlacement){.rotation = -1};
+  for (int i = 0; i < p->worker_count; ++i) {
+    p->workers[i].nodes = 0;
+    p->workers[i].evaluated = 0;
+  }
+
+  int depth = 0, found = 0;
+  while (depth < p->config.max_depth) {
+    int complete = expand_layer(p);
+    if (!complete) {
+      p->stats.budget_cuts++;
+      break;
+    }
+    int count = merge_children(p);
+    if (count <= 0) break;
+    *best = p->merged[0].root;
+    found = 1;
+    depth++;
+    if (depth == p->config.max_depth) break;
+    // лучшие дети по порядку становятся следующим слоем, пока он не полон и
+    // осталось время; повтор позиции отбрасывается
+    p->must_finish = false;
+    if (!begin_layer_dedupe(p, count)) break;
+    TetrisGame* scratch = p->workers[0].game;
+    int kept = 0;
+    for (int i = 0; i < count && kept < p->config.beam_width; ++i) {
+      if (out_of_time(p)) break;
+      const PlanChild* child = &p->merged[i];
+      tetris_restore(scratch, &p->layer[child->parent].snap);
+      tetris_lock_at(scratch, child->move.rotation, child->move.row,
+                     child->move.col);
+      if (seen_position(p, engine_hash(&scratch->engine))) {
+        p->stats.duplicates++;
+        continue;
+      }
+      tetris_save(scratch, &p->next[kept].snap);
+      p->next[kept].bonus = child->bonus;
+      p->next[kept].root = child->root;
+      kept++;
+    }
+    if (atomic_load(&p->expired)) {
+      p->stats.budget_cuts++;
+      break;
+    }
+    PlanNode* swap = p->layer;
+    p->layer = p->next;
+    p->next = swap;
+    p->layer_count = kept;
+  }
+
+  double seconds = planner_now() - started;
+  long nodes = 0;
+  for (int i = 0; i < p->worker_count; ++i) {
+    nodes += p->workers[i].nodes;
+    p->stats.children += p->workers[i].evaluated;
+  }
+  p->stats.nodes += nodes;
+  p->stats.seconds += seconds;
+  if (seconds > p->stats.max_seconds) p->stats.max_seconds = seconds;
+  p->stats.last_depth = depth;
+  p->stats.last_nodes = nodes;
+  p->stats.last_seconds = seconds;
+  p->stats.depth_hist[depth]++;
+  if (found) p->stats.moves++;
+  // оборванный бюджетом поиск не сохраняется: в другой раз он может дойти
+  // глубже
+  if (found && p->config.tt && depth == p->config.max_depth) {
+    TTData data = {.score = p->merged[0].score, .depth = (uint8_t)depth,
+                   .move = *best};
+    tt_store(p->config.tt, key, &data);
+  }
+  return found;
+}
+
+const PlannerStats* planner_stats(const TetrisPlanner* p) {
+  return &p->stats;
+}
+
+void planner_destroy(TetrisPlanner* p) {
+  if (!p) return;
+  pthread_mutex_lock(&p->lock);
+  p->quit = true;
+  pthread_cond_broadcast(&p->start);
+  pthread_mutex_unlock(&p->lock);
+  for (int i = 0; i < p->thread_count; ++i) pthread_join(p->threads[i], NULL);
+  pthread_mutex_destroy(&p->lock);
+  pthread_cond_destroy(&p->start);
+  pthread_cond_destroy(&p->done);
+  for (int i = 0; i < p->worker_count; ++i) {
+    tetris_destroy(p->workers[i].game);
+    free(p->workers[i].children);
+  }
+  free(p->workers);
+  free(p->layer);
+  free(p->next);
+  free(p->merged);
+  free(p->seen);
+  free(p);
+}
+
+TetrisPlanner* planner_create(const PlannerConfig* config) {
+  TetrisPlanner* p = calloc(1, sizeof(TetrisPlanner));
+  if (!p) return NULL;
+  p->config = config ? *config : PLANNER_DEFAULT_CONFIG;
+  PlannerConfig* c = &p->config;
+  if (c->beam_width < 1) c->beam_width = 1;
+  if (c->max_depth < 1) c->max_depth = 1;
+  if (c->max_depth > PLANNER_MAX_DEPTH) c->max_depth = PLANNER_MAX_DEPTH;
+  if (c->threads < 1) c->threads = 1;
+  if (c->threads > PLANNER_MAX_THREADS) c->threads = PLANNER_MAX_THREADS;
+  p->path = eval_best_path();
+  const EvalWeights* w = &c->weights;
+  const int16_t weights[] = {w->aggregate_height, w->holes,
+                             w->bumpiness,        w->row_transitions,
+                             w->col_transitions,  w->wells,
+                             w->lines};
+  p->config_key = (uint64_t)c->beam_width * 0x9E3779B97F4A7C15ull;
+  for (size_t i = 0; i < sizeof(weights) / sizeof(weights[0]); ++i)
+    p->config_key = (p->config_key ^ (uint16_t)weights[i]) * 0x100000001b3ull;
+  pthread_mutex_init(&p->lock, NULL);
+  pthread_cond_init(&p->start, NULL);
+  pthread_cond_init(&p->done, NULL);
+
+  p->worker_count = c->threads;
+  size_t workers_size = sizeof(PlanWorker) * p->worker_count;
+  p->workers = aligned_alloc(32, (workers_size + 31) / 32 * 32);
+  p->layer = malloc(sizeof(PlanNode) * c->beam_width);
+  p->next = malloc(sizeof(PlanNode) * c->beam_width);
+  int ok = p->workers && p->layer && p->next;
+  if (p->workers) memset(p->workers, 0, workers_size);
+  for (int i = 0; ok && i < p->worker_count; ++i) {
+    p->workers[i].owner = p;
+    p->workers[i].game = tetris_create();
+    ok = p->workers[i].game != NULL;
+  }
+  for (int i = 1; ok && i < p->worker_count; ++i) {
+    ok = pthread_create(&p->threads[i - 1], NULL, helper_main,
+                        &p->workers[i]) == 0;
+    if (ok) p->thread_count++;
+  }
+  if (!ok) {
+    planner_destroy(p);
+    p = NULL;
+  }
+  return p;
+}
@@ -0,0 +1,55 @@
+#ifndef PLANNER_H_
+#define PLANNER_H_
+#include "evaluate.h"
+#include "movegen.h"
+#include "ttable.h"
+
+#define PLANNER_MAX_DEPTH 8
+#define PLANNER_MAX_THREADS 64
+
+// Beam search по размещениям: слой d - лучшие beam_width позиций после d
+// фигур. Первые две фигуры - текущая и превью; глубже фигуры берутся из
+// генератора движка (он детерминирован, как и в movegen_perft). Глубина
+// наращивается по одному слою, пока хватает бюджета времени, ход берётся из
+// последнего полностью просчитанного слоя. Бюджет считается от начала хода и
+// проверяется между узлами, внутри раскрытия узла и при сборке следующего
+// слоя; первый слой (одна текущая фигура) считается всегда. Превышение -
+// до одной стадии узла плюс слияние слоя, если поток не вытеснили.
+typedef struct {
+  int beam_width;     // позиций на слое
+  int max_depth;      // 1..PLANNER_MAX_DEPTH, 2 - текущая фигура и превью
+  int threads;        // потоков на раскрытие слоя, 1 - без потоков
+  double budget_ms;   // на один ход; <= 0 - без ограничения
+  EvalWeights weights;
+  TTable* tt;  // не NULL - ход для уже искавшейся позиции берётся из таблицы
+} PlannerConfig;
+
+typedef struct {
+  long moves;              // выбранных ходов
+  long nodes;              // раскрытых позиций
+  long children;           // оценённых досок, и в оборванных слоях тоже
+  long duplicates;         // детей, повторивших позицию в слое
+  long budget_cuts;        // ходов, где бюджет оборвал слой
+  long tt_hits;            // ходов, взятых из таблицы без поиска
+  double seconds;          // суммарное время поиска
+  double max_seconds;      // самый долгий ход
+  int last_depth;          // последний ход: глубина, узлы и время
+  long last_nodes;
+  double last_seconds;
+  long depth_hist[PLANNER_MAX_DEPTH + 1];  // сколько ходов на каждой глубине
+} PlannerStats;
+
+typedef struct TetrisPlanner TetrisPlanner;
+
+extern const PlannerConfig PLANNER_DEFAULT_CONFIG;
+
+// config == NULL - PLANNER_DEFAULT_CONFIG
+TetrisPlanner* planner_create(const PlannerConfig* config);
+void planner_destroy(TetrisPlanner* planner);
+
+// лучшее размещение текущей фигуры; 0 если игра не в FALLING
+int planner_choose(TetrisPlanner* planner, const TetrisGame* game,
+                   TetrisPlacement* best);
+const PlannerStats* planner_stats(const TetrisPlanner* planner);
+
+#endif
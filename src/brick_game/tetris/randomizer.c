@@ -0,0 +1,74 @@
+#include "randomizer.h"
+
+#include <string.h>
+
+static uint64_t splitmix64(uint64_t* x) {
+  uint64_t z = (*x += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+static inline uint32_t rotl(uint32_t x, int k) {
+  return (x << k) | (x >> (32 - k));
+}
+
+static inline uint32_t xoshiro_next(uint32_t* s) {
+  uint32_t result = rotl(s[1] * 5, 7) * 9;
+  uint32_t t = s[1] << 9;
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = rotl(s[3], 11);
+  return result;
+}
+
+// 0..n-1 умножением, без деления; смещение меньше 2^-29
+static inline uint8_t below(uint32_t* s, uint32_t n) {
+  return (uint8_t)(((uint64_t)xoshiro_next(s) * n) >> 32);
+}
+
+static void refill_bag(Randomizer* r) {
+  for (int i = 0; i < RANDOMIZER_PIECES; ++i) r->bag[i] = (uint8_t)i;
+  for (int i = RANDOMIZER_PIECES - 1; i > 0; --i) {  // Фишер-Йетс
+    int j = below(r->s, (uint32_t)i + 1);
+    uint8_t t = r->bag[i];
+    r->bag[i] = r->bag[j];
+    r->bag[j] = t;
+  }
+  r->bag_left = RANDOMIZER_PIECES;
+}
+
+void randomizer_seed(Randomizer* r, RandomizerKind kind, uint64_t seed) {
+  memset(r, 0, sizeof(*r));
+  r->kind = kind < RANDOMIZER_KINDS ? (uint8_t)kind : RANDOMIZER_CYCLE;
+  r->seed = seed;
+  // splitmix64 разводит соседние seed и не даёт нулевого состояния
+  uint64_t x = seed;
+  for (int i = 0; i < 4; i += 2) {
+    uint64_t z = splitmix64(&x);
+    r->s[i] = (uint32_t)z;
+    r->s[i + 1] = (uint32_t)(z >> 32);
+  }
+}
+
+void randomizer_fill(Randomizer* r, uint8_t* out, int n) {
+  if (n <= 0) return;
+  if (r->kind == RANDOMIZER_BAG7) {
+    for (int i = 0; i < n; ++i) {
+      if (!r->bag_left) refill_bag(r);
+      out[i] = r->bag[--r->bag_left];
+    }
+  } else if (r->kind == RANDOMIZER_MEMORYLESS) {
+    for (int i = 0; i < n; ++i) out[i] = below(r->s, RANDOMIZER_PIECES);
+  } else {
+    uint8_t id = (uint8_t)(r->count % RANDOMIZER_PIECES);
+    for (int i = 0; i < n; ++i) {
+      out[i] = id;
+      if (++id == RANDOMIZER_PIECES) id = 0;
+    }
+  }
+  r->count += (uint32_t)n;
+}
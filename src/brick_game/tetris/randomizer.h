@@ -0,0 +1,35 @@
+#ifndef RANDOMIZER_H_
+#define RANDOMIZER_H_
+#include <stdint.h>
+
+// Генераторы последовательности фигур. Состояние - только значения, живёт
+// в EngineState и копируется вместе со снимком, так что поиск и откат видят
+// те же будущие фигуры, что и сама игра. Случайные генераторы на
+// xoshiro128** (16 байт состояния, снимок остаётся маленьким): одинаковый
+// seed - одинаковая раздача на любой машине.
+
+#define RANDOMIZER_PIECES 7  // P_COUNT
+
+typedef enum {
+  RANDOMIZER_CYCLE = 0,   // 0, 1, ..., 6, 0, ... как раньше, seed не нужен
+  RANDOMIZER_BAG7,        // перемешанный мешок из всех семи фигур
+  RANDOMIZER_MEMORYLESS,  // каждая фигура равновероятна, без памяти
+  RANDOMIZER_KINDS
+} RandomizerKind;
+
+// нулевая структура - цикл с начала
+typedef struct {
+  uint64_t seed;   // с него начинается каждая новая партия
+  uint32_t s[4];   // xoshiro128**
+  uint32_t count;  // выдано фигур
+  uint8_t kind;    // RandomizerKind
+  uint8_t bag_left;  // осталось в мешке, берутся с конца
+  uint8_t bag[RANDOMIZER_PIECES];
+} Randomizer;
+
+// kind вне RandomizerKind - цикл
+void randomizer_seed(Randomizer* r, RandomizerKind kind, uint64_t seed);
+// следующие n фигур в out[0..n)
+void randomizer_fill(Randomizer* r, uint8_t* out, int n);
+
+#endif
@@ -0,0 +1,453 @@
+#include "replay.h"
+
+#include "game_logic.h"
+
+#define REPLAY_MAGIC "TRP1"
+#define REPLAY_END_MAGIC "TRPE"
+#define HEADER_SIZE 8
+#define FOOTER_SIZE 24
+
+enum {
+  // 0..7 - UserAction_t без удержания
+  OP_SOFT_DROP = 8,  // Down с hold = true
+  OP_PLACE,          // tetris_lock_at(): поворот, строка, колонка
+  OP_KEYFRAME,       // сжатый TetrisSnapshot
+  OP_END,            // delta - хвост шагов без ввода
+  OP_RANDOMIZER,     // tetris_set_randomizer(): вид, seed
+};
+
+static bool reserve(ReplayRecorder* rec, size_t extra) {
+  if (rec->failed) return false;
+  if (rec->len + extra <= rec->cap) return true;
+  size_t cap = rec->cap ? rec->cap : 4096;
+  while (cap < rec->len + extra) cap *= 2;
+  uint8_t* data = realloc(rec->data, cap);
+  if (!data) {
+    rec->failed = true;
+    return false;
+  }
+  rec->data = data;
+  rec->cap = cap;
+  return true;
+}
+
+static void put_byte(ReplayRecorder* rec, uint8_t byte) {
+  if (reserve(rec, 1)) rec->data[rec->len++] = byte;
+}
+
+static void put_varint(ReplayRecorder* rec, uint64_t v) {
+  while (v >= 0x80) {
+    put_byte(rec, (uint8_t)(v | 0x80));
+    v >>= 7;
+  }
+  put_byte(rec, (uint8_t)v);
+}
+
+static uint64_t zigzag(int64_t v) {
+  return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t unzigzag(uint64_t v) {
+  return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static void put_u32(uint8_t* out, uint32_t v) {
+  for (int i = 0; i < 4; ++i) out[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint32_t get_u32(const uint8_t* in) {
+  return (uint32_t)in[0] | (uint32_t)in[1] << 8 | (uint32_t)in[2] << 16 |
+         (uint32_t)in[3] << 24;
+}
+
+static void put_record(ReplayRecorder* rec, int op) {
+  put_varint(rec, (uint64_t)rec->pending << 4 | (uint64_t)op);
+  rec->pending = 0;
+}
+
+int replay_recorder_init(ReplayRecorder* rec, uint32_t interval) {
+  memset(rec, 0, sizeof(*rec));
+  rec->interval = interval ? interval : REPLAY_KEYFRAME_TICKS;
+  if (rec->interval > UINT16_MAX) return -1;
+  if (!reserve(rec, HEADER_SIZE)) return -1;
+  memcpy(rec->data, REPLAY_MAGIC, 4);
+  rec->data[4] = REPLAY_VERSION & 0xFF;
+  rec->data[5] = REPLAY_VERSION >> 8;
+  rec->data[6] = (uint8_t)(rec->interval & 0xFF);
+  rec->data[7] = (uint8_t)(rec->interval >> 8);
+  rec->len = HEADER_SIZE;
+  return 0;
+}
+
+void replay_recorder_free(ReplayRecorder* rec) {
+  free(rec->data);
+  free(rec->keyframe_tick);
+  free(rec->keyframe_offset);
+  memset(rec, 0, sizeof(*rec));
+}
+
+void replay_record_input(ReplayRecorder* rec, UserAction_t action, bool hold) {
+  if (rec->finished) return;
+  // удержание меняет смысл только у Down
+  put_record(rec, action == Down && hold ? OP_SOFT_DROP : (int)action);
+  rec->inputs++;
+}
+
+void replay_record_place(ReplayRecorder* rec, int rotation, int row, int col) {
+  if (rec->finished) return;
+  put_record(rec, OP_PLACE);
+  put_byte(rec, (uint8_t)(rotation & 3));
+  put_varint(rec, zigzag(row));
+  put_varint(rec, zigzag(col));
+  rec->inputs++;
+}
+
+void replay_record_randomizer(ReplayRecorder* rec, int kind, uint64_t seed) {
+  if (rec->finished) return;
+  put_record(rec, OP_RANDOMIZER);
+  put_byte(rec, (uint8_t)kind);
+  put_varint(rec, seed);
+}
+
+// генератор (у цикла xoshiro и мешок не нужны), затем очередь с головы
+static void put_queue(ReplayRecorder* rec, const EngineState* e) {
+  const Randomizer* r = &e->randomizer;
+  put_byte(rec, r->kind);
+  put_varint(rec, r->seed);
+  put_varint(rec, r->count);
+  if (r->kind != RANDOMIZER_CYCLE) {
+    for (int i = 0; i < 4; ++i) put_varint(rec, r->s[i]);
+    put_byte(rec, r->bag_left);
+    for (int i = 0; i < r->bag_left; ++i) put_byte(rec, r->bag[i]);
+  }
+  put_byte(rec, e->queue_len);
+  for (int i = 0; i < e->queue_len; ++i)
+    put_byte(rec, e->queue[(e->queue_head + i) & (TETRIS_QUEUE_SIZE - 1)]);
+}
+
+// поле: число пустых строк сверху, дальше по строке маска занятых клеток и
+// их цвета по 4 бита
+static void put_keyframe(ReplayRecorder* rec, const TetrisSnapshot* s) {
+  const EngineState* e = &s->engine;
+  put_byte(rec, (uint8_t)s->state);
+  put_byte(rec, (uint8_t)(e->cur_tetromino_id | e->rotation << 3));
+  put_byte(rec, (uint8_t)e->next_tetromino_id);
+  const int values[] = {e->row,   e->col,   e->score, e->high_score,
+                        e->level, e->speed, e->tick,  e->lines,
+                        e->pieces};
+  for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i)
+    put_varint(rec, zigzag(values[i]));
+  put_queue(rec, e);
+  int top = 0;
+  while (top < FIELD_ROWS && !engine_row_bits(e, top)) ++top;
+  put_byte(rec, (uint8_t)top);
+  for (int r = top; r < FIELD_ROWS; ++r) {
+    put_varint(rec, engine_row_bits(e, r));
+    int nibble = -1;
+    for (int c = 0; c < FIELD_COLS; ++c) {
+      if (!e->field[r][c]) continue;
+      if (nibble < 0) {
+        nibble = e->field[r][c];
+      } else {
+        put_byte(rec, (uint8_t)(nibble | e->field[r][c] << 4));
+        nibble = -1;
+      }
+    }
+    if (nibble >= 0) put_byte(rec, (uint8_t)nibble);
+  }
+}
+
+static void add_keyframe(ReplayRecorder* rec, const TetrisGame* game) {
+  if (rec->keyframes == rec->index_cap) {
+    uint32_t cap = rec->index_cap ? rec->index_cap * 2 : 16;
+    uint32_t* ticks = realloc(rec->keyframe_tick, cap * sizeof(uint32_t));
+    if (ticks) rec->keyframe_tick = ticks;
+    uint32_t* offsets =
+        ticks ? realloc(rec->keyframe_offset, cap * sizeof(uint32_t)) : NULL;
+    if (!offsets) {
+      rec->failed = true;
+      return;
+    }
+    rec->keyframe_offset = offsets;
+    rec->index_cap = cap;
+  }
+  put_record(rec, OP_KEYFRAME);
+  // смещение данных снимка, заголовок записи перед ним уже прочитан
+  rec->keyframe_tick[rec->keyframes] = rec->ticks;
+  rec->keyframe_offset[rec->keyframes] = (uint32_t)rec->len;
+  rec->keyframes++;
+  TetrisSnapshot snap;
+  tetris_save(game, &snap);
+  put_keyframe(rec, &snap);
+}
+
+void replay_record_step(ReplayRecorder* rec, const TetrisGame* game) {
+  if (rec->finished) return;
+  uint32_t last = rec->keyframes ? rec->keyframe_tick[rec->keyframes - 1] : 0;
+  if (rec->ticks - last >= rec->interval) add_keyframe(rec, game);
+  rec->ticks++;
+  rec->pending++;
+}
+
+int replay_finish(ReplayRecorder* rec, const TetrisGame* game) {
+  if (rec->finished) return rec->failed ? -1 : 0;
+  put_record(rec, OP_END);
+  rec->finished = true;
+  uint32_t index_offset = (uint32_t)rec->len;
+  for (uint32_t i = 0, tick = 0, offset = 0; i < rec->keyframes; ++i) {
+    put_varint(rec, rec->keyframe_tick[i] - tick);
+    put_varint(rec, rec->keyframe_offset[i] - offset);
+    tick = rec->keyframe_tick[i];
+    offset = rec->keyframe_offset[i];
+  }
+  if (!reserve(rec, FOOTER_SIZE)) return -1;
+  uint8_t* footer = rec->data + rec->len;
+  put_u32(footer, index_offset);
+  put_u32(footer + 4, rec->keyframes);
+  put_u32(footer + 8, rec->ticks);
+  put_u32(footer + 12, rec->inputs);
+  put_u32(footer + 16, (uint32_t)game->engine.score);
+  memcpy(footer + 20, REPLAY_END_MAGIC, 4);
+  rec->len += FOOTER_SIZE;
+  return rec->failed ? -1 : 0;
+}
+
+int replay_save(const ReplayRecorder* rec, const char* path) {
+  if (!rec->finished || rec->failed) return -1;
+  FILE* file = fopen(path, "wb");
+  if (!file) return -1;
+  int ok = fwrite(rec->data, 1, rec->len, file) == rec->len;
+  ok = fclose(file) == 0 && ok;
+  return ok ? 0 : -1;
+}
+
+typedef struct {
+  const uint8_t* data;
+  size_t pos;
+  size_t end;
+  bool bad;
+} Reader;
+
+static uint8_t get_byte(Reader* in) {
+  if (in->pos >= in->end) {
+    in->bad = true;
+    return 0;
+  }
+  return in->data[in->pos++];
+}
+
+static uint64_t get_varint(Reader* in) {
+  uint64_t v = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    uint8_t byte = get_byte(in);
+    v |= (uint64_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) return v;
+  }
+  in->bad = true;
+  return 0;
+}
+
+static int get_int(Reader* in) { return (int)unzigzag(get_varint(in)); }
+
+static bool valid_piece(int id) { return id >= 0 && id < P_COUNT; }
+
+// угол маски фигуры: хоть одна её клетка может быть на поле, сдвиги строк
+// при фиксации и в битовых масках не уходят за разрядность
+static bool valid_origin(int row, int col) {
+  return row > -MASK_SIZE && row < FIELD_ROWS && col > -MASK_SIZE &&
+         col < FIELD_COLS;
+}
+
+static int get_queue(Reader* in, EngineState* e) {
+  Randomizer* r = &e->randomizer;
+  r->kind = get_byte(in);
+  r->seed = get_varint(in);
+  r->count = (uint32_t)get_varint(in);
+  if (r->kind >= RANDOMIZER_KINDS) return -1;
+  if (r->kind != RANDOMIZER_CYCLE) {
+    for (int i = 0; i < 4; ++i) r->s[i] = get_varint(in);
+    r->bag_left = get_byte(in);
+    if (r->bag_left > RANDOMIZER_PIECES) return -1;
+    for (int i = 0; i < r->bag_left; ++i) {
+      r->bag[i] = get_byte(in);
+      if (!valid_piece(r->bag[i])) return -1;
+    }
+  }
+  e->queue_head = 0;
+  e->queue_len = get_byte(in);
+  if (e->queue_len > TETRIS_QUEUE_SIZE) return -1;
+  for (int i = 0; i < e->queue_len; ++i) {
+    e->queue[i] = get_byte(in);
+    if (!valid_piece(e->queue[i])) return -1;
+  }
+  return 0;
+}
+
+static int get_keyframe(Reader* in, TetrisSnapshot* s) {
+  memset(s, 0, sizeof(*s));
+  EngineState* e = &s->engine;
+  int state = get_byte(in);
+  int piece = get_byte(in);
+  int next = get_byte(in);
+  e->row = get_int(in);
+  e->col = get_int(in);
+  e->score = get_int(in);
+  e->high_score = get_int(in);
+  e->level = get_int(in);
+  e->speed = get_int(in);
+  e->tick = get_int(in);
+  e->lines = get_int(in);
+  e->pieces = get_int(in);
+  if (get_queue(in, e) != 0) return -1;
+  int top = get_byte(in);
+  if (state >= NUM_STATES || !valid_piece(piece & 7) ||
+      !valid_piece(next) || top > FIELD_ROWS || !valid_origin(e->row, e->col))
+    return -1;
+  s->state = (tetrisState_t)state;
+  e->cur_tetromino_id = (TetrominoId)(piece & 7);
+  e->rotation = piece >> 3 & 3;
+  e->next_tetromino_id = (TetrominoId)next;
+  for (int r = top; r < FIELD_ROWS && !in->bad; ++r) {
+    uint64_t bits = get_varint(in);
+    int nibble = -1;
+    for (int c = 0; c < FIELD_COLS; ++c) {
+      if (!(bits >> c & 1)) continue;
+      if (nibble < 0) {
+        nibble = get_byte(in);
+        e->field[r][c] = nibble & 0xF;
+        nibble >>= 4;
+      } else {
+        e->field[r][c] = (uint8_t)nibble;
+        nibble = -1;
+      }
+      if (!e->field[r][c] || e->field[r][c] > P_COUNT) return -1;
+    }
+  }
+  engine_rebuild_derived(e);
+  return in->bad ? -1 : 0;
+}
+
+int replay_player_open(ReplayPlayer* p, const uint8_t* data, size_t len) {
+  memset(p, 0, sizeof(*p));
+  if (len < HEADER_SIZE + FOOTER_SIZE || memcmp(data, REPLAY_MAGIC, 4) ||
+      (data[4] | data[5] << 8) != REPLAY_VERSION ||
+      memcmp(data + len - 4, REPLAY_END_MAGIC, 4))
+    return -1;
+  const uint8_t* footer = data + len - FOOTER_SIZE;
+  p->data = data;
+  p->interval = (uint32_t)(data[6] | data[7] << 8);
+  p->stream_end = get_u32(footer);
+  p->keyframes = get_u32(footer + 4);
+  p->ticks = get_u32(footer + 8);
+  p->inputs = get_u32(footer + 12);
+  p->score = (int32_t)get_u32(footer + 16);
+  if (p->stream_end < HEADER_SIZE || p->stream_end > len - FOOTER_SIZE ||
+      p->keyframes > len)
+    return -1;
+  p->keyframe_tick = malloc((p->keyframes + 1) * sizeof(uint32_t));
+  p->keyframe_offset = malloc((p->keyframes + 1) * sizeof(uint32_t));
+  if (!p->keyframe_tick || !p->keyframe_offset) {
+    replay_player_close(p);
+    return -1;
+  }
+  Reader in = {data, p->stream_end, len - FOOTER_SIZE, false};
+  uint32_t tick = 0, offset = 0;
+  for (uint32_t i = 0; i < p->keyframes; ++i) {
+    tick += (uint32_t)get_varint(&in);
+    offset += (uint32_t)get_varint(&in);
+    p->keyframe_tick[i] = tick;
+    p->keyframe_offset[i] = offset;
+    if (offset < HEADER_SIZE || offset >= p->stream_end) in.bad = true;
+  }
+  if (in.bad) {
+    replay_player_close(p);
+    return -1;
+  }
+  return 0;
+}
+
+void replay_player_close(ReplayPlayer* p) {
+  free(p->keyframe_tick);
+  free(p->keyframe_offset);
+  p->keyframe_tick = p->keyframe_offset = NULL;
+}
+
+// проигрывает записи с in->pos, считая, что сделано tick шагов, пока не
+// будет сделано target шагов и применены все записи этого тика
+static int play(const ReplayPlayer* p, TetrisGame* game, Reader* in,
+                uint32_t tick, uint32_t target) {
+  while (in->pos < in->end && !in->bad) {
+    size_t record = in->pos;
+    uint64_t head = get_varint(in);
+    uint64_t delta = head >> 4;
+    if (tick + delta > target) {
+      in->pos = record;
+      break;
+    }
+    for (; delta > 0; --delta, ++tick) tetris_step(game);
+    int op = (int)(head & 0xF);
+    if (op <= Action) {
+      tetris_input(game, (UserAction_t)op, false);
+    } else if (op == OP_SOFT_DROP) {
+      tetris_input(game, Down, true);
+    } else if (op == OP_PLACE) {
+      int rotation = get_byte(in);
+      int row = get_int(in);
+      int col = get_int(in);
+      if (!valid_origin(row, col)) return -1;
+      tetris_lock_at(game, rotation, row, col);
+    } else if (op == OP_KEYFRAME) {
+      TetrisSnapshot skip;
+      if (get_keyframe(in, &skip) != 0) return -1;
+    } else if (op == OP_RANDOMIZER) {
+      int kind = get_byte(in);
+      uint64_t seed = get_varint(in);
+      if (kind >= RANDOMIZER_KINDS) return -1;
+      tetris_set_randomizer(game, (RandomizerKind)kind, seed);
+    } else if (op == OP_END) {
+      break;
+    } else {
+      return -1;
+    }
+  }
+  if (in->bad) return -1;
+  if (target > p->ticks) target = p->ticks;
+  for (; tick < target; ++tick) tetris_step(game);
+  return 0;
+}
+
+int replay_seek(const ReplayPlayer* p, TetrisGame* game, uint32_t tick) {
+  tetris_set_persistent(game, false);
+  // последний снимок не позже tick
+  uint32_t lo = 0, hi = p->keyframes;
+  while (lo < hi) {
+    uint32_t mid = (lo + hi) / 2;
+    if (p->keyframe_tick[mid] <= tick)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  Reader in = {p->data, HEADER_SIZE, p->stream_end, false};
+  TetrisSnapshot snap;
+  memset(&snap, 0, sizeof(snap));  // как у tetris_create()
+  snap.state = START;
+  uint32_t from = 0;
+  if (lo > 0) {
+    in.pos = p->keyframe_offset[lo - 1];
+    from = p->keyframe_tick[lo - 1];
+    if (get_keyframe(&in, &snap) != 0) return -1;
+  }
+  tetris_restore(game, &snap);
+  return play(p, game, &in, from, tick);
+}
+
+int replay_verify(const ReplayPlayer* p, TetrisGame* game) {
+  tetris_set_persistent(game, false);
+  TetrisSnapshot snap;
+  memset(&snap, 0, sizeof(snap));
+  snap.state = START;
+  tetris_restore(game, &snap);
+  Reader in = {p->data, HEADER_SIZE, p->stream_end, false};
+  if (play(p, game, &in, 0, p->ticks) != 0) return -1;
+  return game->engine.score == p->score ? 0 : -1;
+}
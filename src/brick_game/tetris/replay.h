@@ -0,0 +1,80 @@
+#ifndef REPLAY_H_
+#define REPLAY_H_
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "game_interface.h"
+
+// Запись партии для архива и просмотра. Движок детерминирован, поэтому
+// хранится только ввод: каждое действие tetris_input() (и фиксация фигуры
+// автоигроком через tetris_lock_at()) одной записью
+//   varint(delta << 4 | op),
+// где delta - сколько tetris_step() прошло с прошлой записи. Нажатие через
+// 7 тиков и меньше - один байт. Раз в keyframe_interval тиков в поток
+// вставляется сжатый снимок движка, а после потока лежит индекс снимков,
+// так что перемотка к любому тику проигрывает не больше одного интервала.
+//
+//   "TRP1" u16 версия, u16 интервал | записи ... END | индекс | хвост 24 байта
+//
+// Целые в заголовке и хвосте little-endian. Генератор фигур (вид и seed)
+// пишется отдельной записью при подключении к игре и при каждой смене.
+// Версия 2: снимок хранит генератор и очередь фигур, версия 1 не читается.
+
+#define REPLAY_VERSION 2
+#define REPLAY_KEYFRAME_TICKS 600  // 30 с при TETRIS_TICK_MS = 50
+
+typedef struct ReplayRecorder {
+  uint8_t* data;
+  size_t len;
+  size_t cap;
+  uint32_t interval;
+  uint32_t ticks;    // выполнено tetris_step()
+  uint32_t pending;  // шагов после последней записи
+  uint32_t inputs;   // записей ввода и фиксаций
+  uint32_t keyframes;
+  uint32_t* keyframe_tick;  // индекс снимков
+  uint32_t* keyframe_offset;
+  uint32_t index_cap;
+  bool finished;
+  bool failed;  // не хватило памяти, запись испорчена
+} ReplayRecorder;
+
+// 0 - готово; interval 0 - REPLAY_KEYFRAME_TICKS
+int replay_recorder_init(ReplayRecorder* rec, uint32_t interval);
+void replay_recorder_free(ReplayRecorder* rec);
+// подключает запись к игре, NULL - отключает. Писать начинает с текущего
+// состояния, так что подключать до первого Start
+void tetris_set_recorder(TetrisGame* game, ReplayRecorder* rec);
+// закрывает поток, дописывает индекс и хвост с итоговым счётом game
+int replay_finish(ReplayRecorder* rec, const TetrisGame* game);
+int replay_save(const ReplayRecorder* rec, const char* path);
+
+// вызываются движком
+void replay_record_input(ReplayRecorder* rec, UserAction_t action, bool hold);
+void replay_record_place(ReplayRecorder* rec, int rotation, int row, int col);
+void replay_record_randomizer(ReplayRecorder* rec, int kind, uint64_t seed);
+void replay_record_step(ReplayRecorder* rec, const TetrisGame* game);
+
+typedef struct {
+  const uint8_t* data;
+  size_t stream_end;  // начало индекса
+  uint32_t interval;
+  uint32_t ticks;
+  uint32_t inputs;
+  int32_t score;
+  uint32_t keyframes;
+  uint32_t* keyframe_tick;
+  uint32_t* keyframe_offset;
+} ReplayPlayer;
+
+// data должна жить, пока открыт player. -1 - чужой или битый файл
+int replay_player_open(ReplayPlayer* player, const uint8_t* data, size_t len);
+void replay_player_close(ReplayPlayer* player);
+// game (без записи рекорда на диск) в состоянии после tick шагов: с
+// ближайшего снимка не позже tick. -1 - поток испорчен
+int replay_seek(const ReplayPlayer* player, TetrisGame* game, uint32_t tick);
+// вся партия с нулевого тика; 0 - итоговый счёт совпал с записанным
+int replay_verify(const ReplayPlayer* player, TetrisGame* game);
+
+#endif
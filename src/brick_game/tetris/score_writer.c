@@ -0,0 +1,157 @@
+#define _POSIX_C_SOURCE 200809L
+#include "score_writer.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct {
+  char path[SCORE_WRITER_PATH_MAX];
+  int pending;
+  bool dirty;  // pending ещё не на диске
+} WriterSlot;
+
+static struct {
+  pthread_mutex_t lock;
+  pthread_cond_t work;  // появился грязный слот или пора выходить
+  pthread_cond_t idle;  // поток закончил очередную запись
+  WriterSlot slots[SCORE_WRITER_SLOTS];
+  int slot_count;
+  int writing;  // записей, идущих прямо сейчас (0 или 1)
+  bool running;
+  bool quit;
+  bool start_failed;
+  pthread_t thread;
+  ScoreWriterStats stats;
+} writer = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .work = PTHREAD_COND_INITIALIZER,
+    .idle = PTHREAD_COND_INITIALIZER,
+};
+
+// временный файл уникален для процесса, rename атомарно подменяет path
+static int write_atomically(const char* path, int score) {
+  char tmp[SCORE_WRITER_PATH_MAX + 32];
+  snprintf(tmp, sizeof(tmp), "%s.%ld.tmp", path, (long)getpid());
+  FILE* file = fopen(tmp, "w");
+  if (!file) return -1;
+  int ok = fprintf(file, "%d\n", score) > 0;
+  ok = fflush(file) == 0 && ok;
+  fsync(fileno(file));  // не везде поддерживается, ошибка не критична
+  ok = fclose(file) == 0 && ok;
+  if (ok && rename(tmp, path) == 0) return 0;
+  remove(tmp);
+  return -1;
+}
+
+static WriterSlot* find_dirty_slot(void) {
+  for (int i = 0; i < writer.slot_count; ++i)
+    if (writer.slots[i].dirty) return &writer.slots[i];
+  return NULL;
+}
+
+static void* writer_main(void* arg) {
+  (void)arg;
+  pthread_mutex_lock(&writer.lock);
+  for (;;) {
+    WriterSlot* slot = find_dirty_slot();
+    if (!slot) {
+      if (writer.quit) break;
+      pthread_cond_wait(&writer.work, &writer.lock);
+      continue;
+    }
+    char path[SCORE_WRITER_PATH_MAX];
+    memcpy(path, slot->path, sizeof(path));
+    int score = slot->pending;
+    slot->dirty = false;
+    writer.writing++;
+    pthread_mutex_unlock(&writer.lock);
+
+    int status = write_atomically(path, score);
+
+    pthread_mutex_lock(&writer.lock);
+    writer.writing--;
+    if (status)
+      writer.stats.failed++;
+    else
+      writer.stats.written++;
+    pthread_cond_broadcast(&writer.idle);
+  }
+  pthread_mutex_unlock(&writer.lock);
+  return NULL;
+}
+
+// atexit: дописать всё и остановить поток, дальше запись синхронная
+static void stop_writer(void) {
+  pthread_mutex_lock(&writer.lock);
+  bool running = writer.running;
+  writer.quit = true;
+  pthread_cond_signal(&writer.work);
+  pthread_mutex_unlock(&writer.lock);
+  if (running) pthread_join(writer.thread, NULL);
+  pthread_mutex_lock(&writer.lock);
+  writer.running = false;
+  writer.start_failed = true;
+  pthread_mutex_unlock(&writer.lock);
+}
+
+static void start_writer_locked(void) {
+  if (writer.running || writer.start_failed) return;
+  if (pthread_create(&writer.thread, NULL, writer_main, NULL) == 0) {
+    writer.running = true;
+    atexit(stop_writer);
+  } else {
+    writer.start_failed = true;
+  }
+}
+
+static WriterSlot* slot_for_locked(const char* path) {
+  for (int i = 0; i < writer.slot_count; ++i)
+    if (strcmp(writer.slots[i].path, path) == 0) return &writer.slots[i];
+  if (writer.slot_count == SCORE_WRITER_SLOTS ||
+      strlen(path) >= SCORE_WRITER_PATH_MAX)
+    return NULL;
+  WriterSlot* slot = &writer.slots[writer.slot_count++];
+  strcpy(slot->path, path);
+  return slot;
+}
+
+int score_writer_submit(const char* path, int score) {
+  pthread_mutex_lock(&writer.lock);
+  writer.stats.submitted++;
+  start_writer_locked();
+  WriterSlot* slot = writer.running ? slot_for_locked(path) : NULL;
+  if (slot) {
+    slot->pending = score;
+    slot->dirty = true;
+    pthread_cond_signal(&writer.work);
+  }
+  pthread_mutex_unlock(&writer.lock);
+  if (slot) return 0;
+
+  int status = write_atomically(path, score);
+  pthread_mutex_lock(&writer.lock);
+  if (status)
+    writer.stats.failed++;
+  else
+    writer.stats.written++;
+  pthread_mutex_unlock(&writer.lock);
+  return -1;
+}
+
+void score_writer_flush(void) {
+  pthread_mutex_lock(&writer.lock);
+  while (writer.running && (find_dirty_slot() || writer.writing))
+    pthread_cond_wait(&writer.idle, &writer.lock);
+  pthread_mutex_unlock(&writer.lock);
+}
+
+ScoreWriterStats score_writer_stats(void) {
+  pthread_mutex_lock(&writer.lock);
+  ScoreWriterStats stats = writer.stats;
+  pthread_mutex_unlock(&writer.lock);
+  return stats;
+}
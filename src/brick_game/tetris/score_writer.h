@@ -0,0 +1,28 @@
+#ifndef SCORE_WRITER_H_
+#define SCORE_WRITER_H_
+
+// Фоновая запись рекорда. score_writer_submit() только кладёт значение в
+// слот файла и будит поток записи: мьютекс держится на время пары
+// присваиваний и никогда на время ввода-вывода. Поток пишет последнее
+// значение слота (промежуточные схлопываются) во временный файл и
+// переименовывает его поверх path, так что файл всегда целый.
+// Поток стартует при первой записи, при выходе из процесса всё
+// недописанное дописывается (atexit).
+
+#define SCORE_WRITER_SLOTS 4  // разных файлов одновременно
+#define SCORE_WRITER_PATH_MAX 256
+
+typedef struct {
+  long submitted;  // вызовов submit
+  long written;    // записей на диск
+  long failed;     // неудачных записей
+} ScoreWriterStats;
+
+// 0 - принято, -1 - не удалось (нет потока или свободного слота), тогда
+// значение уже записано синхронно
+int score_writer_submit(const char* path, int score);
+// ждёт, пока всё принятое окажется на диске
+void score_writer_flush(void);
+ScoreWriterStats score_writer_stats(void);
+
+#endif
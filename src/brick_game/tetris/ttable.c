@@ -0,0 +1,127 @@
+#include "ttable.h"
+
+typedef struct {
+  _Atomic uint64_t check;  // key ^ data
+  _Atomic uint64_t data;   // 0 - пусто
+} TTEntry;
+
+typedef struct {
+  _Alignas(64) TTEntry entries[TT_BUCKET_ENTRIES];
+} TTBucket;
+
+struct TTable {
+  TTBucket* buckets;
+  size_t mask;
+  uint8_t age;
+  TTStats stats;
+};
+
+// score:32 | depth:8 | age:8 | rotation:2 | row+8:7 | col+8:7
+static uint64_t pack(const TTData* d, uint8_t age) {
+  uint64_t move = (uint64_t)(d->move.rotation & 3) |
+                  (uint64_t)((d->move.row + 8) & 0x7F) << 2 |
+                  (uint64_t)((d->move.col + 8) & 0x7F) << 9;
+  return (uint64_t)(uint32_t)d->score | (uint64_t)d->depth << 32 |
+         (uint64_t)age << 40 | move << 48;
+}
+
+static void unpack(uint64_t v, TTData* d) {
+  d->score = (int32_t)(uint32_t)v;
+  d->depth = (uint8_t)(v >> 32);
+  uint64_t move = v >> 48;
+  d->move.rotation = (int8_t)(move & 3);
+  d->move.row = (int8_t)(((move >> 2) & 0x7F) - 8);
+  d->move.col = (int8_t)(((move >> 9) & 0x7F) - 8);
+}
+
+static uint8_t entry_age(uint64_t v) { return (uint8_t)(v >> 40); }
+static uint8_t entry_depth(uint64_t v) { return (uint8_t)(v >> 32); }
+
+static void count(atomic_long* counter) {
+  atomic_fetch_add_explicit(counter, 1, memory_order_relaxed);
+}
+
+TTable* tt_create(size_t bytes) {
+  TTable* tt = calloc(1, sizeof(TTable));
+  if (!tt) return NULL;
+  size_t buckets = 1;
+  while (buckets * 2 * sizeof(TTBucket) <= bytes) buckets *= 2;
+  tt->buckets = aligned_alloc(64, buckets * sizeof(TTBucket));
+  if (!tt->buckets) {
+    free(tt);
+    return NULL;
+  }
+  tt->mask = buckets - 1;
+  tt_clear(tt);
+  return tt;
+}
+
+void tt_destroy(TTable* tt) {
+  if (!tt) return;
+  free(tt->buckets);
+  free(tt);
+}
+
+void tt_clear(TTable* tt) {
+  memset(tt->buckets, 0, (tt->mask + 1) * sizeof(TTBucket));
+  tt->age = 0;
+}
+
+void tt_new_search(TTable* tt) { tt->age++; }
+
+size_t tt_buckets(const TTable* tt) { return tt->mask + 1; }
+
+const TTStats* tt_stats(const TTable* tt) { return &tt->stats; }
+
+int tt_probe(TTable* tt, uint64_t key, TTData* out) {
+  TTBucket* b = &tt->buckets[key & tt->mask];
+  int occupied = 0;
+  count(&tt->stats.probes);
+  for (int i = 0; i < TT_BUCKET_ENTRIES; ++i) {
+    uint64_t data =
+        atomic_load_explicit(&b->entries[i].data, memory_order_relaxed);
+    uint64_t check =
+        atomic_load_explicit(&b->entries[i].check, memory_order_relaxed);
+    if (!data) continue;
+    occupied++;
+    if ((check ^ data) == key) {
+      unpack(data, out);
+      count(&tt->stats.hits);
+      return 1;
+    }
+  }
+  count(&tt->stats.misses);
+  if (occupied == TT_BUCKET_ENTRIES) count(&tt->stats.collisions);
+  return 0;
+}
+
+void tt_store(TTable* tt, uint64_t key, const TTData* d) {
+  TTBucket* b = &tt->buckets[key & tt->mask];
+  int victim = -1, victim_rank = 0x7FFFFFFF;
+  for (int i = 0; i < TT_BUCKET_ENTRIES; ++i) {
+    uint64_t data =
+        atomic_load_explicit(&b->entries[i].data, memory_order_relaxed);
+    uint64_t check =
+        atomic_load_explicit(&b->entries[i].check, memory_order_relaxed);
+    if (data && (check ^ data) == key) {
+      // та же позиция: более мелкий результат текущего поиска не нужен
+      if (entry_age(data) == tt->age && entry_depth(data) > d->depth) return;
+      victim = i;
+      victim_rank = -2;
+      break;
+    }
+    // пустые, затем старые, затем мелкие
+    int rank = !data ? -1
+                     : (entry_age(data) != tt->age ? 0 : 1 + entry_depth(data));
+    if (rank < victim_rank) {
+      victim = i;
+      victim_rank = rank;
+    }
+  }
+  if (victim_rank >= 0) count(&tt->stats.replacements);
+  uint64_t data = pack(d, tt->age);
+  atomic_store_explicit(&b->entries[victim].data, data, memory_order_relaxed);
+  atomic_store_explicit(&b->entries[victim].check, key ^ data,
+                        memory_order_relaxed);
+  count(&tt->stats.stores);
+}
@@ -0,0 +1,44 @@
+#ifndef TTABLE_H_
+#define TTABLE_H_
+#include <stdatomic.h>
+#include <stddef.h>
+
+#include "movegen.h"
+
+#define TT_BUCKET_ENTRIES 4  // 4 записи по 16 байт - одна кэш-линия
+
+// Таблица транспозиций фиксированного размера по ключам engine_hash().
+// Запись - два 64-битных слова: данные и ключ ^ данные. Потоки пишут и
+// читают без блокировок, разорванная запись просто не совпадёт с ключом.
+// Замещение внутри корзины: та же позиция, пустая запись, запись прошлых
+// поисков (tt_new_search), иначе самая мелкая по depth.
+typedef struct {
+  int32_t score;
+  uint8_t depth;
+  TetrisPlacement move;
+} TTData;
+
+typedef struct {
+  atomic_long probes;
+  atomic_long hits;
+  atomic_long misses;
+  atomic_long collisions;    // промахи в корзине, занятой другими ключами
+  atomic_long stores;
+  atomic_long replacements;  // записи, вытеснившие чужую позицию
+} TTStats;
+
+typedef struct TTable TTable;
+
+// bytes округляется вниз до степени двойки корзин, минимум одна корзина
+TTable* tt_create(size_t bytes);
+void tt_destroy(TTable* tt);
+void tt_clear(TTable* tt);
+// новый поиск: записи старых поисков вытесняются в первую очередь
+void tt_new_search(TTable* tt);
+size_t tt_buckets(const TTable* tt);
+
+int tt_probe(TTable* tt, uint64_t key, TTData* out);
+void tt_store(TTable* tt, uint64_t key, const TTData* data);
+const TTStats* tt_stats(const TTable* tt);
+
+#endif
@@ -0,0 +1,148 @@
+#include "vec_env.h"
+
+#include <stdlib.h>
+
+#include "game_logic.h"
+
+struct TetrisVecEnv {
+  TetrisVecObs obs;
+  bool auto_reset;
+  TetrisGame* games;  // n подряд
+  int* last_score;
+  // engine.pieces, при котором board среды переписан последний раз; поле
+  // меняется только фиксацией фигуры, а за ней всегда идёт спавн
+  int* board_pieces;
+  RandomizerKind randomizer;
+  uint64_t seed;
+  uint64_t resets;  // партий начато, для seed следующей
+};
+
+#define OBS_ALIGN 64
+
+static size_t align_up(size_t size) {
+  return (size + OBS_ALIGN - 1) & ~(size_t)(OBS_ALIGN - 1);
+}
+
+size_t tetris_vec_obs_size(uint32_t n) {
+  return align_up(n * FIELD_ROWS * sizeof(uint16_t)) + 5 * align_up(n) +
+         align_up(n * sizeof(int32_t)) + align_up(n);
+}
+
+void tetris_vec_obs_bind(TetrisVecObs* obs, void* buffer, uint32_t n) {
+  char* p = buffer;
+  obs->n = n;
+  obs->board = (uint16_t*)p;
+  p += align_up(n * FIELD_ROWS * sizeof(uint16_t));
+  obs->piece_id = (uint8_t*)p;
+  p += align_up(n);
+  obs->piece_rotation = (uint8_t*)p;
+  p += align_up(n);
+  obs->piece_row = (int8_t*)p;
+  p += align_up(n);
+  obs->piece_col = (int8_t*)p;
+  p += align_up(n);
+  obs->next_id = (uint8_t*)p;
+  p += align_up(n);
+  obs->score_delta = (int32_t*)p;
+  p += align_up(n * sizeof(int32_t));
+  obs->done = (uint8_t*)p;
+}
+
+TetrisVecEnv* tetris_vec_create(const TetrisVecObs* obs, bool auto_reset) {
+  TetrisVecEnv* env = calloc(1, sizeof(*env));
+  if (!env) return NULL;
+  uint32_t n = obs->n;
+  env->obs = *obs;
+  env->auto_reset = auto_reset;
+  env->games = aligned_alloc(OBS_ALIGN, align_up(n * sizeof(TetrisGame)));
+  env->last_score = calloc(n, sizeof(int));
+  env->board_pieces = calloc(n, sizeof(int));
+  if (!env->games || !env->last_score || !env->board_pieces) {
+    tetris_vec_destroy(env);
+    return NULL;
+  }
+  for (uint32_t i = 0; i < n; ++i) tetris_init(&env->games[i]);
+  tetris_vec_reset(env, NULL);
+  return env;
+}
+
+void tetris_vec_destroy(TetrisVecEnv* env) {
+  if (!env) return;
+  free(env->games);
+  free(env->last_score);
+  free(env->board_pieces);
+  free(env);
+}
+
+static void write_obs(TetrisVecEnv* env, uint32_t i) {
+  const TetrisVecObs* obs = &env->obs;
+  const EngineState* e = &env->games[i].engine;
+  if (env->board_pieces[i] != e->pieces) {
+    env->board_pieces[i] = e->pieces;
+    uint16_t* board = obs->board + (size_t)i * FIELD_ROWS;
+    for (int r = 0; r < FIELD_ROWS; ++r) board[r] = engine_row_bits(e, r);
+  }
+  obs->piece_id[i] = (uint8_t)e->cur_tetromino_id;
+  obs->piece_rotation[i] = (uint8_t)e->rotation;
+  obs->piece_row[i] = (int8_t)e->row;
+  obs->piece_col[i] = (int8_t)e->col;
+  obs->next_id[i] = (uint8_t)e->next_tetromino_id;
+}
+
+static void restart(TetrisVecEnv* env, uint32_t i) {
+  if (env->randomizer != RANDOMIZER_CYCLE)
+    tetris_set_randomizer(&env->games[i], env->randomizer,
+                          env->seed + env->resets++);
+  tetris_input(&env->games[i], Start, false);
+  env->last_score[i] = 0;
+  env->board_pieces[i] = -1;
+}
+
+void tetris_vec_reset(TetrisVecEnv* env, const uint8_t* mask) {
+  for (uint32_t i = 0; i < env->obs.n; ++i) {
+    if (mask && !mask[i]) continue;
+    restart(env, i);
+    env->obs.score_delta[i] = 0;
+    env->obs.done[i] = 0;
+    write_obs(env, i);
+  }
+}
+
+void tetris_vec_set_randomizer(TetrisVecEnv* env, RandomizerKind kind,
+                               uint64_t seed) {
+  env->randomizer = kind;
+  env->seed = seed;
+  env->resets = 0;
+}
+
+void tetris_vec_step(TetrisVecEnv* env, const uint8_t* actions) {
+  const TetrisVecObs* obs = &env->obs;
+  for (uint32_t i = 0; i < obs->n; ++i) {
+    TetrisGame* g = &env->games[i];
+    switch (actions[i]) {
+      case TETRIS_VEC_LEFT:
+        tetris_input(g, Left, false);
+        break;
+      case TETRIS_VEC_RIGHT:
+        tetris_input(g, Right, false);
+        break;
+      case TETRIS_VEC_ROTATE:
+        tetris_input(g, Action, false);
+        break;
+      case TETRIS_VEC_SOFT_DROP:
+        tetris_input(g, Down, true);
+        break;
+      case TETRIS_VEC_HARD_DROP:
+        tetris_input(g, Down, false);
+        break;
+      default:
+        break;
+    }
+    tetris_step(g);
+    obs->score_delta[i] = g->engine.score - env->last_score[i];
+    env->last_score[i] = g->engine.score;
+    obs->done[i] = g->state == GAME_OVER;
+    if (obs->done[i] && env->auto_reset) restart(env, i);
+    write_obs(env, i);
+  }
+}
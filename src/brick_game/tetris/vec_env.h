@@ -0,0 +1,63 @@
+#ifndef VEC_ENV_H_
+#define VEC_ENV_H_
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "randomizer.h"
+
+// Пакетный интерфейс для обучения с подкреплением: один вызов
+// tetris_vec_step() делает шаг во всех n играх и пишет наблюдения в один
+// буфер вызывающего, раскладка - структура массивов (каждый признак -
+// свой массив на n сред, массивы выровнены на 64 байта). Во время шагов
+// ничего не выделяется. Игры независимы, поэтому для нескольких ядер
+// среды делятся на несколько TetrisVecEnv, по одному на поток.
+
+typedef enum {
+  TETRIS_VEC_NOOP = 0,
+  TETRIS_VEC_LEFT,
+  TETRIS_VEC_RIGHT,
+  TETRIS_VEC_ROTATE,
+  TETRIS_VEC_SOFT_DROP,
+  TETRIS_VEC_HARD_DROP,
+  TETRIS_VEC_ACTIONS
+} TetrisVecAction;
+
+typedef struct {
+  uint32_t n;
+  // зафиксированные клетки: board[i * FIELD_ROWS + r], бит c - клетка
+  // (r, c) занята. Строки переписываются только когда поле изменилось,
+  // так что буфер должен оставаться тем же между шагами
+  uint16_t* board;
+  uint8_t* piece_id;  // падающая фигура (TetrominoId)
+  uint8_t* piece_rotation;
+  int8_t* piece_row;  // верхний левый угол маски 4на4
+  int8_t* piece_col;
+  uint8_t* next_id;       // превью
+  int32_t* score_delta;   // прирост счёта за шаг
+  uint8_t* done;          // партия закончилась на этом шаге (или раньше)
+} TetrisVecObs;
+
+// байт буфера наблюдений для n сред
+size_t tetris_vec_obs_size(uint32_t n);
+// раскладывает массивы obs по buffer (выровнен на 64 байта)
+void tetris_vec_obs_bind(TetrisVecObs* obs, void* buffer, uint32_t n);
+
+typedef struct TetrisVecEnv TetrisVecEnv;
+
+// obs должен жить, пока жива среда. auto_reset - закончившаяся партия
+// сразу начинается заново (done = 1 на шаге окончания, наблюдение уже от
+// новой партии), иначе стоит в GAME_OVER до tetris_vec_reset()
+TetrisVecEnv* tetris_vec_create(const TetrisVecObs* obs, bool auto_reset);
+void tetris_vec_destroy(TetrisVecEnv* env);
+// новые партии в средах с mask[i] != 0 (NULL - во всех), пишет наблюдения
+void tetris_vec_reset(TetrisVecEnv* env, const uint8_t* mask);
+// actions[i] - TetrisVecAction; действие, затем шаг часов игры
+void tetris_vec_step(TetrisVecEnv* env, const uint8_t* actions);
+// генератор фигур во всех средах, по умолчанию цикл. Каждая партия
+// получает свой seed из seed и номера сброса, так что раздачи разные, а
+// прогон с тем же seed и действиями повторяется. Действует с новых партий
+void tetris_vec_set_randomizer(TetrisVecEnv* env, RandomizerKind kind,
+                               uint64_t seed);
+
+#endif
@@ -0,0 +1,347 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "frontend.h"
+
+// Бэкенд без ncurses: кадр собирается в сетку клеток экрана, сравнивается
+// с тем, что уже выведено, и отличия кодируются в заранее выделенный
+// буфер truecolor-последовательностями. Весь кадр уходит одним write().
+// Курсор переставляется только при разрывах, короткий разрыв дешевле
+// перезаписать; цвет переключается только на границах цветовых отрезков,
+// длинные одноцветные отрезки пробелов стираются ECH.
+
+#define FRAME_BUFFER_SIZE 65536  // полный кадр ~25 КБ
+#define ERASE_MIN_RUN 12  // короче ECH + CUF не выигрывают у пробелов
+
+enum {
+  INK_TETROMINO = 0,  // + id фигуры
+  INK_FIELD = TETROMINO_COUNT,
+  INK_SIDEBAR,
+  INK_BORDER,
+  INK_PLAIN,  // цвета терминала по умолчанию, для надписей поверх поля
+  INK_COUNT
+};
+
+typedef struct {
+  uint8_t ink;
+  char glyph;
+} Cell;
+
+static Cell next_frame[SCREEN_ROWS][SCREEN_COLS];
+static Cell shown[SCREEN_ROWS][SCREEN_COLS];
+static bool row_dirty[SCREEN_ROWS];  // в строке next_frame есть изменения
+static bool shown_valid;
+static bool clear_pending;  // после смены размера терминала
+
+// GameInfo_t, из которого собран next_frame: собирается заново только то,
+// что поменялось, как в frontend.c
+static struct {
+  bool valid;
+  int field[HIGHT_IN_PIXELS][WIDTH_IN_PIXELS];
+  int next[4][4];
+  int stats[5];  // score, high_score, level, speed, pause
+} composed;
+
+static char out[FRAME_BUFFER_SIZE];
+static size_t out_len;
+// полная смена цвета (с чёрным текстом) и только фон - текст и так чёрный
+static char ink_sgr[INK_COUNT][32];
+static size_t ink_sgr_len[INK_COUNT];
+static char ink_bg[INK_COUNT][32];
+static size_t ink_bg_len[INK_COUNT];
+
+static struct termios saved_termios;
+static bool termios_saved;
+
+static FrontendStats stats;
+
+static bool same_cell(Cell a, Cell b) {
+  return a.ink == b.ink && a.glyph == b.glyph;
+}
+
+static void emit(const char* bytes, size_t n) {
+  if (out_len + n > sizeof(out)) return;  // не бывает: кадр меньше буфера
+  memcpy(out + out_len, bytes, n);
+  out_len += n;
+}
+
+static void emit_str(const char* s) { emit(s, strlen(s)); }
+
+static void emit_csi(int a, int b, char final) {
+  char seq[24];
+  int n = b >= 0 ? snprintf(seq, sizeof(seq), "\x1b[%d;%d%c", a, b, final)
+                 : snprintf(seq, sizeof(seq), "\x1b[%d%c", a, final);
+  emit(seq, (size_t)n);
+}
+
+static void flush_output(void) {
+  size_t done = 0;
+  while (done < out_len) {
+    ssize_t n = write(STDOUT_FILENO, out + done, out_len - done);
+    stats.writes++;
+    if (n <= 0) break;
+    done += (size_t)n;
+  }
+  stats.bytes += (long)done;
+  out_len = 0;
+}
+
+static void set_ink_sgr(int ink, const PastelSpec* spec) {
+  int r = spec->r * 255 / 1000, g = spec->g * 255 / 1000,
+      b = spec->b * 255 / 1000;
+  ink_sgr_len[ink] = (size_t)snprintf(ink_sgr[ink], sizeof(ink_sgr[ink]),
+                                      "\x1b[0;30;48;2;%d;%d;%dm", r, g, b);
+  ink_bg_len[ink] = (size_t)snprintf(ink_bg[ink], sizeof(ink_bg[ink]),
+                                     "\x1b[48;2;%d;%d;%dm", r, g, b);
+}
+
+static void put_cell(int r, int c, int ink, char glyph) {
+  Cell cell = {(uint8_t)ink, glyph};
+  if (same_cell(next_frame[r][c], cell)) return;
+  next_frame[r][c] = cell;
+  row_dirty[r] = true;
+}
+
+static void fill(int top, int left, int height, int width, int ink,
+                 char glyph) {
+  for (int r = top; r < top + height; ++r)
+    for (int c = left; c < left + width; ++c) put_cell(r, c, ink, glyph);
+}
+
+static void put_text(int row, int left, const char* text, int width,
+                     int ink) {
+  for (int i = 0; text[i] && i < width; ++i)
+    put_cell(row, left + i, ink, text[i]);
+}
+
+static int cell_ink(int cell, int empty_ink) {
+  return cell > 0 && cell <= TETROMINO_COUNT ? INK_TETROMINO + cell - 1
+                                             : empty_ink;
+}
+
+static void compose_playfield_frame(void) {
+  fill(0, 0, 1, WIDTH_IN_CHARS + 1, INK_BORDER, ' ');
+  fill(HIGHT_IN_CHARS, 0, 1, WIDTH_IN_CHARS + 1, INK_BORDER, ' ');
+  fill(0, 0, HIGHT_IN_CHARS + 1, 1, INK_BORDER, ' ');
+  fill(0, WIDTH_IN_CHARS, HIGHT_IN_CHARS + 1, 1, INK_BORDER, ' ');
+}
+
+static void compose_sidebar_frame(void) {
+  int sidebar_left = SIDEBAR_LEFT_PIX * ONE_PIXEL_WIDTH - 1;
+  int sidebar_right = SCREEN_COLS - 1;
+  int width = sidebar_right - WIDTH_IN_CHARS + 1;
+  fill(0, WIDTH_IN_CHARS, 1, width, INK_BORDER, ' ');
+  fill(HIGHT_IN_CHARS, WIDTH_IN_CHARS, 1, width, INK_BORDER, ' ');
+  fill(0, sidebar_left, HIGHT_IN_CHARS + 1, 1, INK_BORDER, ' ');
+  fill(0, sidebar_right, HIGHT_IN_CHARS + 1, 1, INK_BORDER, ' ');
+}
+
+static void compose_sidebar_text(const GameInfo_t* info) {
+  SidebarLine lines[SIDEBAR_LINES];
+  int n = sidebar_text_lines(info, lines);
+  int text_left = SIDEBAR_LEFT_PIX * ONE_PIXEL_WIDTH + 1;
+  int text_width = SIDEBAR_WIDTH_IN_PIX * ONE_PIXEL_WIDTH - 2;
+  for (int i = 0; i < n; ++i) {
+    fill(lines[i].row, text_left, 1, text_width, INK_SIDEBAR, ' ');
+    put_text(lines[i].row, text_left, lines[i].text, text_width, INK_SIDEBAR);
+  }
+}
+
+// та же раскладка, что у frontend.c, в том же порядке слоёв; при
+// действующем composed только изменившиеся клетки и строки
+static void compose(const GameInfo_t* info) {
+  bool full = !composed.valid;
+  bool frame_damaged = full;
+  // промежутки между рамками раскладка не рисует, а надпись поверх поля
+  // может туда залезть: при полной сборке экран сначала чистится
+  if (full) fill(0, 0, SCREEN_ROWS, SCREEN_COLS, INK_PLAIN, ' ');
+  for (int r = 0; r < HIGHT_IN_PIXELS; ++r) {
+    for (int c = 0; c < WIDTH_IN_PIXELS; ++c) {
+      int cell = info->field ? info->field[r][c] : 0;
+      if (!full && cell == composed.field[r][c]) continue;
+      composed.field[r][c] = cell;
+      fill(r * ONE_PIXEL_HEIGHT, c * ONE_PIXEL_WIDTH, ONE_PIXEL_HEIGHT,
+           ONE_PIXEL_WIDTH, cell_ink(cell, INK_FIELD), ' ');
+      frame_damaged |= r == 0 || c == 0;
+    }
+  }
+  if (frame_damaged) compose_playfield_frame();
+
+  if (full)
+    fill(SIDEBAR_TOP_PIX * ONE_PIXEL_HEIGHT,
+         SIDEBAR_LEFT_PIX * ONE_PIXEL_WIDTH,
+         SIDEBAR_HEIGHT_IN_PIX * ONE_PIXEL_HEIGHT,
+         SIDEBAR_WIDTH_IN_PIX * ONE_PIXEL_WIDTH, INK_SIDEBAR, ' ');
+  for (int r = 0; r < 4; ++r) {
+    for (int c = 0; c < 4; ++c) {
+      int cell = info->next ? info->next[r][c] : 0;
+      if (!full && cell == composed.next[r][c]) continue;
+      composed.next[r][c] = cell;
+      fill((PREVIEW_PIX_TOP + r) * ONE_PIXEL_HEIGHT,
+           (PREVIEW_PIX_LEFT + c) * ONE_PIXEL_WIDTH, ONE_PIXEL_HEIGHT,
+           ONE_PIXEL_WIDTH, cell_ink(cell, INK_SIDEBAR), ' ');
+    }
+  }
+  int stats_now[5] = {info->score, info->high_score, info->level, info->speed,
+                      info->pause};
+  if (full || memcmp(stats_now, composed.stats, sizeof(stats_now)) != 0) {
+    memcpy(composed.stats, stats_now, sizeof(stats_now));
+    compose_sidebar_text(info);
+  }
+  if (full) compose_sidebar_frame();
+  composed.valid = true;
+}
+
+static bool is_dirty(int r, int c) {
+  return !shown_valid || !same_cell(next_frame[r][c], shown[r][c]);
+}
+
+// длина отрезка одинаковых пробелов, которые все нужно перерисовать
+static int blank_run(int r, int c) {
+  Cell first = next_frame[r][c];
+  if (first.glyph != ' ') return 0;
+  int n = 0;
+  while (c + n < SCREEN_COLS && same_cell(next_frame[r][c + n], first) &&
+         is_dirty(r, c + n))
+    ++n;
+  return n;
+}
+
+static void encode_row(int r, int* ink) {
+  int cursor = -1;  // колонка курсора в этой строке, -1 - не здесь
+  for (int c = 0; c < SCREEN_COLS;) {
+    if (!is_dirty(r, c)) {
+      ++c;
+      continue;
+    }
+    if (cursor < 0) {
+      emit_csi(r + 1, c + 1, 'H');
+    } else if (c - cursor > 3) {
+      emit_csi(c - cursor, -1, 'C');
+    } else {
+      // короткий разрыв: перерисовать чистые клетки дешевле перестановки,
+      // если они того же цвета
+      bool same_ink = true;
+      for (int k = cursor; k < c; ++k) same_ink &= shown[r][k].ink == *ink;
+      if (same_ink) {
+        for (int k = cursor; k < c; ++k) emit(&shown[r][k].glyph, 1);
+      } else {
+        emit_csi(c - cursor, -1, 'C');
+      }
+    }
+    Cell cell = next_frame[r][c];
+    if (cell.ink != *ink) {
+      // текст чёрный у всех цветов, кроме INK_PLAIN
+      if (*ink >= 0 && *ink != INK_PLAIN && cell.ink != INK_PLAIN)
+        emit(ink_bg[cell.ink], ink_bg_len[cell.ink]);
+      else
+        emit(ink_sgr[cell.ink], ink_sgr_len[cell.ink]);
+      *ink = cell.ink;
+    }
+    int run = blank_run(r, c);
+    int span = 1;
+    if (run >= ERASE_MIN_RUN && c + run < SCREEN_COLS) {
+      emit_csi(run, -1, 'X');  // стирает цветом фона, курсор на месте
+      emit_csi(run, -1, 'C');
+      span = run;
+    } else {
+      emit(&cell.glyph, 1);
+    }
+    for (int k = c; k < c + span; ++k) shown[r][k] = next_frame[r][k];
+    c += span;
+    cursor = c;
+  }
+}
+
+static void present(void) {
+  if (clear_pending) {
+    emit_str("\x1b[0m\x1b[2J");
+    clear_pending = false;
+    shown_valid = false;
+  }
+  int ink = -1;
+  for (int r = 0; r < SCREEN_ROWS; ++r) {
+    if (!row_dirty[r] && shown_valid) continue;
+    encode_row(r, &ink);
+    row_dirty[r] = false;
+  }
+  shown_valid = true;
+  stats.frames++;
+  flush_output();
+}
+
+static void ansi_print_field(const GameInfo_t* info) {
+  compose(info);
+  present();
+}
+
+static void overlay_center(const char* text) {
+  composed.valid = false;  // надпись поверх поля
+  int len = (int)strlen(text);
+  // по центру поля, а не влезает - по центру экрана, обрезая по краю
+  int left = (WIDTH_IN_CHARS - len) / 2;
+  if (left < 0) left = (SCREEN_COLS - len) / 2;
+  if (left < 0) left = 0;
+  put_text(HIGHT_IN_CHARS / 2, left, text, SCREEN_COLS - left, INK_PLAIN);
+}
+
+static void ansi_print_menu(void) {
+  GameInfo_t empty = {0};
+  compose(&empty);
+  overlay_center("Press Enter to start.");
+  present();
+}
+
+static void ansi_print_game_over_prompt(void) {
+  overlay_center("Game Over! Press R to restart or Q to quit.");
+  present();
+}
+
+static void ansi_init(void) {
+  for (int i = 0; i < TETROMINO_COUNT; ++i)
+    set_ink_sgr(INK_TETROMINO + i, &TETROMINO_SPECS[i]);
+  set_ink_sgr(INK_FIELD, &FIELD_SPEC);
+  set_ink_sgr(INK_SIDEBAR, &SIDEBAR_SPEC);
+  set_ink_sgr(INK_BORDER, &BORDER_SPEC);
+  ink_sgr_len[INK_PLAIN] = (size_t)snprintf(
+      ink_sgr[INK_PLAIN], sizeof(ink_sgr[INK_PLAIN]), "\x1b[0m");
+
+  // без канонического режима и эха, read() не ждёт; ISIG остаётся, Ctrl-C
+  // приходит сигналом в event_loop
+  if (tcgetattr(STDIN_FILENO, &saved_termios) == 0) {
+    termios_saved = true;
+    struct termios raw = saved_termios;
+    raw.c_lflag &= (tcflag_t) ~(ICANON | ECHO);
+    raw.c_cc[VMIN] = 0;
+    raw.c_cc[VTIME] = 0;
+    tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+  }
+  emit_str("\x1b[?1049h\x1b[?25l\x1b[0m\x1b[2J");
+  flush_output();
+  shown_valid = false;
+  composed.valid = false;
+}
+
+static void ansi_shutdown(void) {
+  emit_str("\x1b[0m\x1b[?25h\x1b[?1049l");
+  flush_output();
+  if (termios_saved) tcsetattr(STDIN_FILENO, TCSANOW, &saved_termios);
+}
+
+static void ansi_resize(void) {
+  clear_pending = true;
+  composed.valid = false;
+}
+
+FrontendStats ansi_frontend_stats(void) { return stats; }
+
+const Frontend ansi_frontend = {
+    .init = ansi_init,
+    .shutdown = ansi_shutdown,
+    .resize = ansi_resize,
+    .print_field = ansi_print_field,
+    .print_menu = ansi_print_menu,
+    .print_game_over_prompt = ansi_print_game_over_prompt,
+};
@@ -0,0 +1,139 @@
+#define _GNU_SOURCE
+#include "event_loop.h"
+
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../../brick_game/tetris/game_clock.h"
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+
+// маска до event_loop_init(): она у потока одна, как и цикл событий
+static sigset_t saved_mask;
+static bool mask_saved = false;
+
+static void close_fd(int* fd) {
+  if (*fd >= 0) close(*fd);
+  *fd = -1;
+}
+
+static int add_fd(int epoll_fd, int fd) {
+  struct epoll_event ev = {.events = EPOLLIN, .data.fd = fd};
+  return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+void event_loop_init(EventLoop* loop) {
+  loop->input_fd = -1;
+  loop->wakeups = 0;
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGWINCH);
+  sigaddset(&mask, SIGTERM);
+  sigaddset(&mask, SIGINT);
+  sigaddset(&mask, SIGHUP);
+  loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  loop->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+  loop->signal_fd = signalfd(-1, &mask, SFD_CLOEXEC | SFD_NONBLOCK);
+  if (loop->epoll_fd >= 0 && loop->timer_fd >= 0 && loop->signal_fd >= 0 &&
+      add_fd(loop->epoll_fd, loop->timer_fd) == 0 &&
+      add_fd(loop->epoll_fd, loop->signal_fd) == 0 &&
+      sigprocmask(SIG_BLOCK, &mask, &saved_mask) == 0) {
+    mask_saved = true;
+    return;
+  }
+  event_loop_close(loop);  // дальше через poll()
+}
+
+void event_loop_set_input(EventLoop* loop, int input_fd) {
+  loop->input_fd = input_fd;
+  if (loop->epoll_fd >= 0 && add_fd(loop->epoll_fd, input_fd) != 0) {
+    // poll() сигналы не читает, без старой маски SIGINT/SIGTERM потеряются
+    event_loop_close(loop);
+    if (mask_saved) sigprocmask(SIG_SETMASK, &saved_mask, NULL);
+    mask_saved = false;
+  }
+}
+
+void event_loop_close(EventLoop* loop) {
+  close_fd(&loop->epoll_fd);
+  close_fd(&loop->timer_fd);
+  close_fd(&loop->signal_fd);
+}
+
+static void arm_timer(int timer_fd, int64_t deadline_ns) {
+  // нулевой it_value снимает таймер, поэтому прошедший дедлайн - 1 нс
+  if (deadline_ns == 0) deadline_ns = 1;
+  struct itimerspec spec = {0};
+  if (deadline_ns > 0) {
+    spec.it_value.tv_sec = deadline_ns / 1000000000;
+    spec.it_value.tv_nsec = deadline_ns % 1000000000;
+  }
+  timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &spec, NULL);
+}
+
+static int read_signals(int signal_fd) {
+  int events = 0;
+  struct signalfd_siginfo info;
+  while (read(signal_fd, &info, sizeof(info)) == (ssize_t)sizeof(info))
+    events |= info.ssi_signo == SIGWINCH ? EVENT_RESIZE : EVENT_QUIT;
+  return events;
+}
+
+static int epoll_wait_events(EventLoop* loop, int64_t deadline_ns) {
+  arm_timer(loop->timer_fd, deadline_ns);
+  struct epoll_event ready[3];
+  int n = epoll_wait(loop->epoll_fd, ready, 3, -1);
+  int events = 0;
+  for (int i = 0; i < n; ++i) {
+    int fd = ready[i].data.fd;
+    if (fd == loop->input_fd) {
+      events |= EVENT_INPUT;
+    } else if (fd == loop->timer_fd) {
+      uint64_t expirations;
+      if (read(fd, &expirations, sizeof(expirations)) > 0)
+        events |= EVENT_TIMER;
+    } else {
+      events |= read_signals(fd);
+    }
+  }
+  return events;
+}
+#else
+void event_loop_init(EventLoop* loop) {
+  loop->input_fd = -1;
+  loop->epoll_fd = loop->timer_fd = loop->signal_fd = -1;
+  loop->wakeups = 0;
+}
+
+void event_loop_set_input(EventLoop* loop, int input_fd) {
+  loop->input_fd = input_fd;
+}
+
+void event_loop_close(EventLoop* loop) { (void)loop; }
+#endif
+
+static int poll_wait_events(int input_fd, int64_t deadline_ns) {
+  int timeout_ms = -1;
+  if (deadline_ns >= 0) {
+    int64_t wait_ns = deadline_ns - game_clock_now_ns();
+    timeout_ms = wait_ns > 0 ? (int)((wait_ns + 999999) / 1000000) : 0;
+  }
+  struct pollfd pfd = {.fd = input_fd, .events = POLLIN};
+  int n = poll(&pfd, 1, timeout_ms);
+  if (n > 0) return EVENT_INPUT;
+  return n == 0 ? EVENT_TIMER : 0;
+}
+
+int event_loop_wait(EventLoop* loop, int64_t deadline_ns) {
+  loop->wakeups++;
+#ifdef __linux__
+  if (loop->epoll_fd >= 0) return epoll_wait_events(loop, deadline_ns);
+#endif
+  return poll_wait_events(loop->input_fd, deadline_ns);
+}
@@ -0,0 +1,35 @@
+#ifndef EVENT_LOOP_H_
+#define EVENT_LOOP_H_
+#include <stdint.h>
+
+// Ожидание событий фронтенда без опроса: ввод (дескриптор пробуждения от
+// потока ввода), дедлайн следующего шага игры и сигналы. На Linux это
+// epoll над ним, timerfd и signalfd (SIGWINCH, SIGTERM, SIGINT, SIGHUP),
+// иначе poll() с таймаутом и обычная обработка сигналов.
+
+typedef enum {
+  EVENT_INPUT = 1,   // на input_fd есть данные
+  EVENT_TIMER = 2,   // наступил дедлайн
+  EVENT_RESIZE = 4,  // SIGWINCH
+  EVENT_QUIT = 8     // SIGTERM/SIGINT/SIGHUP
+} EventMask;
+
+typedef struct {
+  int input_fd;
+  int epoll_fd;  // -1 - работаем через poll()
+  int timer_fd;
+  int signal_fd;
+  long wakeups;  // возвратов из ожидания
+} EventLoop;
+
+// сигналы блокируются в вызывающем потоке, поэтому звать до создания
+// других потоков, чтобы маску унаследовали и они
+void event_loop_init(EventLoop* loop);
+// дескриптор, готовность которого на чтение - EVENT_INPUT
+void event_loop_set_input(EventLoop* loop, int input_fd);
+void event_loop_close(EventLoop* loop);
+// спит до события; deadline_ns - момент CLOCK_MONOTONIC, < 0 - без
+// дедлайна. Возвращает маску EventMask
+int event_loop_wait(EventLoop* loop, int64_t deadline_ns);
+
+#endif
@@ -1,6 +1,8 @@
 #include "frontend.h"
 
-#define TETROMINO_COUNT 7
+#include <sys/ioctl.h>
+#include <unistd.h>
+
 #define CUSTOM_COLOR_BASE 16
 
 enum {
@@ -21,13 +23,6 @@ typedef struct {
   short tetromino[TETROMINO_COUNT];
 } ColorTheme;
 
-typedef struct {
-  short r;
-  short g;
-  short b;
-  short fallback;
-} PastelSpec;
-
 char field[WIDTH_IN_CHARS][HIGHT_IN_CHARS];
 
 static ColorTheme theme = {
@@ -43,10 +38,27 @@ static ColorTheme theme = {
 
 static bool colors_enabled = false;
 
+// что сейчас нарисовано на экране: print_field() сравнивает с ним новый
+// кадр и перерисовывает только изменившиеся клетки и строки статистики
+static struct {
+  bool valid;
+  int field[HIGHT_IN_PIXELS][WIDTH_IN_PIXELS];
+  int preview[4][4];
+  int score;
+  int high_score;
+  int level;
+  int speed;
+  int pause;
+} drawn;
+
 static void configure_theme(void);
 static short setup_pastel_color(short slot_index, const PastelSpec* spec);
 static void paint_cell_block(int top, int left, short pair, char fallback_char);
 static void draw_playfield(const GameInfo_t* info);
+static void paint_field_cell(int r, int c, int cell);
+static void paint_preview_cell(int r, int c, int cell);
+static void remember_frame(const GameInfo_t* info);
+static void update_changed(const GameInfo_t* info);
 static void draw_playfield_frame(void);
 static void draw_sidebar(const GameInfo_t* info);
 static void draw_sidebar_background(void);
@@ -70,30 +82,19 @@ void init_colors(void) {
 }
 
 static void configure_theme(void) {
-  static const PastelSpec tetromino_specs[TETROMINO_COUNT] = {
-      {700, 900, 1000, COLOR_CYAN},    /* I */
-      {1000, 950, 700, COLOR_YELLOW},  /* O */
-      {700, 950, 750, COLOR_GREEN},    /* S */
-      {1000, 700, 700, COLOR_RED},     /* Z */
-      {1000, 800, 600, COLOR_MAGENTA}, /* L */
-      {750, 800, 1000, COLOR_BLUE},    /* J */
-      {900, 750, 1000, COLOR_MAGENTA}  /* T */
-  };
-  static const PastelSpec field_spec = {1000, 1000, 1000, COLOR_WHITE};
-
   short color_slot = CUSTOM_COLOR_BASE;
   for (int i = 0; i < TETROMINO_COUNT; ++i) {
-    short bg = setup_pastel_color(color_slot++, &tetromino_specs[i]);
+    short bg = setup_pastel_color(color_slot++, &TETROMINO_SPECS[i]);
     init_pair(theme.tetromino[i], COLOR_BLACK, bg);
   }
 
-  short field_bg = setup_pastel_color(color_slot++, &field_spec);
+  short field_bg = setup_pastel_color(color_slot++, &FIELD_SPEC);
   init_pair(theme.field_bg, COLOR_BLACK, field_bg);
 
-  init_pair(theme.border, COLOR_BLACK, COLOR_BLACK);
-  init_pair(theme.sidebar_bg, COLOR_BLACK, COLOR_WHITE);
-  init_pair(theme.sidebar_header, COLOR_BLACK, COLOR_WHITE);
-  init_pair(theme.sidebar_preview, COLOR_BLACK, COLOR_WHITE);
+  init_pair(theme.border, COLOR_BLACK, BORDER_SPEC.fallback);
+  init_pair(theme.sidebar_bg, COLOR_BLACK, SIDEBAR_SPEC.fallback);
+  init_pair(theme.sidebar_header, COLOR_BLACK, SIDEBAR_SPEC.fallback);
+  init_pair(theme.sidebar_preview, COLOR_BLACK, SIDEBAR_SPEC.fallback);
 }
 
 static short setup_pastel_color(short slot_index, const PastelSpec* spec) {
@@ -115,23 +116,23 @@ static void paint_cell_block(int top, int left, short pair,
   }
 }
 
-static void draw_playfield(const GameInfo_t* info) {
-  for (int r = 0; r < HIGHT_IN_PIXELS; ++r) {
-    for (int c = 0; c < WIDTH_IN_PIXELS; ++c) {
-      int cell = field_cell_value(info, r, c);
-      short pair = 0;
-      char fallback;
-      if (cell > 0) {
-        pair = colors_enabled ? tetromino_pair_from_cell(cell) : 0;
-        fallback = colors_enabled ? ' ' : DEFAULT_CHAR;
-      } else {
-        pair = colors_enabled ? theme.field_bg : 0;
-        fallback = ' ';
-      }
-      paint_cell_block(r * ONE_PIXEL_HEIGHT, c * ONE_PIXEL_WIDTH, pair,
-                       fallback);
-    }
+static void paint_field_cell(int r, int c, int cell) {
+  short pair = 0;
+  char fallback;
+  if (cell > 0) {
+    pair = colors_enabled ? tetromino_pair_from_cell(cell) : 0;
+    fallback = colors_enabled ? ' ' : DEFAULT_CHAR;
+  } else {
+    pair = colors_enabled ? theme.field_bg : 0;
+    fallback = ' ';
   }
+  paint_cell_block(r * ONE_PIXEL_HEIGHT, c * ONE_PIXEL_WIDTH, pair, fallback);
+}
+
+static void draw_playfield(const GameInfo_t* info) {
+  for (int r = 0; r < HIGHT_IN_PIXELS; ++r)
+    for (int c = 0; c < WIDTH_IN_PIXELS; ++c)
+      paint_field_cell(r, c, field_cell_value(info, r, c));
 }
 
 static void draw_playfield_frame(void) {
@@ -164,26 +165,34 @@ static void draw_sidebar_background(void) {
   }
 }
 
-static void draw_preview(const GameInfo_t* info) {
-  for (int r = 0; r < 4; ++r) {
-    for (int c = 0; c < 4; ++c) {
-      int cell = preview_cell_value(info, r, c);
-      short pair = 0;
-      char fallback = SIDEBAR_DEFAULT_CHAR;
-      if (cell > 0) {
-        pair = colors_enabled ? tetromino_pair_from_cell(cell) : 0;
-        fallback = colors_enabled ? ' ' : DEFAULT_CHAR;
-      } else if (colors_enabled) {
-        pair = theme.sidebar_preview;
-      }
-      int top = (PREVIEW_PIX_TOP + r) * ONE_PIXEL_HEIGHT;
-      int left = (PREVIEW_PIX_LEFT + c) * ONE_PIXEL_WIDTH;
-      paint_cell_block(top, left, pair, fallback);
-    }
+static void paint_preview_cell(int r, int c, int cell) {
+  short pair = 0;
+  char fallback = SIDEBAR_DEFAULT_CHAR;
+  if (cell > 0) {
+    pair = colors_enabled ? tetromino_pair_from_cell(cell) : 0;
+    fallback = colors_enabled ? ' ' : DEFAULT_CHAR;
+  } else if (colors_enabled) {
+    pair = theme.sidebar_preview;
   }
+  int top = (PREVIEW_PIX_TOP + r) * ONE_PIXEL_HEIGHT;
+  int left = (PREVIEW_PIX_LEFT + c) * ONE_PIXEL_WIDTH;
+  paint_cell_block(top, left, pair, fallback);
 }
 
-static void draw_sidebar_text(const GameInfo_t* info) {
+static void draw_preview(const GameInfo_t* info) {
+  for (int r = 0; r < 4; ++r)
+    for (int c = 0; c < 4; ++c)
+      paint_preview_cell(r, c, preview_cell_value(info, r, c));
+}
+
+static void set_line(SidebarLine* line, int row, bool header,
+                     const char* text) {
+  line->row = row;
+  line->header = header;
+  snprintf(line->text, sizeof(line->text), "%s", text);
+}
+
+int sidebar_text_lines(const GameInfo_t* info, SidebarLine* lines) {
   int score = info ? info->score : 0;
   int high = info ? info->high_score : 0;
   int level = info ? info->level : 0;
@@ -196,30 +205,41 @@ static void draw_sidebar_text(const GameInfo_t* info) {
   else if (pause_state == 2)
     pause_text = "OVER";
 
-  char buffer[64];
-  draw_sidebar_text_line(1, "NEXT", theme.sidebar_header);
-  draw_sidebar_text_line(2, "", theme.sidebar_bg);
+  char buffer[sizeof(lines->text)];
+  int n = 0;
+  set_line(&lines[n++], 1, true, "NEXT");
+  set_line(&lines[n++], 2, false, "");
 
-  draw_sidebar_text_line(12, "STATS", theme.sidebar_header);
+  set_line(&lines[n++], 12, true, "STATS");
   snprintf(buffer, sizeof(buffer), "SCORE: %d", score);
-  draw_sidebar_text_line(14, buffer, theme.sidebar_bg);
+  set_line(&lines[n++], 14, false, buffer);
   snprintf(buffer, sizeof(buffer), "HIGH : %d", high);
-  draw_sidebar_text_line(15, buffer, theme.sidebar_bg);
+  set_line(&lines[n++], 15, false, buffer);
   snprintf(buffer, sizeof(buffer), "LEVEL: %d", level);
-  draw_sidebar_text_line(17, buffer, theme.sidebar_bg);
+  set_line(&lines[n++], 17, false, buffer);
   snprintf(buffer, sizeof(buffer), "SPEED: %d", speed);
-  draw_sidebar_text_line(18, buffer, theme.sidebar_bg);
+  set_line(&lines[n++], 18, false, buffer);
   snprintf(buffer, sizeof(buffer), "PAUSE: %s", pause_text);
-  draw_sidebar_text_line(20, buffer, theme.sidebar_bg);
+  set_line(&lines[n++], 20, false, buffer);
+
+  set_line(&lines[n++], 24, true, pause_state == 2 ? "GAME OVER" : "");
 
-  draw_sidebar_text_line(24, pause_state == 2 ? "GAME OVER" : "",
-                         theme.sidebar_header);
+  set_line(&lines[n++], 26, true, "CONTROLS");
+  set_line(&lines[n++], 28, false, "SPACE ROTATE");
+  set_line(&lines[n++], 29, false, "DOWN  SOFT DROP");
+  set_line(&lines[n++], 30, false, "UP    DROP");
+  set_line(&lines[n++], 31, false, "P PAUSE / R RESET");
+  set_line(&lines[n++], 32, false, "Q QUIT");
+  return n;
+}
 
-  draw_sidebar_text_line(26, "CONTROLS", theme.sidebar_header);
-  draw_sidebar_text_line(28, "SPACE ROTATE", theme.sidebar_bg);
-  draw_sidebar_text_line(29, "DOWN  DROP", theme.sidebar_bg);
-  draw_sidebar_text_line(30, "P PAUSE / R RESET", theme.sidebar_bg);
-  draw_sidebar_text_line(31, "Q QUIT", theme.sidebar_bg);
+static void draw_sidebar_text(const GameInfo_t* info) {
+  SidebarLine lines[SIDEBAR_LINES];
+  int n = sidebar_text_lines(info, lines);
+  for (int i = 0; i < n; ++i)
+    draw_sidebar_text_line(
+        lines[i].row, lines[i].text,
+        lines[i].header ? theme.sidebar_header : theme.sidebar_bg);
 }
 
 static void draw_sidebar_text_line(int row_y, const char* text, short pair) {
@@ -272,18 +292,75 @@ static int preview_cell_value(const GameInfo_t* info, int row, int col) {
   return value;
 }
 
+static void remember_frame(const GameInfo_t* info) {
+  for (int r = 0; r < HIGHT_IN_PIXELS; ++r)
+    for (int c = 0; c < WIDTH_IN_PIXELS; ++c)
+      drawn.field[r][c] = field_cell_value(info, r, c);
+  for (int r = 0; r < 4; ++r)
+    for (int c = 0; c < 4; ++c)
+      drawn.preview[r][c] = preview_cell_value(info, r, c);
+  drawn.score = info->score;
+  drawn.high_score = info->high_score;
+  drawn.level = info->level;
+  drawn.speed = info->speed;
+  drawn.pause = info->pause;
+  drawn.valid = true;
+}
+
+// обычно это 4-8 клеток падающей фигуры и, изредка, статистика
+static void update_changed(const GameInfo_t* info) {
+  bool frame_damaged = false;
+  for (int r = 0; r < HIGHT_IN_PIXELS; ++r) {
+    for (int c = 0; c < WIDTH_IN_PIXELS; ++c) {
+      int cell = field_cell_value(info, r, c);
+      if (cell == drawn.field[r][c]) continue;
+      paint_field_cell(r, c, cell);
+      drawn.field[r][c] = cell;
+      frame_damaged |= r == 0 || c == 0;
+    }
+  }
+  // клетки верхней строки и левого столбца заходят на рамку
+  if (frame_damaged) draw_playfield_frame();
+  for (int r = 0; r < 4; ++r) {
+    for (int c = 0; c < 4; ++c) {
+      int cell = preview_cell_value(info, r, c);
+      if (cell == drawn.preview[r][c]) continue;
+      paint_preview_cell(r, c, cell);
+      drawn.preview[r][c] = cell;
+    }
+  }
+  // строки статистики меняются редко, их проще собрать заново все
+  if (info->score != drawn.score || info->high_score != drawn.high_score ||
+      info->level != drawn.level || info->speed != drawn.speed ||
+      info->pause != drawn.pause)
+    draw_sidebar_text(info);
+  drawn.score = info->score;
+  drawn.high_score = info->high_score;
+  drawn.level = info->level;
+  drawn.speed = info->speed;
+  drawn.pause = info->pause;
+}
+
 void print_field(const GameInfo_t* info) {
-  draw_playfield(info);
-  draw_playfield_frame();
-  draw_sidebar(info);
+  if (drawn.valid) {
+    update_changed(info);
+  } else {
+    draw_playfield(info);
+    draw_playfield_frame();
+    draw_sidebar(info);
+    remember_frame(info);
+  }
   refresh();
 }
 
-void print_menu() {
+void invalidate_frame(void) { drawn.valid = false; }
+
+void print_menu(void) {
   GameInfo_t empty = {0};
   draw_playfield(&empty);
   draw_playfield_frame();
   draw_sidebar(&empty);
+  drawn.valid = false;
   const char* text = "Press Enter to start.";
   int y = HIGHT_IN_CHARS / 2;
   int x = (WIDTH_IN_CHARS - (int)strlen(text)) / 2;
@@ -292,9 +369,42 @@ void print_menu() {
 }
 
 void print_game_over_prompt(void) {
+  drawn.valid = false;  // надпись поверх поля
   const char* msg = "Game Over! Press R to restart or Q to quit.";
   int y = HIGHT_IN_CHARS / 2;
-  int x = (WIDTH_IN_CHARS - (int)strlen(msg)) / 2;
-  mvaddnstr(y, x, msg, (int)strlen(msg));
+  int len = (int)strlen(msg);
+  // шире поля: по центру экрана, как в ansi_frontend.c
+  int x = (WIDTH_IN_CHARS - len) / 2;
+  if (x < 0) x = (SCREEN_COLS - len) / 2;
+  if (x < 0) x = 0;
+  mvaddnstr(y, x, msg, len);
   refresh();
 }
+
+static void ncurses_init(void) {
+  WIN_INIT(0);
+  // клавиши читает поток ввода, ncurses stdin не трогает: без буфера
+  // строк и без проверки typeahead в refresh()
+  cbreak();
+  typeahead(-1);
+  init_colors();
+}
+
+static void ncurses_shutdown(void) { endwin(); }
+
+static void ncurses_resize(void) {
+  struct winsize ws;
+  if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0)
+    resizeterm(ws.ws_row, ws.ws_col);
+  clear();
+  invalidate_frame();
+}
+
+const Frontend ncurses_frontend = {
+    .init = ncurses_init,
+    .shutdown = ncurses_shutdown,
+    .resize = ncurses_resize,
+    .print_field = print_field,
+    .print_menu = print_menu,
+    .print_game_over_prompt = print_game_over_prompt,
+};
@@ -1,6 +1,7 @@
 #include <ncurses.h>
 
 #include "../../brick_game/tetris/game_interface.h"
+#include "theme.h"
 #define ONE_PIXEL_WIDTH 4
 #define ONE_PIXEL_HEIGHT 2
 #define HIGHT_IN_PIXELS 20
@@ -25,9 +26,47 @@
     keypad(stdscr, TRUE); \
     timeout(time);        \
   }
+// экран целиком: поле с рамкой и боковая панель с рамкой
+#define SCREEN_ROWS (HIGHT_IN_CHARS + 1)
+#define SCREEN_COLS \
+  ((SIDEBAR_LEFT_PIX + SIDEBAR_WIDTH_IN_PIX) * ONE_PIXEL_WIDTH + 1)
+#define SIDEBAR_LINES 15
 extern char field[WIDTH_IN_CHARS][HIGHT_IN_CHARS];
 
+// бэкенд отрисовки, выбирается в main(); ввод читает input_thread
+typedef struct {
+  void (*init)(void);
+  void (*shutdown)(void);
+  void (*resize)(void);  // после SIGWINCH
+  void (*print_field)(const GameInfo_t* info);
+  void (*print_menu)(void);
+  void (*print_game_over_prompt)(void);
+} Frontend;
+
+extern const Frontend ncurses_frontend;  // frontend.c
+extern const Frontend ansi_frontend;     // ansi_frontend.c
+
+typedef struct {
+  long frames;
+  long bytes;   // записано в терминал
+  long writes;  // вызовов write()
+} FrontendStats;
+
+FrontendStats ansi_frontend_stats(void);
+
+// строки боковой панели (row - строка экрана), общие для бэкендов
+typedef struct {
+  int row;
+  bool header;
+  char text[32];
+} SidebarLine;
+
+int sidebar_text_lines(const GameInfo_t* info, SidebarLine* lines);
+
+// перерисовывает только то, что изменилось с прошлого print_field()
 void print_field(const GameInfo_t* info);
-void print_menu();
+// следующий print_field() рисует экран целиком (после clear() и т.п.)
+void invalidate_frame(void);
+void print_menu(void);
 void print_game_over_prompt(void);
 void init_colors(void);
@@ -1,8 +1,13 @@
 #include <locale.h>
 #include <stdbool.h>
 
+#include "../../brick_game/tetris/game_clock.h"
+#include "../../brick_game/tetris/game_events.h"
 #include "../../brick_game/tetris/game_interface.h"
+#include "../../brick_game/tetris/replay.h"
+#include "event_loop.h"
 #include "frontend.h"
+#include "input_thread.h"
 
 typedef enum {
   NOT_VALUABLE_INPUT = 0,
@@ -13,11 +18,31 @@ typedef enum {
 } InputSignals_t;
 
 static void game_loop(void);
+static GameClockStats clock_stats;  // для --clock-stats
+static EventLoop events;
+static InputThread input;
+static AutoRepeat repeat;
+// задержка от чтения клавиши потоком ввода до её применения
+#define LATENCY_TARGET_NS 1000000  // цель - меньше 1 мс
+static struct {
+  long count;
+  long over_target;
+  double mean_ns;
+  int64_t max_ns;
+} latency;
+#ifdef TETRIS_ANSI_FRONTEND
+static const Frontend* ui = &ansi_frontend;
+#else
+static const Frontend* ui = &ncurses_frontend;
+#endif
+static bool quit_requested;  // SIGTERM/SIGINT/SIGHUP
+static bool resized;         // кадр нужно перерисовать, хоть игра и стоит
+static TetrisEvent engine_event_storage[64];
+static TetrisEventRing engine_events;
+static long frames_drawn;
 
-static int parse_input(void) {
+static int parse_input(int ch, bool hold) {
   int result = NOT_VALUABLE_INPUT;
-  int ch = getch();
-  if (ch == ERR) return result;
 
   if (ch == 'q' || ch == 'Q') {
     userInput(Terminate, false);
@@ -36,12 +61,15 @@ static int parse_input(void) {
       result = RESTART_INPUT;
       break;
     case KEY_LEFT:
-      userInput(Left, false);
+      userInput(Left, hold);
       break;
     case KEY_RIGHT:
-      userInput(Right, false);
+      userInput(Right, hold);
       break;
-    case KEY_DOWN:
+    case KEY_DOWN:  // мягкое падение
+      userInput(Down, true);
+      break;
+    case KEY_UP:  // жёсткое падение
       userInput(Down, false);
       break;
     case ' ':
@@ -53,63 +81,216 @@ static int parse_input(void) {
   return result;
 }
 
+static bool repeatable(int key) {
+  return key == KEY_LEFT || key == KEY_RIGHT || key == KEY_DOWN;
+}
+
+// следующая клавиша из очереди потока ввода, ERR - очередь пуста
+static int next_key(InputEvent* event) {
+  return input_queue_pop(&input.queue, event) ? event->key : ERR;
+}
+
+static void record_latency(int64_t t_ns) {
+  int64_t ns = game_clock_now_ns() - t_ns;
+  latency.count++;
+  latency.mean_ns += (ns - latency.mean_ns) / latency.count;
+  if (ns > latency.max_ns) latency.max_ns = ns;
+  if (ns >= LATENCY_TARGET_NS) latency.over_target++;
+}
+
+// спит до ввода, дедлайна (deadline_ns < 0 - без него) или сигнала
+static void wait_events(int64_t deadline_ns) {
+  int mask = event_loop_wait(&events, deadline_ns);
+  if (mask & EVENT_INPUT) input_thread_ack(&input);
+  if (mask & EVENT_RESIZE) {
+    ui->resize();
+    resized = true;
+  }
+  if (mask & EVENT_QUIT) quit_requested = true;
+}
+
 static int main_menu_status(void) {
-  int status = NOT_VALUABLE_INPUT;
-  bool waiting = true;
-  while (waiting) {
-    print_menu();
-    int ch = getch();
-    if (ch == '\n') {
-      status = START_INPUT;
-      waiting = false;
-    } else if (ch == 'q' || ch == 'Q') {
-      status = QUIT_INPUT;
-      waiting = false;
+  for (;;) {
+    ui->print_menu();
+    wait_events(-1);
+    if (quit_requested) return QUIT_INPUT;
+    InputEvent event;
+    int ch;
+    while ((ch = next_key(&event)) != ERR) {
+      if (ch == '\n' || ch == '\r') return START_INPUT;
+      if (ch == 'q' || ch == 'Q') return QUIT_INPUT;
     }
   }
-  return status;
 }
 
 static void wait_for_restart_or_exit(void) {
   for (;;) {
-    int ch = getch();
-    if (ch == 'r' || ch == 'R') {
+    wait_events(-1);
+    if (quit_requested) {
       userInput(Terminate, false);
-      game_loop();
       return;
     }
-    if (ch == 'q' || ch == 'Q' || ch == 27) {
-      userInput(Terminate, false);
-      return;
+    InputEvent event;
+    int ch;
+    while ((ch = next_key(&event)) != ERR) {
+      if (ch == 'r' || ch == 'R') {
+        userInput(Terminate, false);
+        game_loop();
+        return;
+      }
+      if (ch == 'q' || ch == 'Q' || ch == 27) {
+        userInput(Terminate, false);
+        return;
+      }
     }
+    ui->print_game_over_prompt();  // после SIGWINCH экран очищен
   }
 }
 
+// нажатия из очереди и наступившие повторы удерживаемой клавиши
+static void apply_input(void) {
+  InputEvent event;
+  while (!quit_requested && next_key(&event) != ERR) {
+    if (!auto_repeat_event(&repeat, &event, repeatable(event.key))) continue;
+    // задержка - до применения нажатия к игре; выход пишет рекорд на
+    // диск, он не считается
+    if (parse_input(event.key, false) == QUIT_INPUT)
+      quit_requested = true;
+    else
+      record_latency(event.t_ns);
+  }
+  int due = auto_repeat_due(&repeat, game_clock_now_ns());
+  for (int i = 0; i < due && !quit_requested; ++i)
+    parse_input(repeat.key, true);
+}
+
+static int64_t earliest(int64_t a, int64_t b) {
+  if (a < 0) return b;
+  if (b < 0) return a;
+  return a < b ? a : b;
+}
+
+// было ли с прошлого кадра хоть одно событие движка. Большинство шагов
+// часов только считают тики гравитации, и кадр для них не собирается
+static bool engine_changed(void) {
+  bool changed = engine_events.dropped > 0;
+  engine_events.dropped = 0;
+  TetrisEvent event;
+  while (tetris_event_pop(&engine_events, &event)) changed = true;
+  return changed;
+}
+
+// гравитация идёт только от часов: шаги симуляции выполняются по
+// накопленному времени, ввод и отрисовка их не порождают. Между событиями
+// процесс спит, на паузе - без таймера
 static void game_loop(void) {
+  TetrisGame* game = tetris_default_game();
+  tetris_event_ring_init(&engine_events, engine_event_storage,
+                         sizeof(engine_event_storage) /
+                             sizeof(engine_event_storage[0]));
+  tetris_set_event_ring(game, &engine_events);
   userInput(Start, false);
+  auto_repeat_init(&repeat);
+  GameClock clock;
+  game_clock_init(&clock, TETRIS_TICK_MS * 1000000LL, game_clock_now_ns());
+  bool paused = false;
   for (;;) {
-    refresh();
-    GameInfo_t info = updateCurrentState();
-    print_field(&info);
-    if (info.pause == 2) {
-      print_game_over_prompt();
-      wait_for_restart_or_exit();
+    int steps = game_clock_advance(&clock, game_clock_now_ns());
+    for (int i = 0; i < steps; ++i) tetris_step(game);
+    if (engine_changed() || resized) {
+      resized = false;
+      GameInfo_t info = tetris_query(game);
+      ui->print_field(&info);
+      frames_drawn++;
+      if (info.pause == 2) {
+        tetris_set_event_ring(game, NULL);
+        clock_stats = clock.stats;
+        ui->print_game_over_prompt();
+        wait_for_restart_or_exit();
+        return;
+      }
+      paused = info.pause == 1;
+    }
+    if (paused) auto_repeat_init(&repeat);
+    wait_events(paused ? -1
+                       : earliest(game_clock_deadline_ns(&clock),
+                                  auto_repeat_deadline(&repeat)));
+    if (paused) game_clock_rebase(&clock, game_clock_now_ns());
+    apply_input();
+    if (quit_requested) {
+      userInput(Terminate, false);
+      clock_stats = clock.stats;
       return;
     }
-    if (parse_input() == QUIT_INPUT) return;
   }
 }
 
-int main(void) {
-  WIN_INIT(50);
-  init_colors();
+static void print_clock_stats(void) {
+  fprintf(stderr,
+          "steps %ld, dropped %ld, late mean %.3f ms, jitter %.3f ms, "
+          "max %.3f ms, wakeups %ld, frames %ld\n",
+          clock_stats.steps, clock_stats.dropped,
+          clock_stats.late_mean_ns / 1e6,
+          game_clock_jitter_ns(&clock_stats) / 1e6,
+          (double)clock_stats.late_max_ns / 1e6, events.wakeups,
+          frames_drawn);
+  fprintf(stderr,
+          "input: %ld keys, latency mean %.3f ms, max %.3f ms, %ld over "
+          "%.0f ms, dropped %ld\n",
+          latency.count, latency.mean_ns / 1e6, (double)latency.max_ns / 1e6,
+          latency.over_target, LATENCY_TARGET_NS / 1e6,
+          atomic_load(&input.dropped));
+  FrontendStats fs = ansi_frontend_stats();
+  if (fs.frames > 0)
+    fprintf(stderr, "ansi: %ld frames, %.1f bytes/frame, %.2f writes/frame\n",
+            fs.frames, (double)fs.bytes / fs.frames,
+            (double)fs.writes / fs.frames);
+}
+
+// --record: вся сессия, с рестартами, в файл записи (replay.h)
+static int save_replay(ReplayRecorder* rec, const char* path) {
+  tetris_set_recorder(tetris_default_game(), NULL);
+  int status = replay_finish(rec, tetris_default_game());
+  if (status == 0) status = replay_save(rec, path);
+  if (status != 0) fprintf(stderr, "tetris: не удалось записать %s\n", path);
+  replay_recorder_free(rec);
+  return status;
+}
+
+int main(int argc, char** argv) {
+  bool show_clock_stats = false;
+  const char* record_path = NULL;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--clock-stats") == 0) show_clock_stats = true;
+    if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+      record_path = argv[++i];
+    if (strcmp(argv[i], "--ansi") == 0) ui = &ansi_frontend;
+    if (strcmp(argv[i], "--ncurses") == 0) ui = &ncurses_frontend;
+  }
+  ReplayRecorder recorder;
+  if (record_path) {
+    if (replay_recorder_init(&recorder, 0) != 0) return 1;
+    tetris_set_recorder(tetris_default_game(), &recorder);
+  }
+  event_loop_init(&events);  // до потоков: маска сигналов наследуется
+  ui->init();
   setlocale(LC_ALL, "");
+  if (input_thread_start(&input) != 0) {
+    ui->shutdown();
+    fprintf(stderr, "tetris: не удалось запустить поток ввода\n");
+    return 1;
+  }
+  event_loop_set_input(&events, input.wake_fd);
 
   int menu_status = main_menu_status();
   if (menu_status != QUIT_INPUT) {
     game_loop();
   }
-  endwin();
+  input_thread_stop(&input);
+  ui->shutdown();
+  event_loop_close(&events);
+  if (show_clock_stats) print_clock_stats();
+  if (record_path && save_replay(&recorder, record_path) != 0) return 1;
 
   return 0;
 }
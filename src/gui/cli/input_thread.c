@@ -0,0 +1,123 @@
+#define _POSIX_C_SOURCE 200809L
+#include "input_thread.h"
+
+#include <fcntl.h>
+#include <ncurses.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "../../brick_game/tetris/game_clock.h"
+
+typedef struct {
+  unsigned char bytes[64];
+  size_t len;
+  size_t pos;
+} ByteBuffer;
+
+static int next_byte(ByteBuffer* b) {
+  return b->pos < b->len ? b->bytes[b->pos++] : ERR;
+}
+
+// стрелки приходят как ESC [ A..D (или ESC O A..D); одиночный ESC - 27.
+// Последовательность, разорванная между двумя read(), теряется
+static int decode_key(ByteBuffer* b) {
+  int ch = next_byte(b);
+  if (ch != 27) return ch;
+  int prefix = next_byte(b);
+  if (prefix != '[' && prefix != 'O') {
+    if (prefix != ERR) b->pos--;
+    return 27;
+  }
+  switch (next_byte(b)) {
+    case 'A':
+      return KEY_UP;
+    case 'B':
+      return KEY_DOWN;
+    case 'C':
+      return KEY_RIGHT;
+    case 'D':
+      return KEY_LEFT;
+    default:
+      return ERR;
+  }
+}
+
+static void push_key(InputThread* input, int key, int64_t t_ns) {
+  InputEvent event = {.t_ns = t_ns, .key = key};
+  if (!input_queue_push(&input->queue, &event))
+    atomic_fetch_add_explicit(&input->dropped, 1, memory_order_relaxed);
+}
+
+static void* input_main(void* arg) {
+  InputThread* input = arg;
+  struct pollfd fds[2] = {{.fd = STDIN_FILENO, .events = POLLIN},
+                          {.fd = input->stop_fd[0], .events = POLLIN}};
+  ByteBuffer buffer;
+  for (;;) {
+    if (poll(fds, 2, -1) < 0) continue;
+    if (fds[1].revents) break;
+    if (!(fds[0].revents & (POLLIN | POLLHUP))) continue;
+    ssize_t n = read(STDIN_FILENO, buffer.bytes, sizeof(buffer.bytes));
+    if (n <= 0) {
+      if (n == 0) break;  // stdin закрыт
+      continue;
+    }
+    int64_t now = game_clock_now_ns();
+    buffer.len = (size_t)n;
+    buffer.pos = 0;
+    while (buffer.pos < buffer.len) {
+      int key = decode_key(&buffer);
+      if (key != ERR) push_key(input, key, now);
+    }
+    if (!atomic_exchange_explicit(&input->wake_pending, true,
+                                  memory_order_acq_rel)) {
+      // до ack в канале не больше байта, он не переполнится
+      char byte = 1;
+      ssize_t written = write(input->notify_fd, &byte, 1);
+      (void)written;
+    }
+  }
+  return NULL;
+}
+
+int input_thread_start(InputThread* input) {
+  input_queue_init(&input->queue);
+  atomic_init(&input->wake_pending, false);
+  atomic_init(&input->dropped, 0);
+  input->running = false;
+  int wake[2];
+  if (pipe(wake) != 0) return -1;
+  if (pipe(input->stop_fd) != 0) {
+    close(wake[0]);
+    close(wake[1]);
+    return -1;
+  }
+  input->wake_fd = wake[0];
+  input->notify_fd = wake[1];
+  fcntl(input->wake_fd, F_SETFL, O_NONBLOCK);
+  if (pthread_create(&input->thread, NULL, input_main, input) != 0) {
+    input_thread_stop(input);
+    return -1;
+  }
+  input->running = true;
+  return 0;
+}
+
+void input_thread_stop(InputThread* input) {
+  if (input->running) {
+    char byte = 1;
+    if (write(input->stop_fd[1], &byte, 1) == 1)
+      pthread_join(input->thread, NULL);
+    input->running = false;
+  }
+  close(input->wake_fd);
+  close(input->notify_fd);
+  close(input->stop_fd[0]);
+  close(input->stop_fd[1]);
+}
+
+void input_thread_ack(InputThread* input) {
+  char bytes[16];
+  while (read(input->wake_fd, bytes, sizeof(bytes)) > 0) continue;
+  atomic_store_explicit(&input->wake_pending, false, memory_order_release);
+}
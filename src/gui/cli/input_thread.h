@@ -0,0 +1,29 @@
+#ifndef INPUT_THREAD_H_
+#define INPUT_THREAD_H_
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "../../brick_game/tetris/input_queue.h"
+
+// Поток ввода: ждёт stdin, разбирает байты в коды клавиш (стрелки -
+// KEY_LEFT и т.д. из ncurses), ставит метку CLOCK_MONOTONIC и кладёт в
+// очередь. Игровой цикл будится байтом в wake_fd, который слушает
+// event_loop; пока цикл не подтвердил пробуждение, новые не пишутся.
+typedef struct {
+  InputQueue queue;
+  int wake_fd;    // читает игровой цикл
+  int notify_fd;  // пишет поток ввода
+  int stop_fd[2];
+  atomic_bool wake_pending;
+  atomic_long dropped;  // очередь была полна
+  pthread_t thread;
+  bool running;
+} InputThread;
+
+// терминал уже должен быть в неканоническом режиме; -1 - не запустился
+int input_thread_start(InputThread* input);
+void input_thread_stop(InputThread* input);
+// снять пробуждение; после него очередь читается до пустой
+void input_thread_ack(InputThread* input);
+
+#endif
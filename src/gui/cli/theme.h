@@ -0,0 +1,30 @@
+#ifndef THEME_H_
+#define THEME_H_
+#include <ncurses.h>
+
+#define TETROMINO_COUNT 7
+
+// цвет темы: r, g, b в 0..1000 (как у init_color()) и цвет ncurses на
+// случай, если терминал не умеет менять палитру
+typedef struct {
+  short r;
+  short g;
+  short b;
+  short fallback;
+} PastelSpec;
+
+static const PastelSpec TETROMINO_SPECS[TETROMINO_COUNT] = {
+    {700, 900, 1000, COLOR_CYAN},    /* I */
+    {1000, 950, 700, COLOR_YELLOW},  /* O */
+    {700, 950, 750, COLOR_GREEN},    /* S */
+    {1000, 700, 700, COLOR_RED},     /* Z */
+    {1000, 800, 600, COLOR_MAGENTA}, /* L */
+    {750, 800, 1000, COLOR_BLUE},    /* J */
+    {900, 750, 1000, COLOR_MAGENTA}  /* T */
+};
+static const PastelSpec FIELD_SPEC = {1000, 1000, 1000, COLOR_WHITE};
+// ncurses рисует их базовыми цветами, rgb - для truecolor
+static const PastelSpec SIDEBAR_SPEC = {900, 900, 900, COLOR_WHITE};
+static const PastelSpec BORDER_SPEC = {0, 0, 0, COLOR_BLACK};
+
+#endif
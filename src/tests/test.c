@@ -1,7 +1,27 @@
+#define _POSIX_C_SOURCE 200809L
 #include <check.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
+#include "brick_game/tetris/batch_engine.h"
+#include "brick_game/tetris/bot.h"
+#include "brick_game/tetris/game_clock.h"
 #include "brick_game/tetris/game_logic.h"
+#include "brick_game/tetris/input_queue.h"
+#include "brick_game/tetris/leaderboard.h"
+#include "brick_game/tetris/movegen.h"
+#include "brick_game/tetris/netplay.h"
+#include "brick_game/tetris/planner.h"
+#include "brick_game/tetris/replay.h"
+#include "brick_game/tetris/score_writer.h"
+#include "brick_game/tetris/ttable.h"
+#include "brick_game/tetris/vec_env.h"
+#include "tools/sim_driver.h"
+#include "tools/work_pool.h"
 
 static GameInfo_t fresh_state(void) {
   userInput(Start, false);
@@ -66,6 +86,11 @@ static int min_active_row(const GameInfo_t* info) {
   return min_row;
 }
 
+static void drop_at_left(void) {
+  for (int i = 0; i < FIELD_COLS; ++i) userInput(Left, false);
+  userInput(Down, false);
+}
+
 START_TEST(test_start_initial_state) {
   GameInfo_t info = fresh_state();
   ck_assert_int_eq(info.level, 1);
@@ -158,6 +183,1321 @@ START_TEST(test_terminate_sets_game_over) {
 }
 END_TEST
 
+START_TEST(test_hard_drop_keeps_piece_color) {
+  fresh_state();
+  drop_at_left();
+  GameInfo_t info = updateCurrentState();
+  for (int c = 0; c < 4; ++c)
+    ck_assert_int_eq(info.field[FIELD_ROWS - 1][c], P_I + 1);
+  ck_assert_int_eq(info.field[FIELD_ROWS - 1][4], 0);
+}
+END_TEST
+
+START_TEST(test_full_row_is_cleared_and_scored) {
+  fresh_state();
+  drop_at_left();                              // I: колонки 0-3
+  userInput(Down, false);                      // O: колонки 4-5
+  for (int i = 0; i < 5; ++i) drop_at_left();  // S Z L J T
+  for (int i = 0; i < 3; ++i) userInput(Right, false);
+  userInput(Down, false);  // I: колонки 6-9
+  GameInfo_t info = updateCurrentState();
+  ck_assert_int_eq(info.score, 100);
+  ck_assert_int_eq(info.field[FIELD_ROWS - 1][4], P_O + 1);
+  ck_assert_int_eq(info.field[FIELD_ROWS - 1][5], P_O + 1);
+  for (int c = 6; c < FIELD_COLS; ++c)
+    ck_assert_int_eq(info.field[FIELD_ROWS - 1][c], 0);
+}
+END_TEST
+
+static void put_cell(EngineState* e, int row, int col, int color) {
+  e->field[row][col] = (uint8_t)color;
+  engine_rebuild_derived(e);
+}
+
+START_TEST(test_split_rows_are_compacted_in_one_pass) {
+  TetrisGame* g = tetris_create();
+  tetris_input(g, Start, false);  // текущая - I
+  EngineState* e = &g->engine;
+  for (int c = 1; c < FIELD_COLS; ++c) {
+    put_cell(e, 19, c, 2);
+    put_cell(e, 17, c, 4);
+    if (c < FIELD_COLS - 1) put_cell(e, 18, c, 3);  // 18 остаётся неполной
+  }
+  put_cell(e, 16, 5, 5);
+  put_cell(e, 15, 7, 6);
+  tetris_lock_at(g, 1, 16, -1);  // вертикальная I в колонку 0, строки 16-19
+  ck_assert_int_eq(e->score, 300);
+  ck_assert_int_eq(e->lines, 2);
+  ck_assert_int_eq(e->field[19][0], P_I + 1);  // бывшая 18
+  ck_assert_int_eq(e->field[19][8], 3);
+  ck_assert_int_eq(e->field[19][9], 0);
+  ck_assert_int_eq(e->field[18][0], P_I + 1);  // бывшая 16
+  ck_assert_int_eq(e->field[18][5], 5);
+  ck_assert_int_eq(e->field[17][7], 6);  // бывшая 15
+  for (int r = 0; r < FIELD_ROWS; ++r) {
+    int cells = 0;
+    for (int c = 0; c < FIELD_COLS; ++c) cells += e->field[r][c] != 0;
+    ck_assert_int_eq(cells, r == 19 ? 9 : r == 18 ? 2 : r == 17 ? 1 : 0);
+    ck_assert_uint_eq(engine_row_bits(e, r) == 0, cells == 0);
+  }
+  tetris_destroy(g);
+}
+END_TEST
+
+START_TEST(test_instances_are_independent) {
+  TetrisGame* a = tetris_create();
+  TetrisGame* b = tetris_create();
+  ck_assert_ptr_nonnull(a);
+  ck_assert_ptr_nonnull(b);
+  // рекорд на диск пишет только встроенный экземпляр
+  ck_assert(!a->persistent);
+  ck_assert(tetris_default_game()->persistent);
+  tetris_input(a, Start, false);
+  tetris_input(b, Start, false);
+  tetris_input(a, Down, false);
+  GameInfo_t ia = tetris_query(a);
+  GameInfo_t ib = tetris_query(b);
+  ck_assert_int_eq(count_row_active(&ia, FIELD_ROWS - 1), 4);
+  ck_assert_int_eq(count_row_active(&ib, FIELD_ROWS - 1), 0);
+  ck_assert_ptr_ne(ia.field, ib.field);
+  tetris_input(b, Pause, false);
+  ck_assert_int_eq(tetris_query(a).pause, 0);
+  ck_assert_int_eq(tetris_query(b).pause, 1);
+  tetris_destroy(a);
+  tetris_destroy(b);
+}
+END_TEST
+
+static void* play_scripted_game(void* arg) {
+  int* score = arg;
+  TetrisGame* g = tetris_create();
+  tetris_input(g, Start, false);
+  for (int i = 0; i < 2000 && tetris_query(g).pause != 2; ++i) {
+    if (i % 3 == 0) tetris_input(g, i % 2 ? Left : Right, false);
+    if (i % 7 == 0) tetris_input(g, Action, false);
+    tetris_step(g);
+  }
+  *score = tetris_query(g).score + 1000 * tetris_query(g).pause;
+  tetris_destroy(g);
+  return NULL;
+}
+
+START_TEST(test_instances_run_in_parallel_threads) {
+  enum { THREADS = 8 };
+  int expected = 0;
+  play_scripted_game(&expected);
+  pthread_t threads[THREADS];
+  int scores[THREADS];
+  for (int i = 0; i < THREADS; ++i)
+    pthread_create(&threads[i], NULL, play_scripted_game, &scores[i]);
+  for (int i = 0; i < THREADS; ++i) {
+    pthread_join(threads[i], NULL);
+    ck_assert_int_eq(scores[i], expected);
+  }
+}
+END_TEST
+
+START_TEST(test_snapshot_restores_full_game) {
+  TetrisGame* g = tetris_create();
+  tetris_input(g, Start, false);
+  tetris_input(g, Down, false);
+  tetris_input(g, Left, false);
+  TetrisSnapshot snap;
+  tetris_save(g, &snap);
+  GameInfo_t before = tetris_query(g);
+  int saved[FIELD_ROWS][FIELD_COLS], saved_next[4][4];
+  for (int r = 0; r < FIELD_ROWS; ++r)
+    for (int c = 0; c < FIELD_COLS; ++c) saved[r][c] = before.field[r][c];
+  for (int r = 0; r < 4; ++r)
+    for (int c = 0; c < 4; ++c) saved_next[r][c] = before.next[r][c];
+
+  for (int i = 0; i < 6; ++i) tetris_input(g, Down, false);
+  tetris_input(g, Pause, false);
+  ck_assert_int_eq(tetris_query(g).pause, 1);
+
+  tetris_restore(g, &snap);
+  GameInfo_t after = tetris_query(g);
+  ck_assert_int_eq(after.pause, 0);
+  ck_assert_int_eq(after.score, before.score);
+  for (int r = 0; r < FIELD_ROWS; ++r)
+    for (int c = 0; c < FIELD_COLS; ++c)
+      ck_assert_int_eq(after.field[r][c], saved[r][c]);
+  for (int r = 0; r < 4; ++r)
+    for (int c = 0; c < 4; ++c)
+      ck_assert_int_eq(after.next[r][c], saved_next[r][c]);
+  tetris_destroy(g);
+}
+END_TEST
+
+START_TEST(test_snapshot_is_compact_and_pointer_free) {
+  // 9 кэш-линий с генератором и очередью фигур, в том числе с битбордом
+  ck_assert_uint_le(sizeof(TetrisSnapshot), 576);
+  TetrisGame* a = tetris_create();
+  TetrisGame* b = tetris_create();
+  tetris_input(a, Start, false);
+  tetris_input(a, Down, false);
+  TetrisSnapshot snap;
+  tetris_save(a, &snap);
+  tetris_destroy(a);
+  tetris_restore(b, &snap);  // снимок живёт дольше своей игры
+  GameInfo_t info = tetris_query(b);
+  ck_assert_int_eq(count_row_active(&info, FIELD_ROWS - 1), 4);
+  tetris_destroy(b);
+}
+END_TEST
+
+START_TEST(test_movegen_counts_distinct_placements) {
+  static const int expected[P_COUNT] = {17, 9, 17, 17, 34, 34, 34};
+  EngineState empty;
+  memset(&empty, 0, sizeof(empty));
+  TetrisPlacement moves[MOVEGEN_MAX_PLACEMENTS];
+  for (int id = 0; id < P_COUNT; ++id) {
+    int count = movegen_placements(&empty, (TetrominoId)id, 0, 0,
+                                   (FIELD_COLS - MASK_SIZE) / 2, moves);
+    ck_assert_int_eq(count, expected[id]);
+    for (int i = 0; i < count; ++i) {
+      ck_assert(can_place_tetromino_in_field(&empty, (TetrominoId)id,
+                                             moves[i].rotation, moves[i].row,
+                                             moves[i].col));
+      ck_assert(!can_place_tetromino_in_field(&empty, (TetrominoId)id,
+                                              moves[i].rotation,
+                                              moves[i].row + 1, moves[i].col));
+    }
+    // далеко за стенкой - просто нельзя, без сдвигов за разрядность
+    ck_assert(!can_place_tetromino_in_field(&empty, (TetrominoId)id, 0, 5,
+                                            -100));
+    ck_assert(!can_place_tetromino_in_field(&empty, (TetrominoId)id, 0, 5,
+                                            100));
+  }
+}
+END_TEST
+
+START_TEST(test_movegen_perft_uses_preview) {
+  TetrisGame* g = tetris_create();
+  tetris_input(g, Start, false);
+  ck_assert_uint_eq(movegen_perft(g, 1), 17);   // I
+  ck_assert_uint_eq(movegen_perft(g, 2), 153);  // I, затем O из превью
+  ck_assert_uint_eq(movegen_perft(g, 3), 2632);
+  // perft не меняет игру
+  ck_assert_int_eq(tetris_query(g).score, 0);
+  GameInfo_t info = tetris_query(g);
+  ck_assert_int_eq(count_active_cells(&info), 4);
+  tetris_destroy(g);
+}
+END_TEST
+
+static uint32_t next_random(uint32_t* state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 17;
+  *state ^= *state << 5;
+  return *state;
+}
+
+START_TEST(test_eval_simd_paths_match_scalar) {
+  static EvalBoards boards;
+  static int32_t reference[EVAL_MAX_BOARDS], scores[EVAL_MAX_BOARDS];
+  uint32_t seed = 7;
+  boards.count = EVAL_MAX_BOARDS - 3;  // неполный последний блок
+  for (int i = 0; i < boards.count; ++i) {
+    int top = next_random(&seed) % FIELD_ROWS;
+    for (int r = 0; r < FIELD_ROWS; ++r)
+      boards.rows[r][i] =
+          r < top ? 0 : (uint16_t)(next_random(&seed) & FULL_ROW_BITS);
+    boards.lines[i] = (uint8_t)(next_random(&seed) % 5);
+  }
+  eval_score_boards(&boards, &EVAL_DEFAULT_WEIGHTS, EVAL_SCALAR, reference);
+  for (EvalPath path = EVAL_SSE2; path <= eval_best_path(); ++path) {
+    memset(scores, 0, sizeof(scores));
+    eval_score_boards(&boards, &EVAL_DEFAULT_WEIGHTS, path, scores);
+    for (int i = 0; i < boards.count; ++i)
+      ck_assert_int_eq(scores[i], reference[i]);
+  }
+  // пустая доска: ни высоты, ни дыр, только переходы у стенок
+  memset(&boards, 0, sizeof(boards));
+  boards.count = 1;
+  BoardFeatures f;
+  eval_board_features(&boards, 0, &f);
+  ck_assert_int_eq(f.aggregate_height, 0);
+  ck_assert_int_eq(f.holes, 0);
+  ck_assert_int_eq(f.bumpiness, 0);
+}
+END_TEST
+
+START_TEST(test_bot_clears_lines) {
+  TetrisGame* g = tetris_create();
+  TetrisBot* bot = bot_create();
+  ck_assert_ptr_nonnull(bot);
+  tetris_input(g, Start, false);
+  tetris_set_bot(g, bot);
+  for (int i = 0; i < 500 && g->state != GAME_OVER; ++i) tetris_step(g);
+  ck_assert_int_ne(g->state, GAME_OVER);
+  ck_assert_int_ge(g->engine.lines, 100);
+  ck_assert_int_gt(bot->moves_played, 0);
+  tetris_set_bot(g, NULL);
+  bot_destroy(bot);
+  tetris_destroy(g);
+}
+END_TEST
+
+// неровное поле: несколько фигур, сброшенных по разным колонкам
+static TetrisGame* uneven_position(void) {
+  TetrisGame* g = tetris_create();
+  tetris_input(g, Start, false);
+  for (int i = 0; i < 6; ++i) {
+    for (int s = 0; s < i % 4; ++s)
+      tetris_input(g, i % 2 ? Left : Right, false);
+    tetris_input(g, Down, false);
+  }
+  return g;
+}
+
+START_TEST(test_planner_is_thread_count_independent) {
+  TetrisGame* g = uneven_position();
+  PlannerConfig config = PLANNER_DEFAULT_CONFIG;
+  config.beam_width = 16;
+  config.budget_ms = 0;
+  TetrisPlacement moves[2];
+  for (int i = 0; i < 2; ++i) {
+    config.threads = 1 + 2 * i;
+    TetrisPlanner* planner = planner_create(&config);
+    ck_assert_ptr_nonnull(planner);
+    ck_assert(planner_choose(planner, g, &moves[i]));
+    const PlannerStats* st = planner_stats(planner);
+    ck_assert_int_eq(st->last_depth, 2);
+    ck_assert_int_eq(st->last_nodes, 1 + 16);  // корень и весь второй слой
+    planner_destroy(planner);
+  }
+  ck_assert_int_eq(moves[0].rotation, moves[1].rotation);
+  ck_assert_int_eq(moves[0].row, moves[1].row);
+  ck_assert_int_eq(moves[0].col, moves[1].col);
+
+  // повторы в слое отсеиваются одинаково через таблицу и без неё
+  config.threads = 1;
+  config.max_depth = 3;
+  long duplicates[2];
+  TTable* tt = tt_create(1 << 16);
+  ck_assert_ptr_nonnull(tt);
+  for (int i = 0; i < 2; ++i) {
+    config.tt = i ? tt : NULL;
+    TetrisPlanner* planner = planner_create(&config);
+    ck_assert_ptr_nonnull(planner);
+    ck_assert(planner_choose(planner, g, &moves[i]));
+    duplicates[i] = planner_stats(planner)->duplicates;
+    planner_destroy(planner);
+  }
+  ck_assert_int_eq(duplicates[0], duplicates[1]);
+  ck_assert_int_eq(moves[0].col, moves[1].col);
+  ck_assert_int_gt(atomic_load(&tt_stats(tt)->probes), 1);
+  tt_destroy(tt);
+  tetris_destroy(g);
+}
+END_TEST
+
+START_TEST(test_planner_drives_bot) {
+  TetrisGame* g = tetris_create();
+  TetrisBot* bot = bot_create();
+  PlannerConfig config = PLANNER_DEFAULT_CONFIG;
+  config.beam_width = 8;
+  config.max_depth = 3;
+  bot->planner = planner_create(&config);
+  ck_assert_ptr_nonnull(bot->planner);
+  tetris_input(g, Start, false);
+  tetris_set_bot(g, bot);
+  for (int i = 0; i < 200 && g->state != GAME_OVER; ++i) tetris_step(g);
+  ck_assert_int_ne(g->state, GAME_OVER);
+  ck_assert_int_ge(g->engine.lines, 40);
+  ck_assert_int_eq(planner_stats(bot->planner)->moves, bot->moves_played);
+  tetris_set_bot(g, NULL);
+  planner_destroy(bot->planner);
+  bot_destroy(bot);
+  tetris_destroy(g);
+}
+END_TEST
+
+START_TEST(test_zobrist_hash_is_incremental) {
+  TetrisGame* g = tetris_create();
+  TetrisBot* bot = bot_create();
+  tetris_input(g, Start, false);
+  ck_assert_uint_eq(engine_hash(&g->engine),
+                    engine_hash_recompute(&g->engine));
+  tetris_set_bot(g, bot);
+  uint64_t start = engine_hash(&g->engine);
+  for (int i = 0; i < 60 && g->state != GAME_OVER; ++i) {
+    tetris_step(g);
+    ck_assert_uint_eq(engine_hash(&g->engine),
+                      engine_hash_recompute(&g->engine));
+  }
+  ck_assert_int_gt(g->engine.lines, 0);  // проверены и снятые строки
+  ck_assert_uint_ne(engine_hash(&g->engine), start);
+  tetris_set_bot(g, NULL);
+  bot_destroy(bot);
+  tetris_destroy(g);
+}
+END_TEST
+
+START_TEST(test_ttable_buckets_and_replacement) {
+  TTable* tt = tt_create(1);  // одна корзина на TT_BUCKET_ENTRIES записей
+  ck_assert_ptr_nonnull(tt);
+  ck_assert_uint_eq(tt_buckets(tt), 1);
+  TTData in = {.score = -1234, .depth = 3, .move = {2, 17, -1}}, out;
+  tt_store(tt, 100, &in);
+  ck_assert(tt_probe(tt, 100, &out));
+  ck_assert_int_eq(out.score, -1234);
+  ck_assert_int_eq(out.depth, 3);
+  ck_assert_int_eq(out.move.rotation, 2);
+  ck_assert_int_eq(out.move.row, 17);
+  ck_assert_int_eq(out.move.col, -1);
+  for (uint64_t key = 101; key < 100 + TT_BUCKET_ENTRIES; ++key) {
+    in.depth = (uint8_t)key;  // глубже первой записи
+    tt_store(tt, key, &in);
+  }
+  ck_assert(!tt_probe(tt, 7, &out));
+  ck_assert_int_eq(atomic_load(&tt_stats(tt)->collisions), 1);
+  // корзина полна: вытесняется самая мелкая запись, то есть ключ 100
+  tt_store(tt, 200, &in);
+  ck_assert_int_eq(atomic_load(&tt_stats(tt)->replacements), 1);
+  ck_assert(!tt_probe(tt, 100, &out));
+  ck_assert(tt_probe(tt, 200, &out));
+  // после tt_new_search старые записи уступают даже мелкой новой
+  tt_new_search(tt);
+  in.depth = 1;
+  tt_store(tt, 300, &in);
+  ck_assert(tt_probe(tt, 300, &out));
+  ck_assert_int_eq(atomic_load(&tt_stats(tt)->hits), 3);
+  tt_destroy(tt);
+}
+END_TEST
+
+START_TEST(test_score_writer_coalesces_and_flushes) {
+  char path[64];
+  snprintf(path, sizeof(path), "/tmp/tetris_score_%ld.dat", (long)getpid());
+  ScoreWriterStats before = score_writer_stats();
+  for (int score = 1; score <= 500; ++score)
+    score_writer_submit(path, score);
+  score_writer_flush();
+  ScoreWriterStats after = score_writer_stats();
+  ck_assert_int_eq(after.submitted - before.submitted, 500);
+  ck_assert_int_ge(after.written - before.written, 1);
+  ck_assert_int_le(after.written - before.written, 500);
+  ck_assert_int_eq(after.failed, before.failed);
+  FILE* file = fopen(path, "r");
+  ck_assert_ptr_nonnull(file);
+  int stored = 0;
+  ck_assert_int_eq(fscanf(file, "%d", &stored), 1);
+  fclose(file);
+  ck_assert_int_eq(stored, 500);  // последнее значение, файл целый
+  remove(path);
+}
+END_TEST
+
+START_TEST(test_leaderboard_keeps_top_across_processes) {
+  char path[64];
+  snprintf(path, sizeof(path), "/tmp/tetris_board_%ld.bin", (long)getpid());
+  remove(path);
+  Leaderboard* board = leaderboard_open(path, 4);
+  ck_assert_ptr_nonnull(board);
+  ck_assert_int_eq(leaderboard_best(board, 1), -1);
+  // два процесса пишут одному игроку одновременно
+  pid_t child = fork();
+  ck_assert_int_ge(child, 0);
+  int first = child == 0 ? 1 : 2;
+  for (int score = first; score <= 400; score += 2)
+    leaderboard_submit(board, 1, score);
+  if (child == 0) _exit(0);
+  int status = 0;
+  waitpid(child, &status, 0);
+  ck_assert(WIFEXITED(status));
+  ck_assert_int_eq(leaderboard_submit(board, 1, 3), 0);
+  ck_assert_int_eq(leaderboard_submit(board, 9, 3), -1);
+  leaderboard_close(board);
+
+  board = leaderboard_open(path, 0);
+  ck_assert_ptr_nonnull(board);
+  ck_assert_int_eq(leaderboard_players(board), 4);
+  ck_assert_int_eq(leaderboard_best(board, 1), 400);
+  int32_t top[LEADERBOARD_TOP_N];
+  ck_assert_int_eq(leaderboard_top(board, 1, top), LEADERBOARD_TOP_N);
+  for (int i = 0; i < LEADERBOARD_TOP_N; ++i) ck_assert_int_eq(top[i], 400 - i);
+  ck_assert_int_eq(leaderboard_top(board, 0, top), 0);
+  leaderboard_close(board);
+
+  // порча текущей копии: читается предыдущая, без последнего результата
+  FILE* file = fopen(path, "r+b");
+  ck_assert_ptr_nonnull(file);
+  LeaderboardRecord record;
+  long offset = sizeof(LeaderboardHeader) + sizeof(LeaderboardRecord);
+  fseek(file, offset, SEEK_SET);
+  ck_assert_int_eq(fread(&record, sizeof(record), 1, file), 1);
+  record.copy[atomic_load(&record.active)].heap[0] ^= 0x5A;
+  fseek(file, offset, SEEK_SET);
+  fwrite(&record, sizeof(record), 1, file);
+  fclose(file);
+  board = leaderboard_open(path, 0);
+  ck_assert_int_eq(leaderboard_top(board, 1, top), LEADERBOARD_TOP_N);
+  ck_assert_int_eq(top[0], 400);
+  leaderboard_close(board);
+  remove(path);
+}
+END_TEST
+
+START_TEST(test_game_clock_fixed_steps) {
+  const int64_t ms = 1000000;
+  GameClock clock;
+  game_clock_init(&clock, 50 * ms, 0);
+  ck_assert_int_eq(game_clock_advance(&clock, 20 * ms), 0);
+  ck_assert_int_eq(game_clock_wait_ns(&clock, 20 * ms), 30 * ms);
+  // остаток переходит в следующий вызов
+  ck_assert_int_eq(game_clock_advance(&clock, 120 * ms), 2);
+  ck_assert_int_eq(clock.accumulator_ns, 20 * ms);
+  ck_assert_int_eq(clock.stats.late_max_ns, 70 * ms);
+  ck_assert(clock.stats.late_mean_ns == 45.0 * ms);
+  ck_assert_int_eq(game_clock_wait_ns(&clock, 120 * ms), 30 * ms);
+  // долгая остановка не догоняется
+  ck_assert_int_eq(game_clock_advance(&clock, 10000 * ms),
+                   GAME_CLOCK_MAX_CATCHUP);
+  ck_assert_int_eq(clock.stats.dropped, 190);
+  ck_assert_int_eq(clock.stats.steps, 2 + GAME_CLOCK_MAX_CATCHUP);
+  ck_assert_int_eq(game_clock_wait_ns(&clock, 10000 * ms), 50 * ms);
+  // время не идёт назад
+  ck_assert_int_eq(game_clock_advance(&clock, 9000 * ms), 0);
+  ck_assert_int_eq(game_clock_deadline_ns(&clock), 10050 * ms);
+  // пауза: простой не превращается в шаги
+  game_clock_rebase(&clock, 20000 * ms);
+  ck_assert_int_eq(game_clock_advance(&clock, 20040 * ms), 0);
+  ck_assert_int_eq(game_clock_advance(&clock, 20050 * ms), 1);
+  ck_assert_int_eq(fresh_state().speed * TETRIS_TICK_MS, 600);
+}
+END_TEST
+
+START_TEST(test_engine_events_follow_fsm_actions) {
+  TetrisGame* g = tetris_create();
+  TetrisEvent storage[8];
+  TetrisEventRing ring;
+  ck_assert_int_eq(tetris_event_ring_init(&ring, storage, 6), -1);
+  ck_assert_int_eq(tetris_event_ring_init(&ring, storage, 8), 0);
+  tetris_set_event_ring(g, &ring);
+  tetris_input(g, Start, false);  // текущая - I
+  TetrisEvent ev;
+  ck_assert(tetris_event_pop(&ring, &ev));
+  ck_assert_int_eq(ev.type, TETRIS_EVENT_RESET);
+  ck_assert(tetris_event_pop(&ring, &ev));
+  ck_assert_int_eq(ev.type, TETRIS_EVENT_SPAWN);
+  ck_assert_int_eq(ev.piece.id, P_I);
+  ck_assert_int_eq(ev.piece.next, P_O);
+  ck_assert(tetris_event_pop(&ring, &ev));
+  ck_assert_int_eq(ev.type, TETRIS_EVENT_STATE);
+  ck_assert_int_eq(ev.state.from, START);
+  ck_assert_int_eq(ev.state.to, FALLING);
+  ck_assert(!tetris_event_pop(&ring, &ev));
+
+  // тик без падения и упор в стенку событий не дают
+  tetris_step(g);
+  for (int i = 0; i < FIELD_COLS; ++i) tetris_input(g, Left, false);
+  int moves = 0;
+  while (tetris_event_pop(&ring, &ev)) {
+    ck_assert_int_eq(ev.type, TETRIS_EVENT_MOVE);
+    moves++;
+  }
+  ck_assert_int_eq(moves, (FIELD_COLS - MASK_SIZE) / 2);
+
+  EngineState* e = &g->engine;
+  for (int c = 1; c < FIELD_COLS; ++c) {
+    put_cell(e, 19, c, 2);
+    put_cell(e, 17, c, 4);
+    if (c < FIELD_COLS - 1) put_cell(e, 18, c, 3);
+  }
+  tetris_lock_at(g, 1, 16, -1);
+  const int expected[] = {TETRIS_EVENT_LOCK, TETRIS_EVENT_ROWS_CLEARED,
+                          TETRIS_EVENT_SCORE, TETRIS_EVENT_SPAWN};
+  for (int i = 0; i < 4; ++i) {
+    ck_assert(tetris_event_pop(&ring, &ev));
+    ck_assert_int_eq(ev.type, expected[i]);
+    if (ev.type == TETRIS_EVENT_LOCK) ck_assert_int_eq(ev.piece.row, 16);
+    if (ev.type == TETRIS_EVENT_ROWS_CLEARED) {
+      ck_assert_int_eq(ev.rows.count, 2);
+      ck_assert_uint_eq(ev.rows.mask, (1u << 17) | (1u << 19));
+    }
+    if (ev.type == TETRIS_EVENT_SCORE) ck_assert_int_eq(ev.value, 300);
+  }
+  ck_assert(!tetris_event_pop(&ring, &ev));
+
+  // переполнение считается, а не затирает непрочитанное
+  for (int i = 0; i < 12; ++i) tetris_input(g, Action, false);
+  ck_assert_uint_eq(ring.dropped, 4);
+  ck_assert(tetris_event_pop(&ring, &ev));
+  ck_assert_int_eq(ev.type, TETRIS_EVENT_ROTATE);
+  ck_assert_int_eq(ev.piece.rotation, 1);
+  tetris_destroy(g);
+}
+END_TEST
+
+START_TEST(test_query_frame_rebuilds_only_dirty_rows) {
+  TetrisGame* g = tetris_create();
+  tetris_input(g, Start, false);
+  TetrisFrameInfo frame = tetris_query_frame(g);
+  ck_assert_uint_eq(frame.dirty_rows, (1u << FIELD_ROWS) - 1);
+  ck_assert(frame.next_changed);
+  frame = tetris_query_frame(g);
+  ck_assert_uint_eq(frame.dirty_rows, 0);
+  ck_assert(!frame.next_changed);
+
+  int previous[FIELD_ROWS][FIELD_COLS];
+  const UserAction_t script[] = {Left, Action, Right, Right, Down, Left};
+  for (int i = 0; i < 3000; ++i) {
+    for (int r = 0; r < FIELD_ROWS; ++r)
+      memcpy(previous[r], frame.info.field[r], sizeof(previous[r]));
+    if (i % 3 == 0) tetris_input(g, script[(i / 3) % 6], false);
+    tetris_step(g);
+    frame = tetris_query_frame(g);
+    if (frame.info.pause == 2) {
+      tetris_input(g, Start, false);
+      continue;
+    }
+    // итог тот же, что при полной пересборке, вне dirty_rows ничего нового
+    const EngineState* e = &g->engine;
+    for (int r = 0; r < FIELD_ROWS; ++r)
+      for (int c = 0; c < FIELD_COLS; ++c) {
+        int expected = e->field[r][c];
+        int mr = r - e->row, mc = c - e->col;
+        if (mr >= 0 && mr < 4 && mc >= 0 && mc < 4 &&
+            (TETROMINO_ROW_BITS[e->cur_tetromino_id][e->rotation][mr] >> mc) &
+                1)
+          expected = e->cur_tetromino_id + 1;
+        ck_assert_int_eq(frame.info.field[r][c], expected);
+        if (!(frame.dirty_rows & (1u << r)))
+          ck_assert_int_eq(previous[r][c], expected);
+      }
+  }
+  tetris_destroy(g);
+}
+END_TEST
+
+START_TEST(test_replay_is_compact_and_seeks_exactly) {
+  TetrisGame* g = tetris_create();
+  ReplayRecorder rec;
+  ck_assert_int_eq(replay_recorder_init(&rec, 0), 0);
+  tetris_set_recorder(g, &rec);
+  tetris_input(g, Start, false);
+  // ввод раз в 1..8 тиков, как у человека; мягкое падение и пауза тоже
+  enum { TICKS = 6000, EVERY = 500 };
+  TetrisSnapshot expected[TICKS / EVERY + 1];
+  uint64_t rng = 12345;
+  int gap = 0;
+  for (int t = 0; t < TICKS; ++t) {
+    if (--gap <= 0) {
+      rng = rng * 6364136223846793005ull + 1442695040888963407ull;
+      int roll = (int)(rng >> 59);  // 0..31
+      UserAction_t action = roll < 10   ? Left
+                            : roll < 20 ? Right
+                            : roll < 26 ? Action
+                                        : Down;
+      tetris_input(g, action, roll >= 29);
+      if (roll == 31) tetris_input(g, Pause, false);
+      if (roll == 30 && t % 2) tetris_input(g, Pause, false);
+      gap = 1 + (int)(rng >> 61);
+    }
+    if (g->state == GAME_OVER) tetris_input(g, Start, false);
+    if (t % EVERY == 0) tetris_save(g, &expected[t / EVERY]);
+    tetris_step(g);
+  }
+  tetris_set_recorder(g, NULL);
+  ck_assert_int_eq(replay_finish(&rec, g), 0);
+  ck_assert_uint_eq(rec.ticks, TICKS);
+  ck_assert_uint_eq(rec.keyframes, TICKS / REPLAY_KEYFRAME_TICKS - 1);
+  ck_assert_uint_lt(rec.len, 2 * rec.inputs);  // вместе с ключевыми кадрами
+
+  ReplayPlayer player;
+  ck_assert_int_eq(replay_player_open(&player, rec.data, rec.len), 0);
+  TetrisGame* view = tetris_create();
+  ck_assert_int_eq(replay_verify(&player, view), 0);
+  ck_assert_int_eq(view->engine.score, g->engine.score);
+  // перемотка с ключевого кадра даёт то же, что проигрывание с начала
+  for (int k = 0; k < TICKS / EVERY; ++k) {
+    ck_assert_int_eq(replay_seek(&player, view, (uint32_t)(k * EVERY)), 0);
+    const EngineState* a = &view->engine;
+    const EngineState* b = &expected[k].engine;
+    ck_assert_int_eq(view->state, expected[k].state);
+    ck_assert(engine_hash(a) == engine_hash(b));
+    ck_assert(engine_hash_recompute(a) == engine_hash(b));
+    ck_assert_int_eq(a->score, b->score);
+    ck_assert_int_eq(a->row * 100 + a->col * 10 + a->rotation,
+                     b->row * 100 + b->col * 10 + b->rotation);
+    ck_assert_int_eq(a->tick, b->tick);
+    ck_assert_int_eq(a->pieces, b->pieces);
+  }
+  replay_player_close(&player);
+  rec.data[1] ^= 1;
+  ck_assert_int_eq(replay_player_open(&player, rec.data, rec.len), -1);
+  replay_recorder_free(&rec);
+  // фиксация за пределами поля - ошибка потока, а не сдвиг за разрядность
+  const int bad_places[][2] = {{FIELD_ROWS, 0}, {0, FIELD_COLS + 30},
+                               {-MASK_SIZE, 0}, {0, -1000}};
+  for (int i = 0; i < 4; ++i) {
+    ck_assert_int_eq(replay_recorder_init(&rec, 0), 0);
+    tetris_set_recorder(g, &rec);
+    tetris_input(g, Start, false);
+    tetris_step(g);
+    replay_record_place(&rec, 0, bad_places[i][0], bad_places[i][1]);
+    tetris_set_recorder(g, NULL);
+    ck_assert_int_eq(replay_finish(&rec, g), 0);
+    ck_assert_int_eq(replay_player_open(&player, rec.data, rec.len), 0);
+    ck_assert_int_eq(replay_verify(&player, view), -1);
+    replay_player_close(&player);
+    replay_recorder_free(&rec);
+  }
+  tetris_destroy(view);
+  tetris_destroy(g);
+}
+END_TEST
+
+START_TEST(test_input_queue_and_auto_repeat) {
+  const int64_t ms = 1000000;
+  static InputQueue queue;
+  input_queue_init(&queue);
+  InputEvent event = {.t_ns = 0, .key = 0};
+  for (int i = 0; i < INPUT_QUEUE_SIZE; ++i) {
+    event.key = i;
+    ck_assert(input_queue_push(&queue, &event));
+  }
+  ck_assert(!input_queue_push(&queue, &event));
+  for (int i = 0; i < INPUT_QUEUE_SIZE; ++i) {
+    ck_assert(input_queue_pop(&queue, &event));
+    ck_assert_int_eq(event.key, i);
+  }
+  ck_assert(!input_queue_pop(&queue, &event));
+
+  // нажатие, через 500 мс автоповтор терминала каждые 33 мс до 797 мс
+  AutoRepeat repeat;
+  auto_repeat_init(&repeat);
+  int applied = 0, repeats = 0;
+  for (int64_t t = 0; t <= 800; t = t == 0 ? 500 : t + 33) {
+    event = (InputEvent){.t_ns = t * ms, .key = 'L'};
+    applied += auto_repeat_event(&repeat, &event, true);
+    repeats += auto_repeat_due(&repeat, t * ms);
+  }
+  ck_assert_int_eq(applied, 2);  // само нажатие и первый автоповтор
+  ck_assert_int_eq(auto_repeat_deadline(&repeat), 803 * ms);
+  repeats += auto_repeat_due(&repeat, 2000 * ms);
+  // повторы с шагом ARR с 533 мс до отпускания через 100 мс тишины
+  ck_assert_int_eq(repeats, (797 + 100 - 533) / AUTO_REPEAT_ARR_MS + 1);
+  ck_assert_int_eq(auto_repeat_deadline(&repeat), -1);
+  // отдельные нажатия не склеиваются
+  event.t_ns = 3000 * ms;
+  ck_assert(auto_repeat_event(&repeat, &event, true));
+  event.t_ns = 3200 * ms;
+  ck_assert(auto_repeat_event(&repeat, &event, true));
+  ck_assert_int_eq(auto_repeat_due(&repeat, 3300 * ms), 0);
+
+  // удержание вниз - мягкое падение на одну строку
+  GameInfo_t info = fresh_state();
+  int start_row = min_active_row(&info);
+  userInput(Down, true);
+  info = updateCurrentState();
+  ck_assert_int_eq(min_active_row(&info), start_row + 1);
+}
+END_TEST
+
+START_TEST(test_vec_env_matches_single_games) {
+  enum { N = 3, STEPS = 3000 };
+  TetrisVecObs obs;
+  void* buffer = aligned_alloc(64, tetris_vec_obs_size(N));
+  tetris_vec_obs_bind(&obs, buffer, N);
+  ck_assert_uint_eq((uintptr_t)obs.done % 64, 0);
+  TetrisVecEnv* env = tetris_vec_create(&obs, true);
+  ck_assert_ptr_nonnull(env);
+  // эталон - обычные игры с тем же вводом
+  TetrisGame* ref[N];
+  int last_score[N] = {0};
+  for (int i = 0; i < N; ++i) {
+    ref[i] = tetris_create();
+    tetris_input(ref[i], Start, false);
+  }
+  static const UserAction_t map[] = {Start, Left, Right, Action, Down, Down};
+  uint64_t rng = 99;
+  int games_ended = 0;
+  for (int t = 0; t < STEPS; ++t) {
+    uint8_t actions[N];
+    for (int i = 0; i < N; ++i) {
+      rng = rng * 6364136223846793005ull + 1442695040888963407ull;
+      actions[i] = (uint8_t)((rng >> 33) % TETRIS_VEC_ACTIONS);
+      if (actions[i] != TETRIS_VEC_NOOP)
+        tetris_input(ref[i], map[actions[i]],
+                     actions[i] == TETRIS_VEC_SOFT_DROP);
+      tetris_step(ref[i]);
+    }
+    tetris_vec_step(env, actions);
+    for (int i = 0; i < N; ++i) {
+      const EngineState* e = &ref[i]->engine;
+      ck_assert_int_eq(obs.score_delta[i], e->score - last_score[i]);
+      last_score[i] = e->score;
+      ck_assert_int_eq(obs.done[i], ref[i]->state == GAME_OVER);
+      if (obs.done[i]) {
+        games_ended++;
+        tetris_input(ref[i], Start, false);
+        last_score[i] = 0;
+      }
+      for (int r = 0; r < FIELD_ROWS; ++r)
+        ck_assert_uint_eq(obs.board[i * FIELD_ROWS + r],
+                          engine_row_bits(e, r));
+      ck_assert_int_eq(obs.piece_id[i], e->cur_tetromino_id);
+      ck_assert_int_eq(obs.piece_rotation[i], e->rotation);
+      ck_assert_int_eq(obs.piece_row[i], e->row);
+      ck_assert_int_eq(obs.piece_col[i], e->col);
+      ck_assert_int_eq(obs.next_id[i], e->next_tetromino_id);
+    }
+  }
+  ck_assert_int_gt(games_ended, 0);
+  tetris_vec_destroy(env);
+
+  // без автосброса партия стоит до tetris_vec_reset() по маске
+  env = tetris_vec_create(&obs, false);
+  uint8_t drop[N] = {TETRIS_VEC_HARD_DROP, TETRIS_VEC_NOOP, TETRIS_VEC_NOOP};
+  for (int t = 0; t < 200 && !obs.done[0]; ++t) tetris_vec_step(env, drop);
+  ck_assert_int_eq(obs.done[0], 1);
+  tetris_vec_step(env, drop);
+  ck_assert_int_eq(obs.done[0], 1);
+  ck_assert_int_eq(obs.done[1], 0);
+  uint8_t mask[N] = {1, 0, 0};
+  tetris_vec_reset(env, mask);
+  ck_assert_int_eq(obs.done[0], 0);
+  for (int r = 0; r < FIELD_ROWS; ++r) ck_assert_uint_eq(obs.board[r], 0);
+  tetris_vec_destroy(env);
+  for (int i = 0; i < N; ++i) tetris_destroy(ref[i]);
+  free(buffer);
+}
+END_TEST
+
+// одинаковый мусор снизу в эталоне и в игре i пакета: колодец в одну
+// клетку через 12 строк, каждая третья строка с лишней дырой. Случайный ввод
+// тогда часто снимает строки, в том числе несколько вразбивку
+static void put_garbage(TetrisGame* g, BatchEngine* batch, int i,
+                        uint64_t* rng) {
+  *rng = *rng * 6364136223846793005ull + 1442695040888963407ull;
+  int well = (int)((*rng >> 33) % FIELD_COLS);
+  for (int r = FIELD_ROWS - 12; r < FIELD_ROWS; ++r) {
+    for (int c = 0; c < FIELD_COLS; ++c) {
+      if (c == well || (r % 3 == 0 && c == (well + 5) % FIELD_COLS)) continue;
+      put_cell(&g->engine, r, c, 1 + c % P_COUNT);
+      batch->rows[r * batch->lanes + (uint32_t)i] |= (uint16_t)(1u << c);
+    }
+  }
+}
+
+START_TEST(test_batch_engine_matches_scalar_engine) {
+  // 37 игр - два полных блока и неполный; в каждом пути SIMD тот же ввод
+  enum { N = 37, STEPS = 4000 };
+  static const UserAction_t map[] = {Start, Left, Right, Action, Down, Down};
+  for (EvalPath path = EVAL_SCALAR; path <= eval_best_path(); ++path) {
+    BatchEngine batch;
+    ck_assert_int_eq(batch_engine_init(&batch, N, path), 0);
+    ck_assert_int_eq(batch.path, path);
+    TetrisGame* ref[N];
+    for (int i = 0; i < N; ++i) {
+      ref[i] = tetris_create();
+      tetris_input(ref[i], Start, false);
+    }
+    uint64_t rng = 2024;
+    for (int i = 0; i < N; ++i) put_garbage(ref[i], &batch, i, &rng);
+    int games_ended = 0, lines = 0;
+    for (int t = 0; t < STEPS; ++t) {
+      uint8_t actions[N];
+      for (int i = 0; i < N; ++i) {
+        rng = rng * 6364136223846793005ull + 1442695040888963407ull;
+        int roll = (int)(rng >> 58);  // 0..63
+        actions[i] = roll < 6    ? TETRIS_VEC_HARD_DROP
+                     : roll < 14 ? TETRIS_VEC_LEFT
+                     : roll < 26 ? TETRIS_VEC_RIGHT
+                     : roll < 36 ? TETRIS_VEC_ROTATE
+                     : roll < 44 ? TETRIS_VEC_SOFT_DROP
+                                 : TETRIS_VEC_NOOP;
+        if (actions[i] != TETRIS_VEC_NOOP)
+          tetris_input(ref[i], map[actions[i]],
+                       actions[i] == TETRIS_VEC_SOFT_DROP);
+        tetris_step(ref[i]);
+      }
+      batch_engine_step(&batch, actions);
+      for (int i = 0; i < N; ++i) {
+        const EngineState* e = &ref[i]->engine;
+        for (int r = 0; r < FIELD_ROWS; ++r)
+          ck_assert_uint_eq(batch.rows[r * batch.lanes + i],
+                            engine_row_bits(e, r));
+        ck_assert_int_eq(batch.state[i], ref[i]->state);
+        ck_assert_int_eq(batch.id[i], e->cur_tetromino_id);
+        ck_assert_int_eq(batch.pieces[i] % P_COUNT, e->next_tetromino_id);
+        ck_assert_int_eq(batch.rotation[i], e->rotation);
+        ck_assert_int_eq(batch.row[i], e->row);
+        ck_assert_int_eq(batch.col[i], e->col);
+        ck_assert_int_eq(batch.score[i], e->score);
+        ck_assert_int_eq(batch.lines[i], e->lines);
+        ck_assert_int_eq(batch.level[i], e->level);
+        ck_assert_int_eq(batch.speed[i], e->speed);
+        ck_assert_int_eq(batch.tick[i], e->tick);
+        ck_assert_int_eq(batch.pieces[i], e->pieces);
+        if (ref[i]->state == GAME_OVER) {
+          games_ended++;
+          lines += e->lines;
+          tetris_input(ref[i], Start, false);
+          batch_engine_reset(&batch, (uint32_t)i);
+          put_garbage(ref[i], &batch, i, &rng);
+        }
+      }
+    }
+    ck_assert_int_gt(games_ended, 0);
+    ck_assert_int_gt(lines, STEPS / 10);
+    for (int i = 0; i < N; ++i) tetris_destroy(ref[i]);
+    batch_engine_free(&batch);
+  }
+}
+END_TEST
+
+static void assert_features_recomputed(const TetrisGame* g) {
+  FieldFeatures expected;
+  engine_features_recompute(&g->engine, &expected);
+  const FieldFeatures* f = tetris_features(g);
+  for (int c = 0; c < FIELD_COLS; ++c) {
+    ck_assert_int_eq(f->height[c], expected.height[c]);
+    ck_assert_int_eq(f->cells[c], expected.cells[c]);
+    ck_assert_int_eq(f->well[c], expected.well[c]);
+  }
+  ck_assert_int_eq(f->aggregate_height, expected.aggregate_height);
+  ck_assert_int_eq(f->max_height, expected.max_height);
+  ck_assert_int_eq(f->holes, expected.holes);
+  ck_assert_int_eq(f->bumpiness, expected.bumpiness);
+  ck_assert_int_eq(f->wells, expected.wells);
+}
+
+START_TEST(test_field_features_follow_locks_and_clears) {
+  TetrisGame* g = tetris_create();
+  tetris_input(g, Start, false);
+  const FieldFeatures* f = tetris_features(g);
+  ck_assert_int_eq(f->aggregate_height, 0);
+  for (int i = 0; i < FIELD_COLS; ++i) tetris_input(g, Left, false);
+  tetris_input(g, Down, false);  // I: колонки 0-3 на дне
+  tetris_input(g, Down, false);  // O: колонки 4-5, высота 2
+  tetris_input(g, Down, false);  // S: (16,5) (16,6) (17,4) (17,5)
+  static const uint8_t heights[FIELD_COLS] = {1, 1, 1, 1, 3, 4, 4, 0, 0, 0};
+  for (int c = 0; c < FIELD_COLS; ++c)
+    ck_assert_int_eq(f->height[c], heights[c]);
+  ck_assert_int_eq(f->holes, 3);  // под S в колонке 6
+  ck_assert_int_eq(f->aggregate_height, 15);
+  ck_assert_int_eq(f->max_height, 4);
+  ck_assert_int_eq(f->bumpiness, 7);
+  assert_features_recomputed(g);
+
+  // случайная игра поверх колодца: снятие строк, в том числе верхней
+  // строки колонок с дырами под ней
+  uint64_t rng = 77;
+  int lines = 0;
+  for (int game = 0; game < 20; ++game) {
+    tetris_input(g, Start, false);
+    int well = game % FIELD_COLS;
+    for (int r = FIELD_ROWS - 10; r < FIELD_ROWS; ++r)
+      for (int c = 0; c < FIELD_COLS; ++c)
+        if (c != well && !(r % 4 == 0 && c == (well + 3) % FIELD_COLS))
+          put_cell(&g->engine, r, c, 1 + c % P_COUNT);
+    assert_features_recomputed(g);
+    for (int t = 0; t < 3000 && g->state != GAME_OVER; ++t) {
+      if (g->engine.cur_tetromino_id == P_I && g->engine.rotation == 0) {
+        tetris_input(g, Action, false);  // вертикальная: колонка col + 1
+        for (int i = 0; i < FIELD_COLS; ++i)
+          tetris_input(g, g->engine.col + 1 > well ? Left : Right, false);
+        tetris_input(g, Down, false);
+      }
+      rng = rng * 6364136223846793005ull + 1442695040888963407ull;
+      int roll = (int)(rng >> 59);  // 0..31
+      UserAction_t action = roll < 10   ? Left
+                            : roll < 20 ? Right
+                            : roll < 28 ? Action
+                                        : Down;
+      tetris_input(g, action, roll < 31);
+      tetris_step(g);
+      assert_features_recomputed(g);
+    }
+    lines += g->engine.lines;
+  }
+  ck_assert_int_gt(lines, 20);
+
+  // снимок уносит признаки вместе с полем
+  TetrisSnapshot snap;
+  tetris_save(g, &snap);
+  tetris_input(g, Start, false);
+  ck_assert_int_eq(f->aggregate_height, 0);
+  tetris_restore(g, &snap);
+  assert_features_recomputed(g);
+  tetris_destroy(g);
+}
+END_TEST
+
+// следующие n фигур игры: каждая падает на дно, поле потом очищается, так
+// что партия не кончается
+static void deal_pieces(TetrisGame* g, uint8_t* out, int n) {
+  EngineState* e = &g->engine;
+  for (int i = 0; i < n; ++i) {
+    out[i] = (uint8_t)e->cur_tetromino_id;
+    int row = e->row;
+    while (can_place_tetromino_in_field(e, e->cur_tetromino_id, e->rotation,
+                                        row + 1, e->col))
+      ++row;
+    tetris_lock_at(g, e->rotation, row, e->col);
+    memset(e->field, 0, sizeof(e->field));
+    engine_rebuild_derived(e);
+  }
+}
+
+START_TEST(test_randomizers_are_seeded_and_queue_peeks) {
+  enum { PIECES = 210 };
+  uint8_t a[PIECES], b[PIECES];
+  TetrisGame* g = tetris_create();
+  tetris_input(g, Start, false);
+  deal_pieces(g, a, PIECES);
+  for (int i = 0; i < PIECES; ++i) ck_assert_int_eq(a[i], i % P_COUNT);
+
+  for (int kind = RANDOMIZER_BAG7; kind < RANDOMIZER_KINDS; ++kind) {
+    tetris_set_randomizer(g, (RandomizerKind)kind, 42);
+    tetris_input(g, Start, false);
+    deal_pieces(g, a, PIECES);
+    // новая партия с тем же seed - та же раздача
+    tetris_input(g, Start, false);
+    deal_pieces(g, b, PIECES);
+    ck_assert_mem_eq(a, b, PIECES);
+    tetris_set_randomizer(g, (RandomizerKind)kind, 43);
+    tetris_input(g, Start, false);
+    deal_pieces(g, b, PIECES);
+    ck_assert(memcmp(a, b, PIECES) != 0);
+    int seen = 0, bags = 0;
+    for (int i = 0; i < PIECES; i += P_COUNT) {
+      int mask = 0;
+      for (int k = 0; k < P_COUNT; ++k) mask |= 1 << a[i + k];
+      seen |= mask;
+      bags += mask == (1 << P_COUNT) - 1;
+    }
+    ck_assert_int_eq(seen, (1 << P_COUNT) - 1);
+    if (kind == RANDOMIZER_BAG7)
+      ck_assert_int_eq(bags, PIECES / P_COUNT);
+    else
+      ck_assert_int_lt(bags, PIECES / P_COUNT);
+  }
+
+  // очередь читается без побочных эффектов и сдвигается на спавне
+  TetrominoId queue[TETRIS_QUEUE_PREVIEW], again[TETRIS_QUEUE_PREVIEW];
+  uint64_t hash = engine_hash(&g->engine);
+  ck_assert_int_eq(tetris_peek_queue(g, queue, 100), TETRIS_QUEUE_PREVIEW);
+  ck_assert_int_eq(tetris_peek_queue(g, again, TETRIS_QUEUE_PREVIEW),
+                   TETRIS_QUEUE_PREVIEW);
+  ck_assert_mem_eq(queue, again, sizeof(queue));
+  ck_assert_uint_eq(engine_hash(&g->engine), hash);
+  ck_assert_int_eq(queue[0], g->engine.next_tetromino_id);
+  for (int i = 0; i < 20; ++i) {
+    deal_pieces(g, a, 1);
+    ck_assert_int_eq(g->engine.cur_tetromino_id, queue[0]);
+    tetris_peek_queue(g, again, TETRIS_QUEUE_PREVIEW);
+    ck_assert_mem_eq(again, queue + 1,
+                     (TETRIS_QUEUE_PREVIEW - 1) * sizeof(queue[0]));
+    memcpy(queue, again, sizeof(queue));
+  }
+
+  // снимок уносит генератор: после отката те же фигуры
+  TetrisSnapshot snap;
+  tetris_save(g, &snap);
+  deal_pieces(g, a, 50);
+  tetris_restore(g, &snap);
+  deal_pieces(g, b, 50);
+  ck_assert_mem_eq(a, b, 50);
+  tetris_destroy(g);
+
+  // запись партии повторяет раздачу, в том числе с ключевого кадра
+  g = tetris_create();
+  ReplayRecorder rec;
+  ck_assert_int_eq(replay_recorder_init(&rec, 200), 0);
+  tetris_set_recorder(g, &rec);
+  tetris_set_randomizer(g, RANDOMIZER_BAG7, 7);
+  tetris_input(g, Start, false);
+  enum { TICKS = 3000, EVERY = 250 };
+  TetrisSnapshot expected[TICKS / EVERY];
+  for (int t = 0; t < TICKS; ++t) {
+    if (t % 3 == 0) tetris_input(g, t % 2 ? Left : Down, false);
+    if (g->state == GAME_OVER) tetris_input(g, Start, false);
+    if (t % EVERY == 0) tetris_save(g, &expected[t / EVERY]);
+    tetris_step(g);
+  }
+  tetris_set_recorder(g, NULL);
+  ck_assert_int_eq(replay_finish(&rec, g), 0);
+  ReplayPlayer player;
+  ck_assert_int_eq(replay_player_open(&player, rec.data, rec.len), 0);
+  TetrisGame* view = tetris_create();
+  ck_assert_int_eq(replay_verify(&player, view), 0);
+  ck_assert_int_eq(view->engine.pieces, g->engine.pieces);
+  for (int k = 0; k < TICKS / EVERY; ++k) {
+    ck_assert_int_eq(replay_seek(&player, view, (uint32_t)(k * EVERY)), 0);
+    ck_assert(engine_hash(&view->engine) == engine_hash(&expected[k].engine));
+    ck_assert_int_eq(view->engine.pieces, expected[k].engine.pieces);
+    deal_pieces(view, a, 20);
+    tetris_restore(g, &expected[k]);
+    deal_pieces(g, b, 20);
+    ck_assert_mem_eq(a, b, 20);
+  }
+  replay_player_close(&player);
+  replay_recorder_free(&rec);
+  tetris_destroy(view);
+  tetris_destroy(g);
+}
+END_TEST
+
+// две стороны до frames кадров со случайными нажатиями, за tail кадров до
+// конца - тишина. link - часы заместителя сети, NULL у настоящего сокета.
+// input[p][f] - кнопки, которые сторона p приняла на кадре f
+static void run_versus(NetplaySession* sides, NetLagLink* link,
+                       uint32_t frames, uint32_t tail, uint8_t (*input)[512]) {
+  uint64_t rng = 99;
+  int calls = 0;
+  while (sides[0].frame < frames || sides[1].frame < frames) {
+    for (int p = 0; p < 2; ++p) {
+      NetplaySession* s = &sides[p];
+      rng = rng * 6364136223846793005ull + 1442695040888963407ull;
+      int roll = (int)(rng >> 58);  // 0..63
+      uint8_t buttons = 0;
+      if (s->frame + tail < frames && roll < 24)
+        buttons = (uint8_t)(1 << (roll % 5) | NET_START);
+      uint32_t frame = s->frame;
+      int r = netplay_advance(s, buttons);
+      ck_assert_int_ge(r, 0);
+      if (r == 0 && frame < 512) input[p][frame] = buttons;
+    }
+    if (link) link->now_ms += TETRIS_TICK_MS;
+    ck_assert_int_lt(++calls, 20 * (int)frames);
+  }
+}
+
+// обе стороны совпадают с прогоном тех же нажатий без сети
+static void assert_versus_matches(const NetplaySession* sides,
+                                  const NetplayConfig* config,
+                                  uint8_t (*input)[512]) {
+  TetrisGame games[2];
+  for (int p = 0; p < 2; ++p) {
+    tetris_init(&games[p]);
+    tetris_set_randomizer(&games[p], config->randomizer, config->seed);
+    tetris_input(&games[p], Start, false);
+  }
+  uint32_t last = sides[0].frame > sides[1].frame ? sides[0].frame
+                                                  : sides[1].frame;
+  for (uint32_t f = 0; f <= last; ++f) {
+    for (int side = 0; side < 2; ++side) {
+      if (sides[side].frame != f) continue;
+      for (int p = 0; p < 2; ++p) {
+        const TetrisGame* g = netplay_game(&sides[side], p);
+        ck_assert(engine_hash(&g->engine) == engine_hash(&games[p].engine));
+        ck_assert_int_eq(g->engine.score, games[p].engine.score);
+        ck_assert_int_eq(g->engine.pieces, games[p].engine.pieces);
+        ck_assert_int_eq(g->state, games[p].state);
+      }
+    }
+    for (int p = 0; p < 2; ++p) {
+      uint32_t k = f - (uint32_t)config->delay;
+      uint8_t buttons = f >= (uint32_t)config->delay ? input[p][k] : 0;
+      if (buttons & NET_LEFT) tetris_input(&games[p], Left, false);
+      if (buttons & NET_RIGHT) tetris_input(&games[p], Right, false);
+      if (buttons & NET_ROTATE) tetris_input(&games[p], Action, false);
+      if (buttons & NET_SOFT_DROP) tetris_input(&games[p], Down, true);
+      if (buttons & NET_HARD_DROP) tetris_input(&games[p], Down, false);
+      if ((buttons & NET_START) && games[p].state == GAME_OVER)
+        tetris_input(&games[p], Start, false);
+      tetris_step(&games[p]);
+    }
+  }
+}
+
+START_TEST(test_netplay_rollback_converges) {
+  enum { FRAMES = 400, TAIL = 60 };
+  static uint8_t input[2][512];
+  NetplayConfig config = {.delay = 1,
+                          .max_rollback = 4,
+                          .randomizer = RANDOMIZER_BAG7,
+                          .seed = 5};
+  // заместитель сети: 200..300 мс и 5% потерь, дольше окна отката
+  NetLagLink link;
+  ck_assert_int_eq(net_lag_link_init(&link, 200, 100, 50, 1), 0);
+  NetplaySession sides[2];
+  for (int p = 0; p < 2; ++p) {
+    config.player = p;
+    ck_assert_int_eq(
+        netplay_init(&sides[p], &config, net_lag_link_end(&link, p)), 0);
+  }
+  memset(input, 0, sizeof(input));
+  run_versus(sides, &link, FRAMES, TAIL, input);
+  assert_versus_matches(sides, &config, input);
+  for (int p = 0; p < 2; ++p) {
+    const NetplayStats* st = &sides[p].stats;
+    ck_assert_uint_gt(st->rollbacks, 10);
+    ck_assert_int_le(st->max_depth, config.max_rollback);
+    ck_assert_uint_gt(st->stalls, 0);  // при такой задержке окно кончается
+    ck_assert_uint_ge(sides[p].frame, FRAMES);
+  }
+  ck_assert_uint_gt(link.dropped, 0);
+  for (int p = 0; p < 2; ++p) netplay_free(&sides[p]);
+  net_lag_link_free(&link);
+
+  // то же через настоящий UDP на loopback
+  NetUdp udp[2];
+  for (int p = 0; p < 2; ++p) ck_assert_int_eq(net_udp_open(&udp[p], 0), 0);
+  for (int p = 0; p < 2; ++p)
+    ck_assert_int_eq(
+        net_udp_connect(&udp[p], "127.0.0.1",
+                        (uint16_t)net_udp_port(&udp[1 - p])),
+        0);
+  config.max_rollback = 0;
+  for (int p = 0; p < 2; ++p) {
+    config.player = p;
+    ck_assert_int_eq(
+        netplay_init(&sides[p], &config, net_udp_transport(&udp[p])), 0);
+  }
+  memset(input, 0, sizeof(input));
+  run_versus(sides, NULL, FRAMES, TAIL, input);
+  assert_versus_matches(sides, &config, input);
+  for (int p = 0; p < 2; ++p) {
+    ck_assert_uint_gt(sides[p].stats.packets_received, 0);
+    netplay_free(&sides[p]);
+    net_udp_close(&udp[p]);
+  }
+}
+END_TEST
+
+START_TEST(test_sim_percentiles_stay_within_scores) {
+  SimStats stats;
+  sim_stats_init(&stats);
+  bool above = true;
+  ck_assert_int_eq(sim_stats_percentile(&stats, 50, &above), 0);
+  ck_assert(!above);
+  // все игры дальше последней корзины: раньше p50 был 51100 при min 87800
+  int top = (SIM_SCORE_BINS - 1) * SIM_SCORE_BIN;
+  for (int i = 0; i < 16; ++i) {
+    SimResult r = {.score = 87800, .lines = 1, .pieces = 1, .ticks = 1};
+    sim_stats_add(&stats, &r);
+  }
+  ck_assert_int_eq(sim_stats_percentile(&stats, 50, &above), 87800);
+  ck_assert(!above);
+  SimResult r = {.score = top + 5000, .lines = 1, .pieces = 1, .ticks = 1};
+  for (int i = 0; i < 16; ++i) sim_stats_add(&stats, &r);
+  for (int percent = 1; percent <= 100; ++percent) {
+    int score = sim_stats_percentile(&stats, percent, &above);
+    ck_assert_int_ge(score, stats.score_min);
+    ck_assert_int_le(score, stats.score_max);
+  }
+  ck_assert_int_eq(sim_stats_percentile(&stats, 50, &above), top + 5000);
+  ck_assert(above);  // в хвосте только оценка снизу
+  char line[512] = {0};
+  FILE* out = tmpfile();
+  ck_assert_ptr_nonnull(out);
+  sim_stats_print(&stats, 1.0, out);
+  rewind(out);
+  ck_assert_uint_gt(fread(line, 1, sizeof(line) - 1, out), 0);
+  fclose(out);
+  ck_assert_ptr_nonnull(strstr(line, "min 56100 p50 ≥56100"));
+  // внутри гистограммы - нижняя граница корзины, но не меньше min
+  sim_stats_init(&stats);
+  int scores[] = {150, 250, 350};
+  for (int i = 0; i < 3; ++i) {
+    r.score = scores[i];
+    sim_stats_add(&stats, &r);
+  }
+  ck_assert_int_eq(sim_stats_percentile(&stats, 1, &above), 150);
+  ck_assert_int_eq(sim_stats_percentile(&stats, 50, &above), 200);
+  ck_assert_int_eq(sim_stats_percentile(&stats, 100, &above), 300);
+  ck_assert(!above);
+}
+END_TEST
+
+typedef struct {
+  atomic_int hits[512];
+  long slow;  // индексы ниже - медленные, они все в очереди потока 0
+} PoolProbe;
+
+static void pool_probe(void* ctx, int worker, long index) {
+  PoolProbe* probe = ctx;
+  (void)worker;
+  atomic_fetch_add(&probe->hits[index], 1);
+  for (volatile long spin = index < probe->slow ? 300000 : 0; spin > 0;)
+    spin = spin - 1;
+}
+
+START_TEST(test_work_pool_runs_each_index_once_and_steals) {
+  static PoolProbe probe;
+  for (int threads = 1; threads <= 8; threads *= 2) {
+    for (int i = 0; i < 512; ++i) atomic_init(&probe.hits[i], 0);
+    probe.slow = 512 / threads;
+    WorkPoolStats stats = {-1, -1};
+    ck_assert_int_eq(work_pool_run(threads, 512, pool_probe, &probe, &stats),
+                     0);
+    for (int i = 0; i < 512; ++i)
+      ck_assert_int_eq(atomic_load(&probe.hits[i]), 1);
+    // пока поток 0 спит на своих индексах, остальные разбирают их кражей
+    if (threads > 1)
+      ck_assert_int_gt(stats.steals, 0);
+    else
+      ck_assert_int_eq(stats.steals, 0);
+    ck_assert_int_ge(stats.steal_attempts, stats.steals);
+  }
+  ck_assert_int_eq(work_pool_run(4, 0, pool_probe, &probe, NULL), 0);
+  ck_assert_int_eq(work_pool_run(4, -1, pool_probe, &probe, NULL), -1);
+}
+END_TEST
+
+typedef struct {
+  TetrisGame* games[4];
+  SimStats stats[4];
+} StatsProbe;
+
+static void stats_probe(void* ctx, int worker, long index) {
+  StatsProbe* probe = ctx;
+  SimConfig cfg = {.seed = sim_game_seed(7, index),
+                   .max_ticks = 3000,
+                   .randomizer = RANDOMIZER_BAG7};
+  SimResult result;
+  sim_play_game(probe->games[worker], &cfg, &result);
+  sim_stats_add(&probe->stats[worker], &result);
+}
+
+START_TEST(test_sim_stats_merge_matches_single_thread) {
+  enum { GAMES = 48 };
+  static StatsProbe probe;
+  SimStats merged[2];
+  for (int run = 0; run < 2; ++run) {
+    int threads = run ? 4 : 1;
+    for (int i = 0; i < threads; ++i) {
+      probe.games[i] = tetris_create();
+      ck_assert_ptr_nonnull(probe.games[i]);
+      sim_stats_init(&probe.stats[i]);
+    }
+    ck_assert_int_eq(
+        work_pool_run(threads, GAMES, stats_probe, &probe, NULL), 0);
+    sim_stats_init(&merged[run]);
+    for (int i = 0; i < threads; ++i) {
+      sim_stats_merge(&merged[run], &probe.stats[i]);
+      tetris_destroy(probe.games[i]);
+    }
+  }
+  // партия i получает свой seed, так что разбиение по потокам не видно
+  const SimStats* a = &merged[0];
+  const SimStats* b = &merged[1];
+  ck_assert_int_eq(b->games, GAMES);
+  ck_assert_int_eq(a->games, b->games);
+  ck_assert_int_eq(a->ticks, b->ticks);
+  ck_assert_int_eq(a->pieces, b->pieces);
+  ck_assert_int_eq(a->lines, b->lines);
+  ck_assert_int_eq(a->score_sum, b->score_sum);
+  ck_assert_int_eq(a->score_min, b->score_min);
+  ck_assert_int_eq(a->score_max, b->score_max);
+  ck_assert_mem_eq(a->score_hist, b->score_hist, sizeof(a->score_hist));
+  long binned = 0;
+  for (int i = 0; i < SIM_SCORE_BINS; ++i) binned += b->score_hist[i];
+  ck_assert_int_eq(binned, GAMES);
+  // пустая статистика потока ничего не портит
+  SimStats empty;
+  sim_stats_init(&empty);
+  sim_stats_merge(&merged[1], &empty);
+  ck_assert_int_eq(merged[1].score_min, a->score_min);
+}
+END_TEST
+
 static Suite* create_tetris_suite(void) {
   Suite* s = suite_create("brick_game_tetris");
   TCase* tc_core = tcase_create("core");
@@ -171,6 +1511,36 @@ static Suite* create_tetris_suite(void) {
   tcase_add_test(tc_core, test_up_action_has_no_effect);
   tcase_add_test(tc_core, test_pause_toggle);
   tcase_add_test(tc_core, test_terminate_sets_game_over);
+  tcase_add_test(tc_core, test_hard_drop_keeps_piece_color);
+  tcase_add_test(tc_core, test_full_row_is_cleared_and_scored);
+  tcase_add_test(tc_core, test_split_rows_are_compacted_in_one_pass);
+  tcase_add_test(tc_core, test_instances_are_independent);
+  tcase_add_test(tc_core, test_instances_run_in_parallel_threads);
+  tcase_add_test(tc_core, test_snapshot_restores_full_game);
+  tcase_add_test(tc_core, test_snapshot_is_compact_and_pointer_free);
+  tcase_add_test(tc_core, test_movegen_counts_distinct_placements);
+  tcase_add_test(tc_core, test_movegen_perft_uses_preview);
+  tcase_add_test(tc_core, test_eval_simd_paths_match_scalar);
+  tcase_add_test(tc_core, test_bot_clears_lines);
+  tcase_add_test(tc_core, test_planner_is_thread_count_independent);
+  tcase_add_test(tc_core, test_planner_drives_bot);
+  tcase_add_test(tc_core, test_zobrist_hash_is_incremental);
+  tcase_add_test(tc_core, test_ttable_buckets_and_replacement);
+  tcase_add_test(tc_core, test_score_writer_coalesces_and_flushes);
+  tcase_add_test(tc_core, test_leaderboard_keeps_top_across_processes);
+  tcase_add_test(tc_core, test_game_clock_fixed_steps);
+  tcase_add_test(tc_core, test_input_queue_and_auto_repeat);
+  tcase_add_test(tc_core, test_engine_events_follow_fsm_actions);
+  tcase_add_test(tc_core, test_query_frame_rebuilds_only_dirty_rows);
+  tcase_add_test(tc_core, test_replay_is_compact_and_seeks_exactly);
+  tcase_add_test(tc_core, test_vec_env_matches_single_games);
+  tcase_add_test(tc_core, test_batch_engine_matches_scalar_engine);
+  tcase_add_test(tc_core, test_field_features_follow_locks_and_clears);
+  tcase_add_test(tc_core, test_randomizers_are_seeded_and_queue_peeks);
+  tcase_add_test(tc_core, test_netplay_rollback_converges);
+  tcase_add_test(tc_core, test_sim_percentiles_stay_within_scores);
+  tcase_add_test(tc_core, test_work_pool_runs_each_index_once_and_steals);
+  tcase_add_test(tc_core, test_sim_stats_merge_matches_single_thread);
 
   suite_add_tcase(s, tc_core);
   return s;
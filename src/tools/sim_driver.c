@@ -0,0 +1,222 @@
+#define _POSIX_C_SOURCE 200809L
+#include "sim_driver.h"
+
+#include <string.h>
+#include <time.h>
+
+#include "brick_game/tetris/game_logic.h"
+
+double sim_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+uint64_t sim_rng_next(uint64_t* state) {  // xorshift64*
+  uint64_t x = *state;
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  *state = x;
+  return x * 0x2545F4914F6CDD1Dull;
+}
+
+uint64_t sim_game_seed(uint64_t base, long index) {  // splitmix64
+  uint64_t z = base + 0x9E3779B97F4A7C15ull * (uint64_t)(index + 1);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  z ^= z >> 31;
+  return z ? z : 1;
+}
+
+static signed char action_from_char(char ch) {
+  signed char action = SIM_NO_ACTION;
+  switch (ch) {
+    case 'L':
+    case 'l':
+      action = Left;
+      break;
+    case 'R':
+    case 'r':
+      action = Right;
+      break;
+    case 'A':
+    case 'a':
+      action = Action;
+      break;
+    case 'D':
+    case 'd':
+      action = Down;
+      break;
+    case 'P':
+    case 'p':
+      action = Pause;
+      break;
+    default:
+      break;
+  }
+  return action;
+}
+
+// один символ скрипта - один кадр: действие (или '.') и затем тик
+size_t sim_parse_script(const char* text, signed char* actions) {
+  size_t count = 0;
+  for (const char* p = text; *p; ++p) {
+    signed char action = action_from_char(*p);
+    if (action != SIM_NO_ACTION || *p == '.') actions[count++] = action;
+  }
+  return count;
+}
+
+static const char* const randomizer_names[RANDOMIZER_KINDS] = {
+    "cycle", "bag7", "memoryless"};
+
+const char* sim_randomizer_name(RandomizerKind kind) {
+  return kind < RANDOMIZER_KINDS ? randomizer_names[kind] : "?";
+}
+
+int sim_parse_randomizer(const char* name, RandomizerKind* kind) {
+  for (int i = 0; i < RANDOMIZER_KINDS; ++i)
+    if (!strcmp(name, randomizer_names[i])) {
+      *kind = (RandomizerKind)i;
+      return 0;
+    }
+  return -1;
+}
+
+static int random_action(uint64_t* rng) {
+  int roll = (int)(sim_rng_next(rng) >> 60);  // 0..15
+  int action = SIM_NO_ACTION;
+  if (roll < 4)
+    action = Left;
+  else if (roll < 8)
+    action = Right;
+  else if (roll < 10)
+    action = Action;
+  else if (roll == 10)
+    action = Down;
+  return action;
+}
+
+void sim_play_game(TetrisGame* game, const SimConfig* cfg, SimResult* out) {
+  uint64_t rng = cfg->seed ? cfg->seed : 1;
+  size_t pos = 0;
+  long ticks = 0;
+  tetris_set_randomizer(game, cfg->randomizer, cfg->seed);
+  tetris_input(game, Start, false);
+  tetris_set_bot(game, cfg->bot);
+  while (game->state != GAME_OVER && ticks < cfg->max_ticks) {
+    int action;
+    if (cfg->bot) {
+      action = SIM_NO_ACTION;
+    } else if (cfg->script) {
+      action = cfg->script_len ? cfg->script[pos] : SIM_NO_ACTION;
+      if (++pos >= cfg->script_len) pos = 0;
+    } else {
+      action = random_action(&rng);
+    }
+    if (action != SIM_NO_ACTION)
+      tetris_input(game, (UserAction_t)action, false);
+    tetris_step(game);
+    ticks++;
+  }
+  tetris_set_bot(game, NULL);
+  out->score = game->engine.score;
+  out->lines = game->engine.lines;
+  out->pieces = game->engine.pieces;
+  out->ticks = ticks;
+}
+
+void sim_stats_init(SimStats* stats) {
+  memset(stats, 0, sizeof(*stats));
+  stats->score_min = -1;
+}
+
+void sim_stats_add(SimStats* stats, const SimResult* result) {
+  stats->games++;
+  stats->ticks += result->ticks;
+  stats->pieces += result->pieces;
+  stats->lines += result->lines;
+  stats->score_sum += result->score;
+  if (stats->score_min < 0 || result->score < stats->score_min)
+    stats->score_min = result->score;
+  if (result->score > stats->score_max) stats->score_max = result->score;
+  int bin = result->score / SIM_SCORE_BIN;
+  if (bin >= SIM_SCORE_BINS) bin = SIM_SCORE_BINS - 1;
+  stats->score_hist[bin]++;
+}
+
+void sim_stats_merge(SimStats* dst, const SimStats* src) {
+  if (!src->games) return;
+  dst->games += src->games;
+  dst->ticks += src->ticks;
+  dst->pieces += src->pieces;
+  dst->lines += src->lines;
+  dst->score_sum += src->score_sum;
+  if (dst->score_min < 0 || src->score_min < dst->score_min)
+    dst->score_min = src->score_min;
+  if (src->score_max > dst->score_max) dst->score_max = src->score_max;
+  for (int i = 0; i < SIM_SCORE_BINS; ++i)
+    dst->score_hist[i] += src->score_hist[i];
+}
+
+int sim_stats_percentile(const SimStats* stats, int percent, bool* above) {
+  long target = (stats->games * percent + 99) / 100;
+  long seen = 0;
+  int bin = 0;
+  for (; bin < SIM_SCORE_BINS - 1; ++bin) {
+    seen += stats->score_hist[bin];
+    if (seen >= target) break;
+  }
+  // от корзины известна только нижняя граница, а min и max точные
+  int score = bin * SIM_SCORE_BIN;
+  if (score < stats->score_min) score = stats->score_min;
+  if (score > stats->score_max) score = stats->score_max;
+  if (above) *above = bin == SIM_SCORE_BINS - 1 && score < stats->score_max;
+  return score;
+}
+
+static const char* format_percentile(const SimStats* stats, int percent,
+                                     char* buffer, size_t size) {
+  bool above = false;
+  int score = sim_stats_percentile(stats, percent, &above);
+  snprintf(buffer, size, "%s%d", above ? "≥" : "", score);
+  return buffer;
+}
+
+void sim_stats_print(const SimStats* stats, double seconds, FILE* out) {
+  if (seconds <= 0) seconds = 1e-9;
+  double games = stats->games ? (double)stats->games : 1.0;
+  fprintf(out, "games      : %ld (%.0f games/s)\n", stats->games,
+          (double)stats->games / seconds);
+  fprintf(out, "ticks      : %lld (%.0f ticks/s)\n", stats->ticks,
+          (double)stats->ticks / seconds);
+  fprintf(out, "pieces     : %lld (%.0f pieces/s)\n", stats->pieces,
+          (double)stats->pieces / seconds);
+  fprintf(out, "lines      : %lld\n", stats->lines);
+  fprintf(out, "time       : %.3f s\n", seconds);
+  fprintf(out, "game length: %.1f ticks, %.1f pieces (mean)\n",
+          (double)stats->ticks / games, (double)stats->pieces / games);
+  char p50[16], p90[16], p99[16];
+  fprintf(out, "score      : mean %.1f min %d p50 %s p90 %s p99 %s max %d\n",
+          (double)stats->score_sum / games,
+          stats->score_min < 0 ? 0 : stats->score_min,
+          format_percentile(stats, 50, p50, sizeof(p50)),
+          format_percentile(stats, 90, p90, sizeof(p90)),
+          format_percentile(stats, 99, p99, sizeof(p99)), stats->score_max);
+}
+
+void sim_stats_print_histogram(const SimStats* stats, FILE* out) {
+  long peak = 1;
+  for (int i = 0; i < SIM_SCORE_BINS; ++i)
+    if (stats->score_hist[i] > peak) peak = stats->score_hist[i];
+  fprintf(out, "score distribution:\n");
+  for (int i = 0; i < SIM_SCORE_BINS; ++i) {
+    if (!stats->score_hist[i]) continue;
+    int bar = (int)(40 * stats->score_hist[i] / peak);
+    fprintf(out, "  %6d%s %9ld ", i * SIM_SCORE_BIN,
+            i == SIM_SCORE_BINS - 1 ? "+" : " ", stats->score_hist[i]);
+    for (int b = 0; b < bar; ++b) fputc('#', out);
+    fputc('\n', out);
+  }
+}
@@ -0,0 +1,60 @@
+#ifndef SIM_DRIVER_H_
+#define SIM_DRIVER_H_
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "brick_game/tetris/bot.h"
+
+#define SIM_NO_ACTION (-1)
+#define SIM_SCORE_BIN 100
+#define SIM_SCORE_BINS 512
+
+typedef struct {
+  const signed char* script;  // NULL - генерировать ввод из seed
+  size_t script_len;
+  uint64_t seed;
+  long max_ticks;
+  TetrisBot* bot;  // не NULL - вместо ввода играет автоигрок
+  RandomizerKind randomizer;  // фигуры партии раздаются из того же seed
+} SimConfig;
+
+typedef struct {
+  int score;
+  int lines;
+  int pieces;
+  long ticks;
+} SimResult;
+
+typedef struct {
+  long games;
+  long long ticks;
+  long long pieces;
+  long long lines;
+  long long score_sum;
+  int score_min;
+  int score_max;
+  long score_hist[SIM_SCORE_BINS];  // шаг SIM_SCORE_BIN, последний - хвост
+} SimStats;
+
+double sim_now(void);
+uint64_t sim_rng_next(uint64_t* state);
+uint64_t sim_game_seed(uint64_t base, long index);
+size_t sim_parse_script(const char* text, signed char* actions);
+// имена генераторов для -g: cycle, bag7, memoryless. 0 - разобрано
+const char* sim_randomizer_name(RandomizerKind kind);
+int sim_parse_randomizer(const char* name, RandomizerKind* kind);
+
+void sim_play_game(TetrisGame* game, const SimConfig* cfg, SimResult* out);
+
+void sim_stats_init(SimStats* stats);
+void sim_stats_add(SimStats* stats, const SimResult* result);
+void sim_stats_merge(SimStats* dst, const SimStats* src);
+// перцентиль по гистограмме: нижняя граница корзины, зажатая в
+// [score_min, score_max]. *above - попал в хвост, значение - оценка снизу
+int sim_stats_percentile(const SimStats* stats, int percent, bool* above);
+void sim_stats_print(const SimStats* stats, double seconds, FILE* out);
+void sim_stats_print_histogram(const SimStats* stats, FILE* out);
+
+#endif
@@ -0,0 +1,168 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "sim_driver.h"
+#include "work_pool.h"
+
+// у каждого потока своя игра и своя статистика в отдельной кэш-линии,
+// сливаются они только после join
+typedef struct {
+  _Alignas(64) TetrisGame* game;
+  TetrisBot* bot;
+  SimStats stats;
+} BatchWorker;
+
+typedef struct {
+  BatchWorker* workers;
+  uint64_t seed;
+  long max_ticks;
+} BatchJob;
+
+static int use_bot = 0;
+static RandomizerKind randomizer = RANDOMIZER_BAG7;
+
+static void usage(const char* prog) {
+  fprintf(stderr,
+          "usage: %s [-n games] [-j threads] [-s seed] [-t max_ticks] "
+          "[-g randomizer] [-b] [-S] [-q]\n"
+          "  -j 0 - по числу ядер, -S - отчёт о масштабировании 1..j "
+          "потоков\n"
+          "  -g cycle|bag7|memoryless - генератор фигур, по умолчанию bag7\n",
+          prog);
+}
+
+static void play_one(void* ctx, int worker, long index) {
+  BatchJob* job = ctx;
+  BatchWorker* w = &job->workers[worker];
+  SimConfig cfg = {.script = NULL,
+                   .script_len = 0,
+                   .seed = sim_game_seed(job->seed, index),
+                   .max_ticks = job->max_ticks,
+                   .bot = w->bot,
+                   .randomizer = randomizer};
+  SimResult result;
+  sim_play_game(w->game, &cfg, &result);
+  sim_stats_add(&w->stats, &result);
+}
+
+static int run_batch(int threads, long games, uint64_t seed, long max_ticks,
+                     SimStats* total, WorkPoolStats* pool_stats,
+                     double* seconds) {
+  BatchWorker* workers =
+      aligned_alloc(64, sizeof(BatchWorker) * (size_t)threads);
+  if (!workers) return -1;
+  int status = 0;
+  for (int i = 0; i < threads; ++i) {
+    workers[i].game = tetris_create();
+    workers[i].bot = use_bot ? bot_create() : NULL;
+    if (!workers[i].game || (use_bot && !workers[i].bot))
+      status = -1;
+    else
+    sim_stats_init(&workers[i].stats);
+  }
+  if (!status) {
+    BatchJob job = {workers, seed, max_ticks};
+    double started = sim_now();
+    status = work_pool_run(threads, games, play_one, &job, pool_stats);
+    *seconds = sim_now() - started;
+    sim_stats_init(total);
+    for (int i = 0; i < threads; ++i) sim_stats_merge(total, &workers[i].stats);
+  }
+  for (int i = 0; i < threads; ++i) {
+    tetris_destroy(workers[i].game);
+    bot_destroy(workers[i].bot);
+  }
+  free(workers);
+  return status;
+}
+
+static void scaling_report(int max_threads, long games, uint64_t seed,
+                           long max_ticks) {
+  printf("%8s %10s %12s %14s %8s %8s %8s\n", "threads", "time,s", "games/s",
+         "pieces/s", "speedup", "effic.", "steals");
+  double base = 0;
+  long long checksum = -1;
+  for (int threads = 1;; threads *= 2) {
+    if (threads > max_threads) threads = max_threads;
+    SimStats stats;
+    WorkPoolStats pool_stats;
+    double seconds = 0;
+    if (run_batch(threads, games, seed, max_ticks, &stats, &pool_stats,
+                  &seconds))
+      break;
+    if (threads == 1) base = seconds;
+    double speedup = seconds > 0 ? base / seconds : 0;
+    printf("%8d %10.3f %12.0f %14.0f %8.2f %7.0f%% %8ld\n", threads, seconds,
+           (double)stats.games / seconds, (double)stats.pieces / seconds,
+           speedup, 100.0 * speedup / threads, pool_stats.steals);
+    // при любом числе потоков игры и итог обязаны совпасть
+    if (checksum >= 0 && checksum != stats.score_sum + stats.ticks)
+      printf("         WARNING: results differ from the 1-thread run\n");
+    checksum = stats.score_sum + stats.ticks;
+    if (threads == max_threads) break;
+  }
+}
+
+int main(int argc, char** argv) {
+  long games = 100000;
+  int threads = 0;
+  uint64_t seed = 1;
+  long max_ticks = 100000;
+  int scaling = 0, quiet = 0;
+  int opt;
+  while ((opt = getopt(argc, argv, "n:j:s:t:g:bSqh")) != -1) {
+    switch (opt) {
+      case 'n':
+        games = atol(optarg);
+        break;
+      case 'j':
+        threads = atoi(optarg);
+        break;
+      case 's':
+        seed = strtoull(optarg, NULL, 10);
+        break;
+      case 't':
+        max_ticks = atol(optarg);
+        break;
+      case 'g':
+        if (sim_parse_randomizer(optarg, &randomizer)) {
+          usage(argv[0]);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'b':
+        use_bot = 1;
+        break;
+      case 'S':
+        scaling = 1;
+        break;
+      case 'q':
+        quiet = 1;
+        break;
+      default:
+        usage(argv[0]);
+        return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+  if (threads <= 0) threads = work_pool_cpu_count();
+
+  if (scaling) {
+    scaling_report(threads, games, seed, max_ticks);
+    return EXIT_SUCCESS;
+  }
+
+  SimStats stats;
+  WorkPoolStats pool_stats;
+  double seconds = 0;
+  if (run_batch(threads, games, seed, max_ticks, &stats, &pool_stats,
+                &seconds)) {
+    fprintf(stderr, "batch failed\n");
+    return EXIT_FAILURE;
+  }
+  printf("threads    : %d (%ld steals)\n", threads, pool_stats.steals);
+  sim_stats_print(&stats, seconds, stdout);
+  if (!quiet) sim_stats_print_histogram(&stats, stdout);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,597 @@
+#define _POSIX_C_SOURCE 200809L
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "brick_game/tetris/batch_engine.h"
+#include "brick_game/tetris/bot.h"
+#include "brick_game/tetris/game_logic.h"
+#include "brick_game/tetris/netplay.h"
+#include "brick_game/tetris/replay.h"
+#include "brick_game/tetris/vec_env.h"
+#include "gui/cli/frontend.h"
+#include "sim_driver.h"
+
+// микробенчмарки движка: ./tetris_bench [-n iterations] [name ...]
+typedef struct {
+  const char* name;
+  const char* about;
+  long default_iterations;
+  void (*run)(long iterations);
+} Bench;
+
+static TetrisGame* bench_game(int drops) {
+  TetrisGame* g = tetris_create();
+  if (!g) exit(EXIT_FAILURE);
+  tetris_input(g, Start, false);
+  for (int i = 0; i < drops; ++i) {
+    for (int s = 0; s < i % 5; ++s)
+      tetris_input(g, i % 2 ? Left : Right, false);
+    tetris_input(g, Down, false);
+  }
+  return g;
+}
+
+static void bench_snapshot(long iterations) {
+  TetrisGame* g = bench_game(8);
+  TetrisSnapshot snaps[2];
+  tetris_save(g, &snaps[0]);
+  tetris_input(g, Down, false);
+  tetris_save(g, &snaps[1]);
+  double started = sim_now();
+  for (long i = 0; i < iterations; ++i) {
+    tetris_save(g, &snaps[i & 1]);
+    tetris_restore(g, &snaps[(i + 1) & 1]);
+  }
+  double seconds = sim_now() - started;
+  printf("snapshot: %ld save/restore pairs in %.3f s, %.1f M pairs/s, "
+         "%zu bytes per snapshot (score %d)\n",
+         iterations, seconds, (double)iterations / seconds * 1e-6,
+         sizeof(TetrisSnapshot), g->engine.score);
+  tetris_destroy(g);
+}
+
+// стек из 16 строк с колодцем в колонке 0; в нижних lines строках больше
+// дыр нет, так что вертикальная I в колодце снимает ровно lines строк.
+// Клетки пишутся прямо в поле, остальное пересобирается по нему
+static TetrisGame* clear_position(int lines) {
+  TetrisGame* g = bench_game(0);
+  EngineState* e = &g->engine;
+  for (int r = MASK_SIZE; r < FIELD_ROWS; ++r)
+    for (int c = 1; c < FIELD_COLS; ++c) {
+      if (r < FIELD_ROWS - lines && c == 1 + r % (FIELD_COLS - 1)) continue;
+      e->field[r][c] = (uint8_t)(1 + (r + c) % P_COUNT);
+    }
+  engine_rebuild_derived(e);
+  return g;
+}
+
+// признаки поля: полный пересчёт по клеткам против того, что движок ведёт
+// сам, на позиции после 8 фигур
+static void bench_features(long iterations) {
+  TetrisGame* g = bench_game(8);
+  FieldFeatures f;
+  long checksum = 0;
+  double started = sim_now();
+  for (long i = 0; i < iterations; ++i) {
+    engine_features_recompute(&g->engine, &f);
+    checksum += f.holes + f.wells;
+    __asm__ volatile("" : : "r"(&g->engine) : "memory");
+  }
+  double full = sim_now() - started;
+  started = sim_now();
+  for (long i = 0; i < iterations; ++i) {
+    const FieldFeatures* kept = tetris_features(g);
+    checksum += kept->holes + kept->wells;
+    __asm__ volatile("" : : "r"(&g->engine) : "memory");
+  }
+  double kept = sim_now() - started;
+  printf("features: recompute %.1f ns, kept by the engine %.1f ns per read "
+         "(%ld)\n",
+         full * 1e9 / (double)iterations, kept * 1e9 / (double)iterations,
+         checksum);
+  tetris_destroy(g);
+}
+
+static void bench_clear(long iterations) {
+  for (int lines = 0; lines <= 4; ++lines) {
+    TetrisGame* g = clear_position(lines);
+    TetrisSnapshot snap;
+    tetris_save(g, &snap);
+    double started = sim_now();
+    for (long i = 0; i < iterations; ++i) tetris_restore(g, &snap);
+    double restore = sim_now() - started;
+    started = sim_now();
+    for (long i = 0; i < iterations; ++i) {
+      tetris_restore(g, &snap);
+      tetris_lock_at(g, 1, FIELD_ROWS - MASK_SIZE, -1);  // I в колодец
+    }
+    double seconds = sim_now() - started;
+    printf("clear %d: %ld locks in %.3f s, %.1f ns per lock + clear "
+           "(restore %.1f ns excluded)\n",
+           g->engine.lines, iterations, seconds,
+           (seconds - restore) / (double)iterations * 1e9,
+           restore / (double)iterations * 1e9);
+    tetris_destroy(g);
+  }
+}
+
+// случайные доски с неровным верхом, одни и те же для всех путей
+static void fill_random_boards(EvalBoards* boards, uint64_t seed) {
+  boards->count = EVAL_MAX_BOARDS;
+  for (int i = 0; i < EVAL_MAX_BOARDS; ++i) {
+    int top = (int)(sim_rng_next(&seed) % FIELD_ROWS);
+    for (int r = 0; r < FIELD_ROWS; ++r)
+      boards->rows[r][i] =
+          r < top ? 0
+                  : (uint16_t)(sim_rng_next(&seed) & FULL_ROW_BITS &
+                               ~(1u << (sim_rng_next(&seed) % FIELD_COLS)));
+    boards->lines[i] = (uint8_t)(sim_rng_next(&seed) % 5);
+  }
+}
+
+static void bench_eval(long iterations) {
+  static EvalBoards boards;
+  static int32_t reference[EVAL_MAX_BOARDS], scores[EVAL_MAX_BOARDS];
+  fill_random_boards(&boards, 42);
+  eval_score_boards(&boards, &EVAL_DEFAULT_WEIGHTS, EVAL_SCALAR, reference);
+  for (EvalPath path = EVAL_SCALAR; path <= EVAL_AVX2; ++path) {
+    if (path > eval_best_path()) break;
+    double started = sim_now();
+    for (long i = 0; i < iterations; ++i)
+      eval_score_boards(&boards, &EVAL_DEFAULT_WEIGHTS, path, scores);
+    double seconds = sim_now() - started;
+    int same = memcmp(scores, reference, sizeof(scores)) == 0;
+    printf("eval %-6s: %ld x %d boards in %.3f s, %.1f M boards/s%s\n",
+           eval_path_name(path), iterations, EVAL_MAX_BOARDS, seconds,
+           (double)iterations * EVAL_MAX_BOARDS / seconds * 1e-6,
+           same ? "" : " MISMATCH");
+  }
+
+  // для сравнения: генерация ходов + сборка досок на реальной позиции
+  TetrisGame* g = bench_game(8);
+  static TetrisPlacement moves[MOVEGEN_MAX_PLACEMENTS];
+  long placements = 0;
+  long rounds = iterations / 8 + 1;
+  double started = sim_now();
+  for (long i = 0; i < rounds; ++i) {
+    int count = movegen_current(g, moves);
+    bot_build_boards(&g->engine, g->engine.cur_tetromino_id, moves,
+                     count, &boards);
+    placements += count;
+  }
+  double seconds = sim_now() - started;
+  printf("movegen+build: %ld placements in %.3f s, %.1f M placements/s\n",
+         placements, seconds, (double)placements / seconds * 1e-6);
+  tetris_destroy(g);
+}
+
+// tetris_step() + tetris_query(), как updateCurrentState() в игре: фигура
+// сдвигается раз в 8 вызовов и падает по гравитации, в остальных кадр не
+// меняется
+static void bench_query(long iterations) {
+  TetrisGame* g = bench_game(8);
+  long checksum = 0;
+  double started = sim_now();
+  for (long i = 0; i < iterations; ++i) {
+    if ((i & 7) == 0) tetris_input(g, i & 8 ? Left : Right, false);
+    tetris_step(g);
+    GameInfo_t info = tetris_query(g);
+    checksum += info.field[FIELD_ROWS - 1][i % FIELD_COLS];
+    if (info.pause == 2) tetris_input(g, Start, false);
+  }
+  double seconds = sim_now() - started;
+  printf("query: %ld step+query in %.3f s, %.1f ns per call (%ld)\n",
+         iterations, seconds, seconds * 1e9 / (double)iterations, checksum);
+  tetris_destroy(g);
+}
+
+// корпус записей партий со случайным вводом sim_driver: запись, размер,
+// проигрывание всего корпуса с проверкой счёта и перемотка
+static void bench_replay(long games) {
+  ReplayRecorder* recs = calloc((size_t)games, sizeof(*recs));
+  if (!recs) exit(EXIT_FAILURE);
+  TetrisGame* g = tetris_create();
+  SimConfig cfg = {.max_ticks = 100000};
+  long long bytes = 0, inputs = 0, ticks = 0;
+  double started = sim_now();
+  for (long i = 0; i < games; ++i) {
+    SimResult result;
+    replay_recorder_init(&recs[i], 0);
+    cfg.seed = sim_game_seed(7, i);
+    tetris_set_recorder(g, &recs[i]);
+    sim_play_game(g, &cfg, &result);
+    tetris_set_recorder(g, NULL);
+    replay_finish(&recs[i], g);
+    bytes += (long long)recs[i].len;
+    inputs += recs[i].inputs;
+    ticks += recs[i].ticks;
+  }
+  double recorded = sim_now() - started;
+
+  long mismatches = 0;
+  started = sim_now();
+  for (long i = 0; i < games; ++i) {
+    ReplayPlayer player;
+    if (replay_player_open(&player, recs[i].data, recs[i].len) != 0 ||
+        replay_verify(&player, g) != 0)
+      mismatches++;
+    replay_player_close(&player);
+  }
+  double played = sim_now() - started;
+
+  // перемотка в случайный тик каждой партии
+  uint64_t rng = 1;
+  started = sim_now();
+  for (long i = 0; i < games; ++i) {
+    ReplayPlayer player;
+    if (replay_player_open(&player, recs[i].data, recs[i].len) == 0)
+      replay_seek(&player, g,
+                  (uint32_t)(sim_rng_next(&rng) % (recs[i].ticks + 1)));
+    replay_player_close(&player);
+  }
+  double seeking = sim_now() - started;
+
+  printf("replay: %ld games, %lld ticks, %lld inputs, %lld bytes "
+         "(%.2f bytes/input, %.3f bytes/tick)\n",
+         games, ticks, inputs, bytes, (double)bytes / (double)inputs,
+         (double)bytes / (double)ticks);
+  printf("replay: record %.3f s, verify %.3f s (%.0f games/s, %.1f M "
+         "ticks/s, %.1f MB/s), %ld mismatches\n",
+         recorded, played, (double)games / played,
+         (double)ticks / played * 1e-6, (double)bytes / played * 1e-6,
+         mismatches);
+  printf("replay: seek to a random tick %.1f us on average\n",
+         seeking * 1e6 / (double)games);
+  for (long i = 0; i < games; ++i) replay_recorder_free(&recs[i]);
+  free(recs);
+  tetris_destroy(g);
+}
+
+// пакетный шаг для обучения: VEC_ENVS сред со случайными действиями из
+// заранее заготовленной таблицы, чтобы не мерить генератор
+#define VEC_ENVS 1024
+#define VEC_TABLES 64
+
+static void bench_vec(long steps) {
+  TetrisVecObs obs;
+  size_t size = tetris_vec_obs_size(VEC_ENVS);
+  void* buffer = aligned_alloc(64, size);
+  uint8_t* actions = malloc((size_t)VEC_TABLES * VEC_ENVS);
+  if (!buffer || !actions) exit(EXIT_FAILURE);
+  tetris_vec_obs_bind(&obs, buffer, VEC_ENVS);
+  TetrisVecEnv* env = tetris_vec_create(&obs, true);
+  if (!env) exit(EXIT_FAILURE);
+  uint64_t rng = 3;
+  for (size_t i = 0; i < (size_t)VEC_TABLES * VEC_ENVS; ++i)
+    actions[i] = (uint8_t)(sim_rng_next(&rng) % TETRIS_VEC_ACTIONS);
+  long long done = 0, reward = 0;
+  double started = sim_now();
+  for (long s = 0; s < steps; ++s) {
+    tetris_vec_step(env, actions + (size_t)(s % VEC_TABLES) * VEC_ENVS);
+    for (uint32_t i = 0; i < VEC_ENVS; ++i) {
+      done += obs.done[i];
+      reward += obs.score_delta[i];
+    }
+  }
+  double seconds = sim_now() - started;
+  double env_steps = (double)steps * VEC_ENVS;
+  printf("vec: %d envs x %ld steps in %.3f s, %.2f M env-steps/s on one "
+         "thread (%lld games ended, %lld points)\n",
+         VEC_ENVS, steps, seconds, env_steps / seconds * 1e-6, done,
+         reward);
+  tetris_vec_destroy(env);
+  free(actions);
+  free(buffer);
+}
+
+// пакетный движок на тех же заготовленных действиях, что vec, по каждому
+// пути до лучшего доступного
+static void bench_batch(long steps) {
+  uint8_t* actions = malloc((size_t)VEC_TABLES * VEC_ENVS);
+  if (!actions) exit(EXIT_FAILURE);
+  uint64_t rng = 3;
+  for (size_t i = 0; i < (size_t)VEC_TABLES * VEC_ENVS; ++i)
+    actions[i] = (uint8_t)(sim_rng_next(&rng) % TETRIS_VEC_ACTIONS);
+  for (EvalPath path = EVAL_SCALAR; path <= eval_best_path(); ++path) {
+    BatchEngine batch;
+    if (batch_engine_init(&batch, VEC_ENVS, path) != 0) exit(EXIT_FAILURE);
+    long long ended = 0, points = 0;
+    double started = sim_now();
+    for (long s = 0; s < steps; ++s) {
+      batch_engine_step(&batch, actions + (size_t)(s % VEC_TABLES) * VEC_ENVS);
+      for (uint32_t i = 0; i < VEC_ENVS; ++i) {
+        if (batch.state[i] != GAME_OVER) continue;
+        ended++;
+        points += batch.score[i];
+        batch_engine_reset(&batch, i);
+      }
+    }
+    double seconds = sim_now() - started;
+    printf("batch %-6s: %d games x %ld steps in %.3f s, %.2f M "
+           "game-steps/s (%lld games ended, %lld points)\n",
+           eval_path_name(path), VEC_ENVS, steps, seconds,
+           (double)steps * VEC_ENVS / seconds * 1e-6, ended, points);
+    batch_engine_free(&batch);
+  }
+  free(actions);
+}
+
+// цена фигуры у каждого генератора: пачкой, как доливает очередь движок,
+// и по одной
+static void bench_randomizer(long pieces) {
+  enum { BATCH = TETRIS_QUEUE_SIZE - TETRIS_QUEUE_PREVIEW };
+  for (int kind = 0; kind < RANDOMIZER_KINDS; ++kind) {
+    Randomizer r;
+    uint8_t out[BATCH];
+    long checksum = 0;
+    randomizer_seed(&r, (RandomizerKind)kind, 1);
+    double started = sim_now();
+    for (long i = 0; i < pieces; i += BATCH) {
+      randomizer_fill(&r, out, BATCH);
+      for (int k = 0; k < BATCH; ++k) checksum += out[k];
+    }
+    double batched = sim_now() - started;
+    randomizer_seed(&r, (RandomizerKind)kind, 1);
+    started = sim_now();
+    for (long i = 0; i < pieces; ++i) {
+      randomizer_fill(&r, out, 1);
+      checksum += out[0];
+    }
+    double single = sim_now() - started;
+    printf("randomizer %-10s %.2f ns per piece in batches of %d, %.2f ns "
+           "one by one (%ld)\n",
+           sim_randomizer_name((RandomizerKind)kind),
+           batched * 1e9 / (double)pieces, BATCH,
+           single * 1e9 / (double)pieces, checksum);
+  }
+}
+
+// матч двух сторон через заместителя сети со случайными нажатиями: каждая
+// сторона ведёт обе игры и откатывается, когда ввод соперника опоздал
+static void bench_netplay(long frames) {
+  static const struct {
+    int latency_ms, jitter_ms, loss_permille;
+  } links[] = {{60, 30, 0}, {150, 100, 20}, {800, 400, 50}};
+  for (size_t l = 0; l < sizeof(links) / sizeof(links[0]); ++l) {
+    NetLagLink link;
+    if (net_lag_link_init(&link, links[l].latency_ms, links[l].jitter_ms,
+                          links[l].loss_permille, 11) != 0)
+      exit(EXIT_FAILURE);
+    NetplaySession sides[2];
+    NetplayConfig config = {.delay = 1, .randomizer = RANDOMIZER_BAG7};
+    for (int p = 0; p < 2; ++p) {
+      config.player = p;
+      if (netplay_init(&sides[p], &config, net_lag_link_end(&link, p)) != 0)
+        exit(EXIT_FAILURE);
+    }
+    uint64_t rng = 5;
+    double started = sim_now();
+    while (sides[0].frame < (uint32_t)frames) {
+      for (int p = 0; p < 2; ++p) {
+        uint64_t roll = sim_rng_next(&rng) % 16;
+        uint8_t buttons = roll < 5 ? (uint8_t)(1u << roll | NET_START) : 0;
+        if (netplay_advance(&sides[p], buttons) < 0) exit(EXIT_FAILURE);
+      }
+      link.now_ms += TETRIS_TICK_MS;
+    }
+    double seconds = sim_now() - started;
+    NetplayStats st = sides[0].stats;
+    double rollbacks = st.rollbacks ? (double)st.rollbacks : 1.0;
+    printf("netplay %3d+%3d ms, %d%% loss: %.1f rollbacks per 100 frames, "
+           "depth max %d, %llu stalls; resim %.2f M frames/s, catch-up "
+           "%.2f us mean, %.1f us worst; %.0f frames/s per side\n",
+           links[l].latency_ms, links[l].jitter_ms,
+           links[l].loss_permille / 10,
+           (double)st.rollbacks * 100.0 / (double)st.frames, st.max_depth,
+           (unsigned long long)st.stalls,
+           st.resim_ns ? (double)st.resim_frames * 1e3 / (double)st.resim_ns
+                       : 0.0,
+           (double)st.resim_ns * 1e-3 / rollbacks,
+           (double)st.worst_catchup_ns * 1e-3,
+           (double)(sides[0].frame + sides[1].frame) / 2.0 / seconds);
+    for (int p = 0; p < 2; ++p) netplay_free(&sides[p]);
+    net_lag_link_free(&link);
+  }
+}
+
+// вывод фронтенда вместо терминала идёт в SOCK_SEQPACKET-сокет: каждый
+// write() приходит отдельным пакетом, так что пакеты считают вызовы write()
+typedef struct {
+  int sock;
+  int saved_stdout;
+  long bytes;
+  long writes;
+} FrameCapture;
+
+static int capture_start(FrameCapture* c) {
+  int sv[2];
+  if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sv) != 0) return -1;
+  fflush(stdout);
+  *c = (FrameCapture){.sock = sv[0], .saved_stdout = dup(STDOUT_FILENO)};
+  dup2(sv[1], STDOUT_FILENO);
+  close(sv[1]);
+  fcntl(c->sock, F_SETFL, O_NONBLOCK);
+  return 0;
+}
+
+static void capture_drain(FrameCapture* c) {
+  static char packet[1 << 17];
+  ssize_t n;
+  while ((n = recv(c->sock, packet, sizeof(packet), 0)) > 0) {
+    c->bytes += n;
+    c->writes++;
+  }
+}
+
+static void capture_stop(FrameCapture* c) {
+  capture_drain(c);
+  dup2(c->saved_stdout, STDOUT_FILENO);
+  close(c->saved_stdout);
+  close(c->sock);
+}
+
+typedef struct {
+  long frames;  // 0 - сокет не создался
+  double seconds;
+  long bytes;
+  long writes;
+} FrameRun;
+
+// кадры партии, как в игре: шаг, tetris_query(), print_field(); ввод как
+// в bench_query, так что большинство кадров почти не меняется. Время -
+// только отрисовка, вывод разбирается вне замера. full - ncurses рисует
+// каждый кадр целиком, как до разностной отрисовки
+static FrameRun draw_frames(const Frontend* fe, long frames, bool full) {
+  FrameRun run = {0};
+  FrameCapture cap;
+  if (capture_start(&cap) != 0) return run;
+  fe->init();
+  TetrisGame* g = bench_game(8);
+  capture_drain(&cap);
+  cap.bytes = cap.writes = 0;
+  for (long i = 0; i < frames; ++i) {
+    if ((i & 7) == 0) tetris_input(g, i & 8 ? Left : Right, false);
+    tetris_step(g);
+    GameInfo_t info = tetris_query(g);
+    if (info.pause == 2) tetris_input(g, Start, false);
+    double started = sim_now();
+    if (full) invalidate_frame();
+    fe->print_field(&info);
+    run.seconds += sim_now() - started;
+    capture_drain(&cap);
+  }
+  run.frames = frames;
+  run.bytes = cap.bytes;
+  run.writes = cap.writes;
+  fe->shutdown();
+  capture_stop(&cap);
+  tetris_destroy(g);
+  return run;
+}
+
+// каждый прогон в своём процессе: ncurses, как и в игре, поднимается один
+// раз на процесс, а повторный initscr() после endwin() пишет другими
+// кусками
+static FrameRun run_frames(const Frontend* fe, long frames, bool full) {
+  FrameRun run = {0};
+  int fds[2];
+  if (pipe(fds) != 0) return run;
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(fds[0]);
+    run = draw_frames(fe, frames, full);
+    _exit(write(fds[1], &run, sizeof(run)) == sizeof(run) ? 0 : 1);
+  }
+  close(fds[1]);
+  if (pid > 0) {
+    if (read(fds[0], &run, sizeof(run)) != sizeof(run)) run.frames = 0;
+    waitpid(pid, NULL, 0);
+  }
+  close(fds[0]);
+  return run;
+}
+
+static void print_frame_run(const char* name, FrameRun run) {
+  if (!run.frames) {
+    printf("%s: no SOCK_SEQPACKET socket or fork(), skipped\n", name);
+    return;
+  }
+  double n = (double)run.frames;
+  printf("%s: %ld frames, %.2f us, %.1f bytes, %.2f write() per frame\n",
+         name, run.frames, run.seconds * 1e6 / n, (double)run.bytes / n,
+         (double)run.writes / n);
+}
+
+// терминал подменён, размер экрана ncurses берёт из окружения
+static void frontend_env(void) {
+  setenv("TERM", "xterm-256color", 1);
+  setenv("LINES", "50", 1);
+  setenv("COLUMNS", "100", 1);
+}
+
+static void bench_frontend(long frames) {
+  frontend_env();
+  print_frame_run("frontend ncurses",
+                  run_frames(&ncurses_frontend, frames, false));
+  print_frame_run("frontend ansi", run_frames(&ansi_frontend, frames, false));
+}
+
+// print_field() ncurses: весь экран каждый кадр против изменившихся клеток
+static void bench_repaint(long frames) {
+  frontend_env();
+  print_frame_run("repaint full", run_frames(&ncurses_frontend, frames, true));
+  print_frame_run("repaint diff",
+                  run_frames(&ncurses_frontend, frames, false));
+}
+
+static const Bench benches[] = {
+    {"snapshot", "tetris_save() + tetris_restore()", 50000000, bench_snapshot},
+    {"eval", "eval_score_boards() per SIMD path vs scalar", 5000,
+     bench_eval},
+    {"clear", "lock + line clear of 0..4 rows on a 16-row stack", 5000000,
+     bench_clear},
+    {"features", "engine_features_recompute() vs tetris_features()",
+     20000000, bench_features},
+    {"query", "tetris_step() + tetris_query() with a mostly idle frame",
+     20000000, bench_query},
+    {"replay", "record, verify and seek a corpus of random-input games",
+     20000, bench_replay},
+    {"vec", "tetris_vec_step() over 1024 envs with random actions", 5000,
+     bench_vec},
+    {"batch", "batch_engine_step() per SIMD path, same actions as vec", 5000,
+     bench_batch},
+    {"randomizer", "randomizer_fill() per piece, batched vs one by one",
+     200000000, bench_randomizer},
+    {"netplay", "two rollback sessions over a lagging link, random input",
+     200000, bench_netplay},
+    {"frontend", "ncurses vs ANSI backend: time, bytes and write() per frame",
+     20000, bench_frontend},
+    {"repaint", "ncurses print_field(): full screen vs changed cells only",
+     20000, bench_repaint},
+};
+
+static void usage(const char* prog) {
+  fprintf(stderr, "usage: %s [-n iterations] [name ...]\n", prog);
+  for (size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); ++i)
+    fprintf(stderr, "  %-10s %s\n", benches[i].name, benches[i].about);
+}
+
+int main(int argc, char** argv) {
+  long iterations = 0;
+  int opt;
+  while ((opt = getopt(argc, argv, "n:h")) != -1) {
+    if (opt == 'n') {
+      iterations = atol(optarg);
+    } else {
+      usage(argv[0]);
+      return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+  int status = EXIT_SUCCESS;
+  size_t count = sizeof(benches) / sizeof(benches[0]);
+  for (size_t i = 0; i < count; ++i) {
+    int selected = optind >= argc;
+    for (int a = optind; a < argc && !selected; ++a)
+      selected = strcmp(argv[a], benches[i].name) == 0;
+    if (selected)
+      benches[i].run(iterations > 0 ? iterations
+                                    : benches[i].default_iterations);
+  }
+  for (int a = optind; a < argc; ++a) {
+    int known = 0;
+    for (size_t i = 0; i < count; ++i)
+      known |= strcmp(argv[a], benches[i].name) == 0;
+    if (!known) {
+      fprintf(stderr, "unknown benchmark: %s\n", argv[a]);
+      status = EXIT_FAILURE;
+    }
+  }
+  return status;
+}
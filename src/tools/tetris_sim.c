@@ -0,0 +1,294 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "brick_game/tetris/movegen.h"
+#include "brick_game/tetris/replay.h"
+#include "sim_driver.h"
+
+static void usage(const char* prog) {
+  fprintf(stderr,
+          "usage: %s [-n games] [-s seed] [-t max_ticks] [-f script] "
+          "[-g randomizer] [-b] [-q]\n"
+          "          [-r replay]\n"
+          "          [-w beam_width [-d depth] [-j threads] [-m budget_ms] "
+          "[-T tt_mb]]\n"
+          "       %s -p depth [-f script]\n"
+          "       %s -R replay [-k tick]\n"
+          "  script: one frame per char, L R A D P - action, '.' - idle\n"
+          "  -g: piece generator - cycle, bag7 (default) or memoryless;\n"
+          "      each game is dealt from its own seed\n"
+          "  -b: the built-in bot plays instead of scripted/random input\n"
+          "  -w: the bot plans with beam search (implies -b); -d lookahead\n"
+          "      pieces, -j search threads, -m time budget per move, -T\n"
+          "      transposition table size (games share it)\n"
+          "  -p: perft, leaf placements to depth 1..N from the start position\n"
+          "      (or from the position after the script)\n"
+          "  -r: record the first game into a replay file\n"
+          "  -R: replay a file headlessly and check the final score; -k\n"
+          "      seeks to a tick from the nearest keyframe instead\n",
+          prog, prog, prog);
+}
+
+static void tt_report(const TTable* tt) {
+  const TTStats* st = tt_stats(tt);
+  long probes = atomic_load(&st->probes);
+  printf("ttable     : %zu buckets, %ld probes, %ld hits (%.1f%%), %ld misses, "
+         "%ld collisions, %ld stores, %ld replacements\n",
+         tt_buckets(tt), probes, atomic_load(&st->hits),
+         probes ? 100.0 * (double)atomic_load(&st->hits) / (double)probes
+                : 0.0,
+         atomic_load(&st->misses), atomic_load(&st->collisions),
+         atomic_load(&st->stores), atomic_load(&st->replacements));
+}
+
+static void planner_report(const PlannerStats* st) {
+  printf("planner    : %ld moves, %ld nodes, %.0f nodes/s, %ld boards, "
+         "%ld duplicates\n",
+         st->moves, st->nodes,
+         st->seconds > 0 ? (double)st->nodes / st->seconds : 0.0,
+         st->children, st->duplicates);
+  printf("move time  : mean %.3f ms, max %.3f ms, %ld cut by budget, "
+         "%ld from ttable\n",
+         st->moves ? st->seconds * 1e3 / (double)st->moves : 0.0,
+         st->max_seconds * 1e3, st->budget_cuts, st->tt_hits);
+  printf("depth      :");
+  for (int d = 1; d <= PLANNER_MAX_DEPTH; ++d)
+    if (st->depth_hist[d]) printf(" %d:%ld", d, st->depth_hist[d]);
+  printf("\n");
+}
+
+static char* read_file(const char* path) {
+  FILE* file = fopen(path, "rb");
+  char* text = NULL;
+  if (file) {
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    text = size >= 0 ? malloc((size_t)size + 1) : NULL;
+    if (text) {
+      size_t got = fread(text, 1, (size_t)size, file);
+      text[got] = '\0';
+    }
+    fclose(file);
+  }
+  return text;
+}
+
+static int replay_report(TetrisGame* game, const char* path, long seek) {
+  FILE* file = fopen(path, "rb");
+  uint8_t* data = NULL;
+  long size = -1;
+  if (file) {
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    data = size > 0 ? malloc((size_t)size) : NULL;
+    if (data && fread(data, 1, (size_t)size, file) != (size_t)size) size = -1;
+    fclose(file);
+  }
+  ReplayPlayer player;
+  if (!data || size <= 0 ||
+      replay_player_open(&player, data, (size_t)size) != 0) {
+    fprintf(stderr, "cannot read replay %s\n", path);
+    free(data);
+    return EXIT_FAILURE;
+  }
+  printf("replay     : %ld bytes, %u ticks, %u inputs (%.2f bytes/input), "
+         "%u keyframes every %u ticks\n",
+         size, player.ticks, player.inputs,
+         player.inputs ? (double)size / player.inputs : 0.0,
+         player.keyframes, player.interval);
+  double started = sim_now();
+  int status;
+  if (seek >= 0) {
+    status = replay_seek(&player, game, (uint32_t)seek);
+    printf("seek       : tick %ld in %.3f ms, score %d, lines %d, "
+           "pieces %d\n",
+           seek, (sim_now() - started) * 1e3, game->engine.score,
+           game->engine.lines, game->engine.pieces);
+  } else {
+    status = replay_verify(&player, game);
+    printf("verify     : %s in %.3f ms, score %d (recorded %d)\n",
+           status == 0 ? "ok" : "MISMATCH", (sim_now() - started) * 1e3,
+           game->engine.score, player.score);
+  }
+  replay_player_close(&player);
+  free(data);
+  return status == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// позиция для perft: старт и, если задан, один проход скрипта
+static void perft_report(TetrisGame* game, const SimConfig* cfg, int depth) {
+  tetris_input(game, Start, false);
+  for (size_t i = 0; cfg->script && i < cfg->script_len; ++i) {
+    if (cfg->script[i] != SIM_NO_ACTION)
+      tetris_input(game, (UserAction_t)cfg->script[i], false);
+    tetris_step(game);
+  }
+  printf("%5s %16s %10s %14s\n", "depth", "leaves", "time,s", "leaves/s");
+  for (int d = 1; d <= depth; ++d) {
+    double started = sim_now();
+    uint64_t leaves = movegen_perft(game, d);
+    double seconds = sim_now() - started;
+    printf("%5d %16llu %10.3f %14.0f\n", d, (unsigned long long)leaves,
+           seconds, seconds > 0 ? (double)leaves / seconds : 0.0);
+  }
+}
+
+int main(int argc, char** argv) {
+  long games = 1000;
+  uint64_t seed = 1;
+  SimConfig cfg = {.script = NULL,
+                   .script_len = 0,
+                   .max_ticks = 100000,
+                   .bot = NULL,
+                   .randomizer = RANDOMIZER_BAG7};
+  const char* script_path = NULL;
+  const char* record_path = NULL;
+  const char* replay_path = NULL;
+  long seek = -1;
+  int quiet = 0, perft_depth = 0, use_bot = 0, use_planner = 0;
+  PlannerConfig plan = PLANNER_DEFAULT_CONFIG;
+  long tt_mb = 0;
+  int opt;
+  while ((opt = getopt(argc, argv, "n:s:t:f:g:p:bw:d:j:m:T:r:R:k:qh")) != -1) {
+    switch (opt) {
+      case 'n':
+        games = atol(optarg);
+        break;
+      case 's':
+        seed = strtoull(optarg, NULL, 10);
+        break;
+      case 't':
+        cfg.max_ticks = atol(optarg);
+        break;
+      case 'f':
+        script_path = optarg;
+        break;
+      case 'g':
+        if (sim_parse_randomizer(optarg, &cfg.randomizer)) {
+          usage(argv[0]);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'p':
+        perft_depth = atoi(optarg);
+        break;
+      case 'b':
+        use_bot = 1;
+        break;
+      case 'w':
+        use_bot = use_planner = 1;
+        plan.beam_width = atoi(optarg);
+        break;
+      case 'd':
+        plan.max_depth = atoi(optarg);
+        break;
+      case 'j':
+        plan.threads = atoi(optarg);
+        break;
+      case 'm':
+        plan.budget_ms = atof(optarg);
+        break;
+      case 'T':
+        tt_mb = atol(optarg);
+        break;
+      case 'r':
+        record_path = optarg;
+        break;
+      case 'R':
+        replay_path = optarg;
+        break;
+      case 'k':
+        seek = atol(optarg);
+        break;
+      case 'q':
+        quiet = 1;
+        break;
+      default:
+        usage(argv[0]);
+        return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+
+  signed char* script = NULL;
+  if (script_path) {
+    char* text = read_file(script_path);
+    if (!text) {
+      fprintf(stderr, "cannot read script %s\n", script_path);
+      return EXIT_FAILURE;
+    }
+    script = malloc(strlen(text) + 1);
+    cfg.script_len = sim_parse_script(text, script);
+    cfg.script = script;
+    free(text);
+  }
+
+  TetrisGame* game = tetris_create();
+  if (!game) return EXIT_FAILURE;
+
+  if (replay_path) {
+    int status = replay_report(game, replay_path, seek);
+    tetris_destroy(game);
+    free(script);
+    return status;
+  }
+
+  if (perft_depth > 0) {
+    perft_report(game, &cfg, perft_depth);
+    tetris_destroy(game);
+    free(script);
+    return EXIT_SUCCESS;
+  }
+
+  if (use_bot && !(cfg.bot = bot_create())) return EXIT_FAILURE;
+  TetrisPlanner* planner = NULL;
+  if (use_planner) {
+    if (tt_mb > 0 && !(plan.tt = tt_create((size_t)tt_mb << 20)))
+      return EXIT_FAILURE;
+    planner = planner_create(&plan);
+    if (!planner) return EXIT_FAILURE;
+    cfg.bot->planner = planner;
+  }
+
+  ReplayRecorder recorder;
+  if (record_path && replay_recorder_init(&recorder, 0) != 0)
+    return EXIT_FAILURE;
+  SimStats stats;
+  sim_stats_init(&stats);
+  double started = sim_now();
+  for (long i = 0; i < games; ++i) {
+    SimResult result;
+    cfg.seed = sim_game_seed(seed, i);
+    if (record_path && i == 0) tetris_set_recorder(game, &recorder);
+    sim_play_game(game, &cfg, &result);
+    if (record_path && i == 0) {
+      tetris_set_recorder(game, NULL);
+      if (replay_finish(&recorder, game) != 0 ||
+          replay_save(&recorder, record_path) != 0)
+        fprintf(stderr, "cannot write replay %s\n", record_path);
+      replay_recorder_free(&recorder);
+    }
+    sim_stats_add(&stats, &result);
+  }
+  double elapsed = sim_now() - started;
+
+  sim_stats_print(&stats, elapsed, stdout);
+  if (!quiet) sim_stats_print_histogram(&stats, stdout);
+
+  if (cfg.bot)
+    printf("bot        : %ld moves, %ld boards evaluated (%s)\n",
+           cfg.bot->moves_played, cfg.bot->boards_evaluated,
+           eval_path_name(eval_best_path()));
+  if (planner) planner_report(planner_stats(planner));
+  if (plan.tt) tt_report(plan.tt);
+
+  planner_destroy(planner);
+  tt_destroy(plan.tt);
+  bot_destroy(cfg.bot);
+  tetris_destroy(game);
+  free(script);
+  return EXIT_SUCCESS;
+}
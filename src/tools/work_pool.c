@@ -0,0 +1,137 @@
+#define _POSIX_C_SOURCE 200809L
+#include "work_pool.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define POOL_MAX_THREADS 256
+#define RANGE(begin, end) (((uint64_t)(end) << 32) | (uint32_t)(begin))
+#define RANGE_BEGIN(r) ((long)((r)&0xFFFFFFFFu))
+#define RANGE_END(r) ((long)((r) >> 32))
+
+typedef struct {
+  _Alignas(64) _Atomic uint64_t range;
+  long steals;
+  long steal_attempts;
+} WorkQueue;
+
+typedef struct {
+  WorkQueue* queues;
+  int threads;
+  work_fn fn;
+  void* ctx;
+} WorkPool;
+
+typedef struct {
+  WorkPool* pool;
+  int index;
+} WorkerArg;
+
+int work_pool_cpu_count(void) {
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  if (cpus < 1) cpus = 1;
+  if (cpus > POOL_MAX_THREADS) cpus = POOL_MAX_THREADS;
+  return (int)cpus;
+}
+
+static int pop_own(WorkQueue* q, long* index) {
+  uint64_t r = atomic_load_explicit(&q->range, memory_order_acquire);
+  for (;;) {
+    long begin = RANGE_BEGIN(r), end = RANGE_END(r);
+    if (begin >= end) return 0;
+    if (atomic_compare_exchange_weak_explicit(&q->range, &r,
+                                              RANGE(begin + 1, end),
+                                              memory_order_acq_rel,
+                                              memory_order_acquire)) {
+      *index = begin;
+      return 1;
+    }
+  }
+}
+
+// забирает верхнюю половину диапазона жертвы в свою (пустую) очередь
+static int steal(WorkPool* pool, int self) {
+  WorkQueue* own = &pool->queues[self];
+  for (int i = 1; i < pool->threads; ++i) {
+    WorkQueue* victim = &pool->queues[(self + i) % pool->threads];
+    own->steal_attempts++;
+    uint64_t r = atomic_load_explicit(&victim->range, memory_order_acquire);
+    for (;;) {
+      long begin = RANGE_BEGIN(r), end = RANGE_END(r);
+      if (begin >= end) break;
+      long take = (end - begin + 1) / 2;
+      if (atomic_compare_exchange_weak_explicit(&victim->range, &r,
+                                                RANGE(begin, end - take),
+                                                memory_order_acq_rel,
+                                                memory_order_acquire)) {
+        atomic_store_explicit(&own->range, RANGE(end - take, end),
+                              memory_order_release);
+        own->steals++;
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
+
+static void* worker_main(void* arg) {
+  WorkerArg* worker = arg;
+  WorkPool* pool = worker->pool;
+  WorkQueue* own = &pool->queues[worker->index];
+  for (;;) {
+    long index;
+    if (pop_own(own, &index))
+      pool->fn(pool->ctx, worker->index, index);
+    else if (!steal(pool, worker->index))
+      break;  // работа больше не появляется, все очереди пусты
+  }
+  return NULL;
+}
+
+int work_pool_run(int threads, long count, work_fn fn, void* ctx,
+                  WorkPoolStats* stats) {
+  if (threads < 1) threads = 1;
+  if (threads > POOL_MAX_THREADS) threads = POOL_MAX_THREADS;
+  if (count < 0 || count > (long)UINT32_MAX) return -1;
+
+  WorkQueue* queues = aligned_alloc(64, sizeof(WorkQueue) * (size_t)threads);
+  pthread_t* ids = malloc(sizeof(pthread_t) * (size_t)threads);
+  WorkerArg* args = malloc(sizeof(WorkerArg) * (size_t)threads);
+  int status = (queues && ids && args) ? 0 : -1;
+  WorkPool pool = {queues, threads, fn, ctx};
+  int started = 0;
+  if (!status) {
+    for (int i = 0; i < threads; ++i) {
+      long begin = count * i / threads;
+      long end = count * (i + 1) / threads;
+      atomic_init(&queues[i].range, RANGE(begin, end));
+      queues[i].steals = 0;
+      queues[i].steal_attempts = 0;
+      args[i].pool = &pool;
+      args[i].index = i;
+    }
+    // поток 0 - вызывающий, остальные создаём
+    for (started = 1; started < threads; ++started)
+      if (pthread_create(&ids[started], NULL, worker_main, &args[started]))
+        break;
+    worker_main(&args[0]);
+    for (int i = 1; i < started; ++i) pthread_join(ids[i], NULL);
+    // если какой-то поток не стартовал, его диапазон доделывается здесь
+    if (started < threads) worker_main(&args[0]);
+  }
+  if (stats && !status) {
+    stats->steals = 0;
+    stats->steal_attempts = 0;
+    for (int i = 0; i < threads; ++i) {
+      stats->steals += queues[i].steals;
+      stats->steal_attempts += queues[i].steal_attempts;
+    }
+  }
+  free(queues);
+  free(ids);
+  free(args);
+  return status;
+}
@@ -0,0 +1,20 @@
+#ifndef WORK_POOL_H_
+#define WORK_POOL_H_
+
+// Пул потоков с work stealing по диапазонам индексов [0, count).
+// Каждый поток забирает индексы из своего диапазона с начала, а опустев,
+// отнимает верхнюю половину чужого. Диапазон - одно 64-битное атомарное
+// слово (begin, end), поэтому и владелец, и вор работают через CAS без
+// блокировок. fn получает номер потока, чтобы писать в свои данные.
+typedef void (*work_fn)(void* ctx, int worker, long index);
+
+typedef struct {
+  long steals;          // удачных краж
+  long steal_attempts;  // просмотров чужих очередей
+} WorkPoolStats;
+
+int work_pool_cpu_count(void);
+int work_pool_run(int threads, long count, work_fn fn, void* ctx,
+                  WorkPoolStats* stats);
+
+#endif